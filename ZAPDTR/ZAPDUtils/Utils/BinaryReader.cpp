@@ -38,6 +38,11 @@ uint32_t BinaryReader::GetBaseAddress()
 	return stream->GetBaseAddress();
 }
 
+uint64_t BinaryReader::GetLength()
+{
+	return stream->GetLength();
+}
+
 void BinaryReader::Read(int32_t length)
 {
 	stream->Read(length);
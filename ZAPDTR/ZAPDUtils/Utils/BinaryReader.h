@@ -1,8 +1,10 @@
 #pragma once
 
 #include <array>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include "../Color3b.h"
 #include "../Vec2f.h"
@@ -24,6 +26,7 @@ public:
 
 	void Seek(uint32_t offset, SeekOffsetType seekType);
 	uint32_t GetBaseAddress();
+	uint64_t GetLength();
 
 	void Read(int32_t length);
 	void Read(char* buffer, int32_t length);
@@ -44,6 +47,65 @@ public:
 	Color3b ReadColor3b();
 	std::string ReadString();
 
+	// Reads count values with a single copy out of the stream, then byte swaps all of them in one pass if the
+	// data does not match the host's endianness. Unlike ReadSingle/ReadDouble, NaNs are not rejected.
+	template <typename T>
+	void ReadArray(T* dest, size_t count)
+	{
+		static_assert(std::is_arithmetic_v<T>, "ReadArray only supports scalar types");
+
+		stream->Read((char*)dest, count * sizeof(T));
+
+		if (endianness != Endianness::Native)
+			ByteSwapArray(dest, count);
+	}
+
+	template <typename T>
+	std::vector<T> ReadArray(size_t count)
+	{
+		std::vector<T> result(count);
+		ReadArray(result.data(), count);
+
+		return result;
+	}
+
+	// Kept as a flat loop over a contiguous buffer so the compiler can vectorize it, or use byte reversed
+	// loads and stores on targets that have them.
+	template <typename T>
+	static void ByteSwapArray(T* values, size_t count)
+	{
+		if constexpr (sizeof(T) == 2)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				uint16_t value;
+				memcpy(&value, &values[i], sizeof(value));
+				value = BSWAP16(value);
+				memcpy(&values[i], &value, sizeof(value));
+			}
+		}
+		else if constexpr (sizeof(T) == 4)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t value;
+				memcpy(&value, &values[i], sizeof(value));
+				value = BSWAP32(value);
+				memcpy(&values[i], &value, sizeof(value));
+			}
+		}
+		else if constexpr (sizeof(T) == 8)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				uint64_t value;
+				memcpy(&value, &values[i], sizeof(value));
+				value = BSWAP64(value);
+				memcpy(&values[i], &value, sizeof(value));
+			}
+		}
+	}
+
 protected:
 	std::shared_ptr<Stream> stream;
 	Endianness endianness = Endianness::Native;
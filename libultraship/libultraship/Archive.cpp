@@ -5,20 +5,87 @@
 #include "Utils/StringHelper.h"
 #include "Lib/StrHash64.h"
 #include <filesystem>
+#include <algorithm>
+#include <cctype>
 
 #ifdef __SWITCH__
 #include "SwitchImpl.h"
 #endif
 
+#if !defined(_WIN32) && !defined(__SWITCH__) && !defined(__WIIU__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace Ship {
+	// StormLib compares paths case insensitively and treats both kinds of slashes as the same character.
+	static char FoldPathChar(char c) {
+		return c == '/' ? '\\' : (char)std::toupper((unsigned char)c);
+	}
+
+	static bool PathLess(const std::string& a, const std::string& b) {
+		return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+			return (unsigned char)FoldPathChar(x) < (unsigned char)FoldPathChar(y);
+		});
+	}
+
+	static bool PathStartsWith(const std::string& path, const std::string& prefix) {
+		if (path.size() < prefix.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < prefix.size(); i++) {
+			if (FoldPathChar(path[i]) != FoldPathChar(prefix[i])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static bool PathEquals(const std::string& a, const std::string& b) {
+		return a.size() == b.size() && PathStartsWith(a, b);
+	}
+
+	// Same wildcard rules as SFileFindFirstFile, '*' matches any run of characters and '?' exactly one.
+	static bool PathMatchesMask(const char* path, const char* mask) {
+		const char* starMask = nullptr;
+		const char* starPath = nullptr;
+
+		while (*path != 0) {
+			if (*mask == '*') {
+				starMask = ++mask;
+				starPath = path;
+			} else if (*mask == '?' || (*mask != 0 && FoldPathChar(*mask) == FoldPathChar(*path))) {
+				mask++;
+				path++;
+			} else if (starMask != nullptr) {
+				mask = starMask;
+				path = ++starPath;
+			} else {
+				return false;
+			}
+		}
+
+		while (*mask == '*') {
+			mask++;
+		}
+
+		return *mask == 0;
+	}
+
 	Archive::Archive(const std::string& MainPath, bool enableWriting) : Archive(MainPath, "", enableWriting)
 	{
 		mainMPQ = nullptr;
 	}
 
-	Archive::Archive(const std::string& MainPath, const std::string& PatchesPath, bool enableWriting, bool genCRCMap) : MainPath(MainPath), PatchesPath(PatchesPath) {
+	Archive::Archive(const std::string& MainPath, const std::string& PatchesPath, bool enableWriting, bool genCRCMap, bool memoryMapped) : MainPath(MainPath), PatchesPath(PatchesPath), bIsWritable(enableWriting) {
 		mainMPQ = nullptr;
-		Load(enableWriting, genCRCMap);
+		mainMPQMappingSize = 0;
+		mainMPQHeaderOffset = 0;
+		bHasFileIndex = false;
+		Load(enableWriting, genCRCMap, memoryMapped && !enableWriting);
 	}
 
 	Archive::~Archive() {
@@ -56,6 +123,27 @@ namespace Ship {
 	}
 
 	std::shared_ptr<File> Archive::LoadFile(const std::string& filePath, bool includeParent, std::shared_ptr<File> FileToLoad) {
+		if (FileToLoad == nullptr) {
+			FileToLoad = std::make_shared<File>();
+			FileToLoad->path = filePath;
+		}
+
+		ReadHandle* readHandle = AcquireReadHandle();
+
+		if (readHandle == nullptr) {
+			std::unique_lock<std::mutex> Lock(FileToLoad->FileLoadMutex);
+			FileToLoad->bHasLoadError = true;
+			return FileToLoad;
+		}
+
+		FileToLoad = LoadFileFromHandle(readHandle->mpq, readHandle->patches, filePath, includeParent, FileToLoad);
+		ReleaseReadHandle(readHandle);
+
+		return FileToLoad;
+	}
+
+	std::shared_ptr<File> Archive::LoadFileFromHandle(HANDLE mpqHandle, const std::vector<HANDLE>& patchHandles, const std::string& filePath, bool includeParent,
+		std::shared_ptr<File> FileToLoad) {
 		HANDLE fileHandle = NULL;
 
 		if (FileToLoad == nullptr) {
@@ -63,7 +151,7 @@ namespace Ship {
 			FileToLoad->path = filePath;
 		}
 
-		bool attempt = SFileOpenFileEx(mainMPQ, filePath.c_str(), 0, &fileHandle);
+		bool attempt = SFileOpenFileEx(mpqHandle, filePath.c_str(), 0, &fileHandle);
 
 		//if (!attempt)
 		//{
@@ -79,17 +167,21 @@ namespace Ship {
 		}
 
 		DWORD dwFileSize = SFileGetFileSize(fileHandle, 0);
-		std::shared_ptr<char[]> fileData(new char[dwFileSize]);
-		DWORD dwBytes;
+		std::shared_ptr<char[]> fileData = GetMappedFileData(fileHandle, patchHandles, filePath, dwFileSize);
 
-		if (!SFileReadFile(fileHandle, fileData.get(), dwFileSize, &dwBytes, NULL)) {
-			SPDLOG_ERROR("({}) Failed to read file {} from mpq archive {}", GetLastError(), filePath.c_str(), MainPath.c_str());
-			if (!SFileCloseFile(fileHandle)) {
-				SPDLOG_ERROR("({}) Failed to close file {} from mpq after read failure in archive {}", GetLastError(), filePath.c_str(), MainPath.c_str());
+		if (fileData == nullptr) {
+			fileData = std::shared_ptr<char[]>(new char[dwFileSize]);
+			DWORD dwBytes;
+
+			if (!SFileReadFile(fileHandle, fileData.get(), dwFileSize, &dwBytes, NULL)) {
+				SPDLOG_ERROR("({}) Failed to read file {} from mpq archive {}", GetLastError(), filePath.c_str(), MainPath.c_str());
+				if (!SFileCloseFile(fileHandle)) {
+					SPDLOG_ERROR("({}) Failed to close file {} from mpq after read failure in archive {}", GetLastError(), filePath.c_str(), MainPath.c_str());
+				}
+				std::unique_lock<std::mutex> Lock(FileToLoad->FileLoadMutex);
+				FileToLoad->bHasLoadError = true;
+				return FileToLoad;
 			}
-			std::unique_lock<std::mutex> Lock(FileToLoad->FileLoadMutex);
-			FileToLoad->bHasLoadError = true;
-			return FileToLoad;
 		}
 
 		if (!SFileCloseFile(fileHandle)) {
@@ -105,6 +197,156 @@ namespace Ship {
 		return FileToLoad;
 	}
 
+	Archive::ReadHandle* Archive::AcquireReadHandle() {
+		// Writable archives are only used by the single threaded tools and have to see their own pending writes.
+		if (bIsWritable) {
+			writableHandle.mpq = mainMPQ;
+			writableHandle.patches.clear();
+
+			for (const auto& [path, handle] : mpqHandles) {
+				if (handle != mainMPQ) {
+					writableHandle.patches.push_back(handle);
+				}
+			}
+
+			return &writableHandle;
+		}
+
+		{
+			const std::lock_guard<std::mutex> Lock(readHandlesMutex);
+
+			if (!freeReadHandles.empty()) {
+				ReadHandle* handle = freeReadHandles.back();
+				freeReadHandles.pop_back();
+				return handle;
+			}
+		}
+
+		// Reading through the shared handles instead would race the threads already using them, so a handle that
+		// can't be opened fails the load.
+		auto handle = std::make_unique<ReadHandle>();
+
+		if (!OpenMPQ(MainPath, false, &handle->mpq)) {
+			SPDLOG_ERROR("({}) Failed to open an extra read handle for {}.", GetLastError(), MainPath.c_str());
+			return nullptr;
+		}
+
+		for (const auto& patchPath : patchMPQPaths) {
+			HANDLE patchHandle = nullptr;
+
+#ifdef _WIN32
+			if (!SFileOpenPatchArchive(handle->mpq, std::filesystem::absolute(patchPath).wstring().c_str(), "", 0) ||
+#else
+			if (!SFileOpenPatchArchive(handle->mpq, patchPath.c_str(), "", 0) ||
+#endif
+				!OpenMPQ(patchPath, false, &patchHandle)) {
+				SPDLOG_ERROR("({}) Failed to open patch mpq file {} for a read handle of {}.", GetLastError(), patchPath.c_str(), MainPath.c_str());
+				CloseReadHandle(*handle);
+				return nullptr;
+			}
+
+			handle->patches.push_back(patchHandle);
+		}
+
+		const std::lock_guard<std::mutex> Lock(readHandlesMutex);
+		readHandles.push_back(std::move(handle));
+
+		return readHandles.back().get();
+	}
+
+	void Archive::ReleaseReadHandle(ReadHandle* handle) {
+		if (handle == &writableHandle) {
+			return;
+		}
+
+		const std::lock_guard<std::mutex> Lock(readHandlesMutex);
+		freeReadHandles.push_back(handle);
+	}
+
+	bool Archive::CloseReadHandle(const ReadHandle& handle) {
+		bool success = true;
+
+		for (HANDLE patchHandle : handle.patches) {
+			if (!SFileCloseArchive(patchHandle)) {
+				SPDLOG_ERROR("({}) Failed to close patch read handle of mpq {}", GetLastError(), MainPath.c_str());
+				success = false;
+			}
+		}
+
+		if (!SFileCloseArchive(handle.mpq)) {
+			SPDLOG_ERROR("({}) Failed to close read handle of mpq {}", GetLastError(), MainPath.c_str());
+			success = false;
+		}
+
+		return success;
+	}
+
+	bool Archive::GetFileChecksum(const std::string& filePath, uint64_t* checksum) {
+		ReadHandle* readHandle = AcquireReadHandle();
+
+		if (readHandle == nullptr) {
+			return false;
+		}
+
+		// The last patch with the file is the one it is read from.
+		HANDLE mpqHandle = readHandle->mpq;
+
+		for (auto it = readHandle->patches.rbegin(); it != readHandle->patches.rend(); it++) {
+			if (SFileHasFile(*it, filePath.c_str())) {
+				mpqHandle = *it;
+				break;
+			}
+		}
+
+		HANDLE fileHandle = nullptr;
+		DWORD crc32 = 0;
+		bool success = false;
+
+		if (SFileOpenFileEx(mpqHandle, filePath.c_str(), 0, &fileHandle)) {
+			success = SFileGetFileInfo(fileHandle, SFileInfoCRC32, &crc32, sizeof(crc32), nullptr) && crc32 != 0;
+			*checksum = ((uint64_t)SFileGetFileSize(fileHandle, nullptr) << 32) | crc32;
+			SFileCloseFile(fileHandle);
+		}
+
+		ReleaseReadHandle(readHandle);
+		return success;
+	}
+
+	std::shared_ptr<char[]> Archive::GetMappedFileData(HANDLE fileHandle, const std::vector<HANDLE>& patchHandles, const std::string& filePath, DWORD dwFileSize) {
+		if (mainMPQMapping == nullptr) {
+			return nullptr;
+		}
+
+		DWORD dwFlags = 0;
+		ULONGLONG byteOffset = 0;
+
+		if (!SFileGetFileInfo(fileHandle, SFileInfoFlags, &dwFlags, sizeof(dwFlags), nullptr) ||
+			!SFileGetFileInfo(fileHandle, SFileInfoByteOffset, &byteOffset, sizeof(byteOffset), nullptr)) {
+			return nullptr;
+		}
+
+		// Only plain stored entries can be used in place, everything else has to go through StormLib.
+		if ((dwFlags & (MPQ_FILE_COMPRESS_MASK | MPQ_FILE_ENCRYPTED | MPQ_FILE_PATCH_FILE | MPQ_FILE_DELETE_MARKER)) != 0) {
+			return nullptr;
+		}
+
+		// The byte offset is relative to the archive the entry was found in, which has to be the mapped main archive.
+		for (HANDLE patchHandle : patchHandles) {
+			if (SFileHasFile(patchHandle, filePath.c_str())) {
+				return nullptr;
+			}
+		}
+
+		const uint64_t fileOffset = mainMPQHeaderOffset + byteOffset;
+
+		if (fileOffset + dwFileSize > mainMPQMappingSize) {
+			return nullptr;
+		}
+
+		// Aliases the mapping so it stays alive for as long as any File still points into it.
+		return std::shared_ptr<char[]>(mainMPQMapping, mainMPQMapping.get() + fileOffset);
+	}
+
 	std::shared_ptr<File> Archive::LoadPatchFile(const std::string& filePath, bool includeParent, std::shared_ptr<File> FileToLoad) {
 		HANDLE fileHandle = NULL;
 		HANDLE mpqHandle = NULL;
@@ -195,6 +437,7 @@ namespace Ship {
 
 		addedFiles.push_back(path);
 		hashes[CRC64(path.c_str())] = path;
+		AddToFileIndex(path);
 
 		return true;
 	}
@@ -207,6 +450,10 @@ namespace Ship {
 			return false;
 		}
 
+		hashes.erase(CRC64(StringHelper::Replace(path, "/", "\\").c_str()));
+		hashes.erase(CRC64(StringHelper::Replace(path, "\\", "/").c_str()));
+		RemoveFromFileIndex(path);
+
 		return true;
 	}
 
@@ -218,11 +465,35 @@ namespace Ship {
 			return false;
 		}
 
+		hashes.erase(CRC64(StringHelper::Replace(oldPath, "/", "\\").c_str()));
+		hashes.erase(CRC64(StringHelper::Replace(oldPath, "\\", "/").c_str()));
+		RemoveFromFileIndex(oldPath);
+		hashes[CRC64(newPath.c_str())] = newPath;
+		AddToFileIndex(newPath);
+
 		return true;
 	}
 
-	std::vector<SFILE_FIND_DATA> Archive::ListFiles(const std::string& searchMask) const {
-		auto fileList = std::vector<SFILE_FIND_DATA>();
+	std::vector<std::string> Archive::ListFiles(const std::string& searchMask) const {
+		if (!bHasFileIndex) {
+			return SearchMPQ(searchMask);
+		}
+
+		auto fileList = std::vector<std::string>();
+		const std::string prefix = searchMask.substr(0, searchMask.find_first_of("*?"));
+
+		// Only the paths sharing the mask's literal prefix can match, and they are all next to each other in the index.
+		for (auto it = std::lower_bound(fileIndex.begin(), fileIndex.end(), prefix, PathLess); it != fileIndex.end() && PathStartsWith(*it, prefix); it++) {
+			if (PathMatchesMask(it->c_str() + prefix.size(), searchMask.c_str() + prefix.size())) {
+				fileList.push_back(*it);
+			}
+		}
+
+		return fileList;
+	}
+
+	std::vector<std::string> Archive::SearchMPQ(const std::string& searchMask) const {
+		auto fileList = std::vector<std::string>();
 		SFILE_FIND_DATA findContext;
 		HANDLE hFind;
 
@@ -230,14 +501,14 @@ namespace Ship {
 		hFind = SFileFindFirstFile(mainMPQ, searchMask.c_str(), &findContext, nullptr);
 		//if (hFind && GetLastError() != ERROR_NO_MORE_FILES) {
 		if (hFind != nullptr) {
-			fileList.push_back(findContext);
+			fileList.push_back(findContext.cFileName);
 
 			bool fileFound;
 			do {
 				fileFound = SFileFindNextFile(hFind, &findContext);
 
 				if (fileFound) {
-					fileList.push_back(findContext);
+					fileList.push_back(findContext.cFileName);
 				}
 				else if (!fileFound && GetLastError() != ERROR_NO_MORE_FILES)
 				//else if (!fileFound)
@@ -266,22 +537,32 @@ namespace Ship {
 	}
 
 	bool Archive::HasFile(const std::string& filename) const {
-		bool result = false;
-		auto start = std::chrono::steady_clock::now();
+		if (!bHasFileIndex) {
+			auto lst = SearchMPQ(filename);
+			return std::find(lst.begin(), lst.end(), filename) != lst.end();
+		}
 
-		auto lst = ListFiles(filename);
+		// Every indexed path is also in the CRC map, under both kinds of slashes.
+		const std::string* hashStr = HashToString(CRC64(filename.c_str()));
+		return hashStr != nullptr && *hashStr == filename;
+	}
 
-		for (const auto& item : lst) {
-			if (item.cFileName == filename) {
-				result = true;
-				break;
-			}
+	void Archive::AddToFileIndex(const std::string& path) {
+		if (!bHasFileIndex) {
+			return;
 		}
 
-		auto end = std::chrono::steady_clock::now();
-		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+		auto it = std::lower_bound(fileIndex.begin(), fileIndex.end(), path, PathLess);
+		if (it == fileIndex.end() || !PathEquals(*it, path)) {
+			fileIndex.insert(it, path);
+		}
+	}
 
-		return result;
+	void Archive::RemoveFromFileIndex(const std::string& path) {
+		auto it = std::lower_bound(fileIndex.begin(), fileIndex.end(), path, PathLess);
+		if (it != fileIndex.end() && PathEquals(*it, path)) {
+			fileIndex.erase(it);
+		}
 	}
 
 	const std::string* Archive::HashToString(uint64_t hash) const {
@@ -289,13 +570,41 @@ namespace Ship {
 		return it != hashes.end() ? &it->second : nullptr;
 	}
 
-	bool Archive::Load(bool enableWriting, bool genCRCMap) {
-		return LoadMainMPQ(enableWriting, genCRCMap) && LoadPatchMPQs();
+	bool Archive::Load(bool enableWriting, bool genCRCMap, bool memoryMapped) {
+		if (!LoadMainMPQ(enableWriting, genCRCMap)) {
+			return false;
+		}
+
+		if (memoryMapped && !MapMainMPQ()) {
+			SPDLOG_WARN("Failed to memory map {}, falling back to regular reads", MainPath.c_str());
+		}
+
+		if (!LoadPatchMPQs()) {
+			return false;
+		}
+
+		if (bHasFileIndex) {
+			// Patches may replace files of the main archive, keep the first spelling of every path.
+			std::stable_sort(fileIndex.begin(), fileIndex.end(), PathLess);
+			fileIndex.erase(std::unique(fileIndex.begin(), fileIndex.end(), PathEquals), fileIndex.end());
+		}
+
+		return true;
 	}
 
 	bool Archive::Unload()
 	{
 		bool success = true;
+
+		for (const auto& handle : readHandles) {
+			if (!CloseReadHandle(*handle)) {
+				success = false;
+			}
+		}
+
+		readHandles.clear();
+		freeReadHandles.clear();
+
 		for (const auto& mpqHandle : mpqHandles) {
 			if (!SFileCloseArchive(mpqHandle.second)) {
 				SPDLOG_ERROR("({}) Failed to close mpq {}", GetLastError(), mpqHandle.first.c_str());
@@ -304,10 +613,83 @@ namespace Ship {
 		}
 
 		mainMPQ = nullptr;
+		mainMPQMapping = nullptr;
 
 		return success;
 	}
 
+	bool Archive::MapMainMPQ() {
+		ULONGLONG headerOffset = 0;
+
+		if (!SFileGetFileInfo(mainMPQ, SFileMpqHeaderOffset, &headerOffset, sizeof(headerOffset), nullptr)) {
+			return false;
+		}
+
+#ifdef _WIN32
+		std::wstring wfullPath = std::filesystem::absolute(MainPath).wstring();
+		HANDLE hFile = CreateFileW(wfullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (hFile == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		HANDLE hMapping = nullptr;
+
+		if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0) {
+			hMapping = CreateFileMappingW(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		}
+
+		CloseHandle(hFile);
+
+		if (hMapping == nullptr) {
+			return false;
+		}
+
+		// Copy-on-write so callers that scribble over a File buffer never touch the archive on disk.
+		char* mapped = (char*)MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(hMapping);
+
+		if (mapped == nullptr) {
+			return false;
+		}
+
+		mainMPQMapping = std::shared_ptr<char>(mapped, [](char* ptr) { UnmapViewOfFile(ptr); });
+		mainMPQMappingSize = fileSize.QuadPart;
+#elif !defined(__SWITCH__) && !defined(__WIIU__)
+		std::string fullPath = std::filesystem::absolute(MainPath).string();
+		int fd = open(fullPath.c_str(), O_RDONLY);
+
+		if (fd < 0) {
+			return false;
+		}
+
+		off_t fileSize = lseek(fd, 0, SEEK_END);
+
+		if (fileSize <= 0) {
+			close(fd);
+			return false;
+		}
+
+		// Copy-on-write so callers that scribble over a File buffer never touch the archive on disk.
+		void* mapped = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+
+		mainMPQMapping = std::shared_ptr<char>((char*)mapped, [fileSize](char* ptr) { munmap(ptr, fileSize); });
+		mainMPQMappingSize = fileSize;
+#else
+		return false;
+#endif
+
+		mainMPQHeaderOffset = headerOffset;
+
+		return true;
+	}
+
 	bool Archive::LoadPatchMPQs() {
 		// OTRTODO: We also want to periodically scan the patch directories for new MPQs. When new MPQs are found we will load the contents to fileCache and then copy over to gameResourceAddresses
 		if (PatchesPath.length() > 0) {
@@ -326,22 +708,27 @@ namespace Ship {
 		return true;
 	}
 
-	bool Archive::LoadMainMPQ(bool enableWriting, bool genCRCMap) {
-		HANDLE mpqHandle = NULL;
+	bool Archive::OpenMPQ(const std::string& path, bool enableWriting, HANDLE* handle) {
 #ifdef _WIN32
-		std::wstring wfullPath = std::filesystem::absolute(MainPath).wstring();
+		std::wstring wfullPath = std::filesystem::absolute(path).wstring();
+		return SFileOpenArchive(wfullPath.c_str(), 0, enableWriting ? 0 : MPQ_OPEN_READ_ONLY, handle);
+#elif defined(__SWITCH__)
+		return SFileOpenArchive(path.c_str(), 0, enableWriting ? 0 : MPQ_OPEN_READ_ONLY, handle);
+#else
+		std::string fullPath = std::filesystem::absolute(path).string();
+		return SFileOpenArchive(fullPath.c_str(), 0, enableWriting ? 0 : MPQ_OPEN_READ_ONLY, handle);
 #endif
+	}
+
+	bool Archive::LoadMainMPQ(bool enableWriting, bool genCRCMap) {
+		HANDLE mpqHandle = NULL;
 #if defined(__SWITCH__)
 		std::string fullPath = MainPath;
 #else
 		std::string fullPath = std::filesystem::absolute(MainPath).string();
 #endif
 
-#ifdef _WIN32
-		if (!SFileOpenArchive(wfullPath.c_str(), 0, enableWriting ? 0 : MPQ_OPEN_READ_ONLY, &mpqHandle)) {
-#else
-		if (!SFileOpenArchive(fullPath.c_str(), 0, enableWriting ? 0 : MPQ_OPEN_READ_ONLY, &mpqHandle)) {
-#endif
+		if (!OpenMPQ(MainPath, enableWriting, &mpqHandle)) {
 
 	#ifdef __SWITCH__
 			Switch::ThrowMissingOTR(fullPath);
@@ -354,22 +741,41 @@ namespace Ship {
 		mainMPQ = mpqHandle;
 
 		if (genCRCMap) {
-			auto listFile = LoadFile("(listfile)", false);
+			bHasFileIndex = true;
+			IndexListFile(mainMPQ);
+		}
 
-			std::vector<std::string> lines = StringHelper::Split(std::string(listFile->buffer.get(), listFile->dwBufferSize), "\n");
+		return true;
+	}
 
-			for (size_t i = 0; i < lines.size(); i++) {
-				std::string line = StringHelper::Replace(StringHelper::Strip(lines[i], "\r"), "/", "\\");
-				std::string line2 = StringHelper::Replace(line, "\\", "/");
+	void Archive::IndexListFile(HANDLE mpqHandle) {
+		auto listFile = LoadFileFromHandle(mpqHandle, {}, "(listfile)", false, nullptr);
 
-				uint64_t hash = CRC64(StringHelper::Replace(line, "/", "\\").c_str());
-				uint64_t hash2 = CRC64(StringHelper::Replace(line, "\\", "/").c_str());
-				hashes[hash] = line;
-				hashes[hash2] = line2;
-			}
+		if (listFile->bHasLoadError) {
+			SPDLOG_WARN("Archive has no listfile, its files can not be searched");
+			return;
 		}
 
-		return true;
+		std::vector<std::string> lines = StringHelper::Split(std::string(listFile->buffer.get(), listFile->dwBufferSize), "\n");
+
+		for (size_t i = 0; i < lines.size(); i++) {
+			std::string path = StringHelper::Strip(lines[i], "\r");
+
+			if (path.empty()) {
+				continue;
+			}
+
+			std::string line = StringHelper::Replace(path, "/", "\\");
+			std::string line2 = StringHelper::Replace(line, "\\", "/");
+
+			uint64_t hash = CRC64(line.c_str());
+			uint64_t hash2 = CRC64(line2.c_str());
+			hashes[hash] = line;
+			hashes[hash2] = line2;
+
+			// Sorted once every archive has been indexed.
+			fileIndex.push_back(path);
+		}
 	}
 
 	bool Archive::LoadPatchMPQ(const std::string& path) {
@@ -403,6 +809,11 @@ namespace Ship {
 		}
 
 		mpqHandles[fullPath] = patchHandle;
+		patchMPQPaths.push_back(fullPath);
+
+		if (bHasFileIndex) {
+			IndexListFile(patchHandle);
+		}
 
 		return true;
 	}
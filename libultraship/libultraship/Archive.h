@@ -6,9 +6,11 @@
 
 #include <stdint.h>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <mutex>
 #include "Resource.h"
 //#include "Lib/StrHash64.h"
 #include "StormLib.h"
@@ -21,7 +23,9 @@ namespace Ship
 	{
 	public:
 		Archive(const std::string& MainPath, bool enableWriting);
-		Archive(const std::string& MainPath, const std::string& PatchesPath, bool enableWriting, bool genCRCMap = true);
+		// When memoryMapped is set on a read-only archive, uncompressed entries of the main archive are handed out as
+		// views into a mapping of the file instead of being copied into a fresh buffer.
+		Archive(const std::string& MainPath, const std::string& PatchesPath, bool enableWriting, bool genCRCMap = true, bool memoryMapped = false);
 		~Archive();
 
 		bool IsMainMPQValid();
@@ -34,21 +38,59 @@ namespace Ship
 		bool AddFile(const std::string& path, uintptr_t fileData, DWORD dwFileSize);
 		bool RemoveFile(const std::string& path);
 		bool RenameFile(const std::string& oldPath, const std::string& newPath);
-		std::vector<SFILE_FIND_DATA> ListFiles(const std::string& searchMask) const;
-		bool HasFile(const std::string& searchMask) const;
+		// Matches paths the same way StormLib does: case insensitive, with '/' and '\\' treated as equal.
+		std::vector<std::string> ListFiles(const std::string& searchMask) const;
+		bool HasFile(const std::string& filename) const;
+		// Identifies the raw contents of a file by the CRC32 its archive stores for it and its size, without reading it.
+		// False if no archive has the file or the one it comes from stores no CRC32 for it.
+		bool GetFileChecksum(const std::string& filePath, uint64_t* checksum);
 		const std::string* HashToString(uint64_t hash) const;
+		size_t GetHashCount() const { return hashes.size(); }
+		const std::string& GetMainPath() const { return MainPath; }
+		const std::vector<std::string>& GetPatchPaths() const { return patchMPQPaths; }
 	protected:
-		bool Load(bool enableWriting, bool genCRCMap);
+		bool Load(bool enableWriting, bool genCRCMap, bool memoryMapped);
 		bool Unload();
 	private:
 		std::string MainPath;
 		std::string PatchesPath;
 		std::map<std::string, HANDLE> mpqHandles;
+		std::vector<std::string> patchMPQPaths;
+		// StormLib file handles share the state of the archive they were opened from, so every thread reading
+		// at the same time needs its own archive handles. Handles are opened on demand and returned here when done.
+		struct ReadHandle {
+			HANDLE mpq; // The main archive with every patch applied
+			std::vector<HANDLE> patches; // Each patch archive on its own, to find out which archive an entry is in
+		};
+		std::vector<std::unique_ptr<ReadHandle>> readHandles;
+		std::vector<ReadHandle*> freeReadHandles;
+		std::mutex readHandlesMutex;
+		ReadHandle writableHandle;
+		bool bIsWritable;
 		std::vector<std::string> addedFiles;
 		std::unordered_map<uint64_t, std::string> hashes;
+		// Every path in the main and patch archives, sorted case insensitively so searches only have to look at the
+		// paths sharing the literal prefix of their mask. Only built when the CRC map is generated.
+		std::vector<std::string> fileIndex;
+		bool bHasFileIndex;
 		HANDLE mainMPQ;
+		std::shared_ptr<char> mainMPQMapping;
+		uint64_t mainMPQMappingSize;
+		uint64_t mainMPQHeaderOffset;
 
 		bool LoadMainMPQ(bool enableWriting, bool genCRCMap);
+		void IndexListFile(HANDLE mpqHandle);
+		void AddToFileIndex(const std::string& path);
+		void RemoveFromFileIndex(const std::string& path);
+		std::vector<std::string> SearchMPQ(const std::string& searchMask) const;
+		bool OpenMPQ(const std::string& path, bool enableWriting, HANDLE* handle);
+		ReadHandle* AcquireReadHandle();
+		void ReleaseReadHandle(ReadHandle* handle);
+		bool CloseReadHandle(const ReadHandle& handle);
+		std::shared_ptr<File> LoadFileFromHandle(HANDLE mpqHandle, const std::vector<HANDLE>& patchHandles, const std::string& filePath, bool includeParent,
+			std::shared_ptr<File> FileToLoad);
+		bool MapMainMPQ();
+		std::shared_ptr<char[]> GetMappedFileData(HANDLE fileHandle, const std::vector<HANDLE>& patchHandles, const std::string& filePath, DWORD dwFileSize);
 		bool LoadPatchMPQs();
 		bool LoadPatchMPQ(const std::string& path);
 	};
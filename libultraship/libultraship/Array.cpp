@@ -12,51 +12,52 @@ namespace Ship
 		ZResourceType resType = (ZResourceType)reader->ReadUInt32();
 		uint32_t arrayCnt = reader->ReadUInt32();
 
+		if (resType == ZResourceType::Vertex)
+		{
+			arr->vertices.resize(arrayCnt);
+			ReadVertices(reader, arr->vertices.data(), arrayCnt);
+			return;
+		}
+
 		for (uint32_t i = 0; i < arrayCnt; i++)
 		{
-			if (resType == ZResourceType::Vertex)
-			{
-				Vtx data;
-				data.x = reader->ReadInt16();
-				data.y = reader->ReadInt16();
-				data.z = reader->ReadInt16();
-				data.flag = reader->ReadUInt16();
-				data.s = reader->ReadInt16();
-				data.t = reader->ReadInt16();
-				data.r = reader->ReadUByte();
-				data.g = reader->ReadUByte();
-				data.b = reader->ReadUByte();
-				data.a = reader->ReadUByte();
-				arr->vertices.push_back(data);
-			}
-			else
-			{
-				ScalarType scalType = (ScalarType)reader->ReadUInt32();
+			ScalarType scalType = (ScalarType)reader->ReadUInt32();
+
+			int iter = 1;
 
-				int iter = 1;
+			if (resType == ZResourceType::Vector)
+				iter = reader->ReadUInt32();
 
-				if (resType == ZResourceType::Vector)
-					iter = reader->ReadUInt32();
+			switch (scalType)
+			{
+			case ScalarType::ZSCALAR_S16:
+			{
+				auto values = reader->ReadArray<int16_t>(iter);
 
-				for (int k = 0; k < iter; k++)
+				for (int16_t value : values)
 				{
 					ScalarData data;
+					data.s16 = value;
+					arr->scalars.push_back(data);
+				}
+				break;
+			}
+			case ScalarType::ZSCALAR_U16:
+			{
+				auto values = reader->ReadArray<uint16_t>(iter);
 
-					switch (scalType)
-					{
-					case ScalarType::ZSCALAR_S16:
-						data.s16 = reader->ReadInt16();
-						break;
-					case ScalarType::ZSCALAR_U16:
-						data.u16 = reader->ReadUInt16();
-						break;
-						// OTRTODO: IMPLEMENT OTHER TYPES!
-					default:
-						break;
-					}
-
+				for (uint16_t value : values)
+				{
+					ScalarData data;
+					data.u16 = value;
 					arr->scalars.push_back(data);
 				}
+				break;
+			}
+				// OTRTODO: IMPLEMENT OTHER TYPES!
+			default:
+				arr->scalars.insert(arr->scalars.end(), iter, ScalarData());
+				break;
 			}
 		}
 	}
@@ -82,5 +82,6 @@ namespace Ship
 		std::vector<ScalarData> scalars;
 		std::vector<Vtx> vertices;
 
+		size_t GetMemorySize() const override { return sizeof(*this) + scalars.capacity() * sizeof(ScalarData) + vertices.capacity() * sizeof(Vtx); }
 	};
 }
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "Audio.h"
+#include <algorithm>
+
+extern "C" {
+#include "mixer.h"
+}
 
 namespace Ship
 {
@@ -10,10 +15,7 @@ namespace Ship
 
 		uint32_t seqDataSize = reader->ReadInt32();
 
-		seq->seqData.reserve(seqDataSize);
-
-		for (uint32_t i = 0; i < seqDataSize; i++)
-			seq->seqData.push_back(reader->ReadUByte());
+		seq->seqData = reader->ReadArray<char>(seqDataSize);
 
 		seq->seqNumber = reader->ReadUByte();
 		seq->medium = reader->ReadUByte();
@@ -21,8 +23,7 @@ namespace Ship
 
 		uint32_t numFonts = reader->ReadInt32();
 
-		for (uint32_t i = 0; i < numFonts; i++)
-			seq->fonts.push_back(reader->ReadUByte());
+		seq->fonts = reader->ReadArray<uint8_t>(numFonts);
 	}
 
 	void AudioSampleV2::ParseFileBinary(BinaryReader* reader, Resource* res)
@@ -38,8 +39,7 @@ namespace Ship
 
 		uint32_t dataSize = reader->ReadInt32();
 
-		for (uint32_t i = 0; i < dataSize; i++)
-			entry->data.push_back(reader->ReadUByte());
+		entry->data = reader->ReadArray<uint8_t>(dataSize);
 
 		entry->loop.start = reader->ReadUInt32();
 		entry->loop.end = reader->ReadUInt32();
@@ -47,16 +47,67 @@ namespace Ship
 
 		uint32_t loopStateCnt = reader->ReadUInt32();
 
-		for (uint32_t i = 0; i < loopStateCnt; i++)
-			entry->loop.states.push_back(reader->ReadInt16());
+		entry->loop.states = reader->ReadArray<int16_t>(loopStateCnt);
 
 		entry->book.order = reader->ReadInt32();
 		entry->book.npredictors = reader->ReadInt32();
 
 		uint32_t bookSize = reader->ReadInt32();
 
-		for (uint32_t i = 0; i < bookSize; i++)
-			entry->book.books.push_back(reader->ReadInt16());
+		entry->book.books = reader->ReadArray<int16_t>(bookSize);
+	}
+
+	bool AudioSample::Predecode = false;
+	std::atomic<size_t> AudioSample::DecodedBytes = 0;
+
+	AudioSample::~AudioSample() {
+		DecodedBytes -= (decoded.size() + decodedLoop.size()) * sizeof(int16_t);
+	}
+
+	void AudioSample::Decode() {
+		// Codecs as numbered by the game, 0 is ADPCM and 3 the 2 bit variant.
+		const bool twoBit = codec == 3;
+		if ((codec != 0 && !twoBit) || book.order != 2 || !decoded.empty()) {
+			return;
+		}
+
+		const size_t frameSize = twoBit ? 5 : 9;
+		const size_t frames = data.size() / frameSize;
+		const size_t length = frames * 16;
+		if (frames == 0 || loop.end > length) {
+			return;
+		}
+
+		// When a loop that does not start on a frame wraps twice in one update, the decoder path places the samples after
+		// the second wrap a little early. Such loops stay with it so they keep sounding the same. An update takes at most
+		// 418 samples from a note, 208 output samples at twice the pitch.
+		if (loop.count != 0 && loop.start % 16 != 0 && loop.end - loop.start < 418) {
+			return;
+		}
+
+		const int bookBytes = book.books.size() * sizeof(int16_t);
+
+		// Decoding starts from silence, like a note does. The padding covers the synthesis copying in blocks of 16 bytes.
+		std::vector<int16_t> pcm(16 + length + 8);
+		aDecodeADPCM(data.data(), pcm.data() + 16, frames, twoBit, book.books.data(), bookBytes);
+		decoded.assign(pcm.begin() + 16, pcm.end());
+
+		if (loop.count != 0 && loop.start < loop.end) {
+			// Looping back plays loop.states for the frame loop.start is in and decodes the frames after it from there.
+			const size_t firstFrame = loop.start / 16;
+			std::vector<int16_t> looped(length - firstFrame * 16 + 8);
+
+			std::copy_n(loop.states.begin(), std::min<size_t>(loop.states.size(), 16), looped.begin());
+			aDecodeADPCM(data.data() + (firstFrame + 1) * frameSize, looped.data() + 16, frames - firstFrame - 1, twoBit,
+			             book.books.data(), bookBytes);
+			looped.erase(looped.begin(), looped.begin() + (loop.start - firstFrame * 16));
+
+			if (!std::equal(looped.begin(), looped.begin() + (loop.end - loop.start), decoded.begin() + loop.start)) {
+				decodedLoop = std::move(looped);
+			}
+		}
+
+		DecodedBytes += (decoded.size() + decodedLoop.size()) * sizeof(int16_t);
 	}
 
 	void AudioSoundFontV2::ParseFileBinary(BinaryReader* reader, Resource* res)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Resource.h"
+#include <atomic>
 #include <vector>
 #include <map>
 #include <string>
@@ -91,6 +92,8 @@ namespace Ship
 		uint8_t medium;
 		uint8_t cachePolicy;
 		std::vector<uint8_t> fonts;
+
+		size_t GetMemorySize() const override { return sizeof(*this) + seqData.capacity() + fonts.capacity(); }
 	};
 
 	class AudioSoundFont : public Resource
@@ -122,6 +125,24 @@ namespace Ship
 		std::vector<uint8_t> data;
 		AdpcmLoop loop;
 		AdpcmBook book;
+
+		// With Predecode set, ADPCM samples are decoded once when they are loaded. decoded holds the whole sample as the
+		// first pass plays it. decodedLoop holds loop.start onwards as it plays after looping back, which restarts from
+		// loop.states, and stays empty when that is no different. Both are padded with 8 samples of silence.
+		std::vector<int16_t> decoded;
+		std::vector<int16_t> decodedLoop;
+
+		static bool Predecode;
+		// Memory held by decoded and decodedLoop across all samples.
+		static std::atomic<size_t> DecodedBytes;
+
+		~AudioSample();
+
+		void Decode();
+
+		size_t GetMemorySize() const override {
+			return sizeof(*this) + data.capacity() + (decoded.capacity() + decodedLoop.capacity()) * sizeof(int16_t);
+		}
 	};
 
 	class Audio : public Resource
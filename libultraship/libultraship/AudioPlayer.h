@@ -15,6 +15,8 @@ namespace Ship {
 	};
 }
 
+#include "NullAudioPlayer.h"
+
 #ifdef _WIN32
 #include "WasapiAudioPlayer.h"
 #elif defined(__linux)
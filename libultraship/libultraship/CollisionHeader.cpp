@@ -17,25 +17,21 @@ void Ship::CollisionHeaderV0::ParseFileBinary(BinaryReader* reader, Resource* re
 	uint32_t vtxCnt = reader->ReadInt32();
 	col->vertices.reserve(vtxCnt);
 
+	std::vector<int16_t> vtxData = reader->ReadArray<int16_t>(vtxCnt * 3);
+
 	for (uint32_t i = 0; i < vtxCnt; i++)
-	{
-		float x = reader->ReadInt16();
-		float y = reader->ReadInt16();
-		float z = reader->ReadInt16();
-		col->vertices.push_back(Vec3f(x, y, z));
-	}
+		col->vertices.push_back(Vec3f(vtxData[i * 3 + 0], vtxData[i * 3 + 1], vtxData[i * 3 + 2]));
 
 	uint32_t polyCnt = reader->ReadUInt32();
 	col->polygons.reserve(polyCnt);
 
+	std::vector<uint16_t> polyData = reader->ReadArray<uint16_t>(polyCnt * 8);
+
 	for (uint32_t i = 0; i < polyCnt; i++)
-		col->polygons.push_back(Ship::PolygonEntry(reader));
+		col->polygons.push_back(Ship::PolygonEntry(&polyData[i * 8]));
 
 	uint32_t polyTypesCnt = reader->ReadUInt32();
-	col->polygonTypes.reserve(polyTypesCnt);
-
-	for (uint32_t i = 0; i < polyTypesCnt; i++)
-		col->polygonTypes.push_back(reader->ReadUInt64());
+	col->polygonTypes = reader->ReadArray<uint64_t>(polyTypesCnt);
 
 	col->camData = new CameraDataList();
 
@@ -54,12 +50,14 @@ void Ship::CollisionHeaderV0::ParseFileBinary(BinaryReader* reader, Resource* re
 	uint32_t camPosCnt = reader->ReadInt32();
 	col->camData->cameraPositionData.reserve(camPosCnt);
 
+	std::vector<int16_t> camPosData = reader->ReadArray<int16_t>(camPosCnt * 3);
+
 	for (uint32_t i = 0; i < camPosCnt; i++)
 	{
 		Ship::CameraPositionData* entry = new Ship::CameraPositionData();
-		entry->x = reader->ReadInt16();
-		entry->y = reader->ReadInt16();
-		entry->z = reader->ReadInt16();
+		entry->x = camPosData[i * 3 + 0];
+		entry->y = camPosData[i * 3 + 1];
+		entry->z = camPosData[i * 3 + 2];
 		col->camData->cameraPositionData.push_back(entry);
 	}
 
@@ -80,18 +78,18 @@ void Ship::CollisionHeaderV0::ParseFileBinary(BinaryReader* reader, Resource* re
 	}
 }
 
-Ship::PolygonEntry::PolygonEntry(BinaryReader* reader)
+Ship::PolygonEntry::PolygonEntry(const uint16_t* data)
 {
-	type = reader->ReadUInt16();
-	
-	vtxA = reader->ReadUInt16();
-	vtxB = reader->ReadUInt16();
-	vtxC = reader->ReadUInt16();
-	
-	a = reader->ReadUInt16();
-	b = reader->ReadUInt16();
-	c = reader->ReadUInt16();
-	d = reader->ReadUInt16();
+	type = data[0];
+
+	vtxA = data[1];
+	vtxB = data[2];
+	vtxC = data[3];
+
+	a = data[4];
+	b = data[5];
+	c = data[6];
+	d = data[7];
 }
 
 Ship::WaterBoxHeader::WaterBoxHeader()
@@ -16,7 +16,8 @@ namespace Ship
 		uint16_t vtxA, vtxB, vtxC;
 		uint16_t a, b, c, d;
 
-		PolygonEntry(BinaryReader* reader);
+		// Takes the eight 16-bit values of a polygon as stored in the resource.
+		PolygonEntry(const uint16_t* data);
 	};
 
 	class WaterBoxHeader
@@ -93,8 +93,9 @@ namespace Ship {
 		}
 		for (auto [key, var] : BindingToggle) {
 			if (ImGui::IsKeyPressed(key)) {
-				CVar* cvar = CVar_Get(var.c_str());
-				Dispatch("set " + var + " " + std::to_string(cvar == nullptr ? 0 : !static_cast<bool>(cvar->value.valueS32)));
+				CVar cvar;
+				const bool exists = CVar_GetCopy(var.c_str(), &cvar);
+				Dispatch("set " + var + " " + std::to_string(!exists ? 0 : !static_cast<bool>(cvar.value.valueS32)));
 			}
 		}
 	}
@@ -260,6 +261,32 @@ namespace Ship {
 
 	void Console::Dispatch(const std::string& line) {
 		this->CMDHint = NULLSTR;
+		this->Run([this, line]() { this->Execute(line); });
+	}
+
+	void Console::Run(std::function<void()> task) {
+		if (!this->QueueCommands) {
+			task();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->QueuedMutex);
+		this->Queued.push_back(std::move(task));
+	}
+
+	void Console::RunQueued() {
+		std::vector<std::function<void()>> tasks;
+		{
+			std::lock_guard<std::mutex> lock(this->QueuedMutex);
+			tasks.swap(this->Queued);
+		}
+
+		for (const auto& task : tasks) {
+			task();
+		}
+	}
+
+	void Console::Execute(const std::string& line) {
 		this->History.push_back(line);
 		this->Log[this->selected_channel].push_back({ "> " + line });
 		const std::vector<std::string> cmd_args = StringHelper::Split(line, " ");
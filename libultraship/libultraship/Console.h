@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <mutex>
 #include "Lib/ImGui/imgui.h"
 
 namespace Ship {
@@ -60,6 +61,9 @@ namespace Ship {
 			ImVec4(0.9f, 0.8f, 0.4f, 0.01f),
 			ImVec4(1.0f, 0.2f, 0.2f, 1.0f)
 		};
+		std::mutex QueuedMutex;
+		std::vector<std::function<void()>> Queued;
+		void Execute(const std::string& line);
 	public:
 		std::map<std::string, std::vector<ConsoleLine>> Log;
 		std::map<std::string, CommandEntry> Commands;
@@ -72,11 +76,17 @@ namespace Ship {
 		int HistoryIndex = -1;
 		std::string selected_channel = "Main";
 		bool opened = false;
+		// Set while the game runs on a thread of its own and the console is drawn on the render thread. Commands are
+		// then queued and run by RunQueued, which the game thread calls at the frame handoff.
+		bool QueueCommands = false;
 		void Init();
 		void Update();
 		void Draw();
 		void Append(const std::string& channel, Priority priority, const char* fmt, ...) IM_FMTARGS(4);
 		void Dispatch(const std::string& line);
+		// Runs task now, or at the next frame handoff while QueueCommands is set. For anything that touches game state.
+		void Run(std::function<void()> task);
+		void RunQueued();
 		static int CallbackStub(ImGuiInputTextCallbackData* data);
 	};
 }
\ No newline at end of file
@@ -3,19 +3,65 @@
 #include <string.h>
 #include <functional>
 #include <memory>
+#include <shared_mutex>
 #include <utility>
 #include <Utils/File.h>
 #include "GlobalCtx2.h"
 
 std::map<std::string, std::unique_ptr<CVar>, std::less<>> cvars;
+// With pipelined rendering the menus set CVars on the render thread while the game reads and sets them on its own, and
+// other threads such as the audio one read them too. The setters always hold the lock while they touch the map or a
+// CVar's type and value, and so do the getters, so a reader never sees a new type paired with the old value. The one
+// exception is the thread CVar_SetLockFreeReads was called on. A CVar itself is never removed so pointers to it stay
+// valid, and strings are never freed so a returned string stays valid after the CVar changes.
+static std::shared_mutex cvarsMutex;
+static thread_local bool cvarsLockFreeReads = false;
+
+static std::shared_lock<std::shared_mutex> CVar_ReadLock() {
+    if (cvarsLockFreeReads)
+        return std::shared_lock<std::shared_mutex>();
+
+    return std::shared_lock<std::shared_mutex>(cvarsMutex);
+}
 
-CVar* CVar_Get(const char* name) {
+void CVar_SetLockFreeReads() {
+    cvarsLockFreeReads = true;
+}
+
+// Callers hold cvarsMutex.
+static CVar* CVar_Find(const char* name) {
     auto it = cvars.find(name);
     return (it != cvars.end()) ? it->second.get() : nullptr;
 }
 
+// Returns the CVar for name, creating it if needed. Callers hold cvarsMutex exclusively.
+static CVar* CVar_GetOrCreate(const char* name) {
+    auto& cvar = cvars[name];
+    if (!cvar) {
+        cvar = std::make_unique<CVar>();
+    }
+    return cvar.get();
+}
+
+CVar* CVar_Get(const char* name) {
+    auto lock = CVar_ReadLock();
+    return CVar_Find(name);
+}
+
+bool CVar_GetCopy(const char* name, CVar* copy) {
+    auto lock = CVar_ReadLock();
+    CVar* cvar = CVar_Find(name);
+
+    if (cvar == nullptr)
+        return false;
+
+    *copy = *cvar;
+    return true;
+}
+
 extern "C" int32_t CVar_GetS32(const char* name, int32_t defaultValue) {
-    CVar* cvar = CVar_Get(name);
+    auto lock = CVar_ReadLock();
+    CVar* cvar = CVar_Find(name);
 
     if (cvar) {
         if (cvar->type == CVarType::S32)
@@ -26,7 +72,8 @@ extern "C" int32_t CVar_GetS32(const char* name, int32_t defaultValue) {
 }
 
 extern "C" float CVar_GetFloat(const char* name, float defaultValue) {
-    CVar* cvar = CVar_Get(name);
+    auto lock = CVar_ReadLock();
+    CVar* cvar = CVar_Find(name);
 
     if (cvar) {
         if (cvar->type == CVarType::Float)
@@ -37,7 +84,8 @@ extern "C" float CVar_GetFloat(const char* name, float defaultValue) {
 }
 
 extern "C" const char* CVar_GetString(const char* name, const char* defaultValue) {
-    CVar* cvar = CVar_Get(name);
+    auto lock = CVar_ReadLock();
+    CVar* cvar = CVar_Find(name);
 
     if (cvar) {
         if (cvar->type == CVarType::String)
@@ -66,7 +114,8 @@ extern "C" Color_RGB8 CVar_GetRGB(const char* name, Color_RGB8 defaultValue)
 }
 
 extern "C" Color_RGBA8 CVar_GetRGBA(const char* name, Color_RGBA8 defaultValue) {
-    CVar* cvar = CVar_Get(name);
+    auto lock = CVar_ReadLock();
+    CVar* cvar = CVar_Find(name);
 
     if (cvar != nullptr) {
         if (cvar->type == CVarType::RGBA)
@@ -78,44 +127,37 @@ extern "C" Color_RGBA8 CVar_GetRGBA(const char* name, Color_RGBA8 defaultValue)
 
 extern "C" void CVar_SetRGBA(const char* name, Color_RGBA8 value)
 {
-    auto& cvar = cvars[name];
-    if (!cvar) {
-        cvar = std::make_unique<CVar>();
-    }
+    std::unique_lock<std::shared_mutex> lock(cvarsMutex);
+    CVar* cvar = CVar_GetOrCreate(name);
 
     cvar->type = CVarType::RGBA;
     cvar->value.valueRGBA = value;
 }
 
 extern "C" void CVar_SetS32(const char* name, int32_t value) {
-    auto& cvar = cvars[name];
-    if (!cvar) {
-        cvar = std::make_unique<CVar>();
-    }
+    std::unique_lock<std::shared_mutex> lock(cvarsMutex);
+    CVar* cvar = CVar_GetOrCreate(name);
     cvar->type = CVarType::S32;
     cvar->value.valueS32 = value;
 }
 
 extern "C" void CVar_SetFloat(const char* name, float value) {
-    auto& cvar = cvars[name];
-    if (!cvar) {
-        cvar = std::make_unique<CVar>();
-    }
+    std::unique_lock<std::shared_mutex> lock(cvarsMutex);
+    CVar* cvar = CVar_GetOrCreate(name);
     cvar->type = CVarType::Float;
     cvar->value.valueFloat = value;
 }
 
 extern "C" void CVar_SetString(const char* name, const char* value) {
-    auto& cvar = cvars[name];
-    if (!cvar) {
-        cvar = std::make_unique<CVar>();
-    }
-    cvar->type = CVarType::String;
 #ifdef _MSC_VER
-    cvar->value.valueStr = _strdup(value);
+    const char* valueStr = _strdup(value);
 #else
-    cvar->value.valueStr = strdup(value);
+    const char* valueStr = strdup(value);
 #endif
+    std::unique_lock<std::shared_mutex> lock(cvarsMutex);
+    CVar* cvar = CVar_GetOrCreate(name);
+    cvar->type = CVarType::String;
+    cvar->value.valueStr = valueStr;
 }
 
 extern "C" void CVar_RegisterRGBA(const char* name, Color_RGBA8 defaultValue) {
@@ -236,6 +278,7 @@ extern "C" void CVar_Load() {
 extern "C" void CVar_Save()
 {
     std::shared_ptr<Mercury> pConf = Ship::GlobalCtx2::GetInstance()->GetConfig();
+    auto lock = CVar_ReadLock();
 
     for (const auto& cvar : cvars) {
         const std::string key = StringHelper::Sprintf("CVars.%s", cvar.first.c_str());
@@ -26,6 +26,12 @@ typedef struct CVar {
 } CVar;
 
 extern "C" CVar * CVar_Get(const char* name);
+// Copies the type and value of a CVar together, so another thread setting it can't be seen halfway. False if it doesn't
+// exist. Read values through this or the typed getters rather than through the pointer CVar_Get returns.
+bool CVar_GetCopy(const char* name, CVar* copy);
+// Lets the calling thread read CVars without taking the lock. Only call it on the one thread that sets CVars, which is the
+// main thread unless rendering is pipelined. The per-frame reads there then cost no more than a map lookup.
+void CVar_SetLockFreeReads();
 #endif
 
 #ifdef __cplusplus
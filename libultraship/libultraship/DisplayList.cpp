@@ -12,10 +12,16 @@ namespace Ship
 		while (reader->GetBaseAddress() % 8 != 0)
 			reader->ReadByte();
 
-		while (true)
+		// The end of the list is only known once G_ENDDL is reached, so everything left in the file is read at once.
+		const size_t wordCount = (reader->GetLength() - reader->GetBaseAddress()) / 8 * 2;
+		std::vector<uint32_t> words = reader->ReadArray<uint32_t>(wordCount);
+
+		dl->instructions.reserve(sizeof(uintptr_t) < 8 ? wordCount / 2 : wordCount);
+
+		for (size_t i = 0; i + 1 < wordCount; i += 2)
 		{
-			uint32_t w0 = reader->ReadUInt32();
-			uint32_t w1 = reader->ReadUInt32();
+			uint32_t w0 = words[i];
+			uint32_t w1 = words[i + 1];
 
 			if (sizeof(uintptr_t) < 8){
 				dl->instructions.push_back(((uint64_t) w0 << 32) | w1);
@@ -23,9 +29,10 @@ namespace Ship
 				uint8_t opcode = w0 >> 24;
 
 				// These are 128-bit commands, so read an extra 64 bits...
-				if (opcode == G_SETTIMG_OTR || opcode == G_DL_OTR || opcode == G_VTX_OTR || opcode == G_BRANCH_Z_OTR || opcode == G_MARKER || opcode == G_MTX_OTR) {
-					w0 = reader->ReadUInt32();
-					w1 = reader->ReadUInt32();
+				if ((opcode == G_SETTIMG_OTR || opcode == G_DL_OTR || opcode == G_VTX_OTR || opcode == G_BRANCH_Z_OTR || opcode == G_MARKER || opcode == G_MTX_OTR) && i + 3 < wordCount) {
+					i += 2;
+					w0 = words[i];
+					w1 = words[i + 1];
 
 					dl->instructions.push_back(((uint64_t) w0 << 32) | w1);
 				}
@@ -38,10 +45,11 @@ namespace Ship
 
 				uint8_t opcode = (uint8_t)(w0 >> 24);
 
-				if (opcode == G_SETTIMG_OTR || opcode == G_DL_OTR || opcode == G_VTX_OTR || opcode == G_BRANCH_Z_OTR || opcode == G_MARKER || opcode == G_MTX_OTR)
+				if ((opcode == G_SETTIMG_OTR || opcode == G_DL_OTR || opcode == G_VTX_OTR || opcode == G_BRANCH_Z_OTR || opcode == G_MARKER || opcode == G_MTX_OTR) && i + 3 < wordCount)
 				{
-					w0 = reader->ReadUInt32();
-					w1 = reader->ReadUInt32();
+					i += 2;
+					w0 = words[i];
+					w1 = words[i + 1];
 
 					dl->instructions.push_back(w0);
 					dl->instructions.push_back(w1);
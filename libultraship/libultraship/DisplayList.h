@@ -19,5 +19,7 @@ namespace Ship
     {
     public:
 		std::vector<uint64_t> instructions;
+
+		size_t GetMemorySize() const override { return sizeof(*this) + instructions.capacity() * sizeof(uint64_t); }
     };
 }
\ No newline at end of file
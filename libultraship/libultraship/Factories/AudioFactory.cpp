@@ -34,6 +34,10 @@ namespace Ship
         {
             AudioSampleV2 audioSampleFac = AudioSampleV2();
             audioSampleFac.ParseFileBinary(reader, audioSample);
+
+            if (AudioSample::Predecode) {
+                audioSample->Decode();
+            }
         }
         break;
         default:
@@ -13,7 +13,7 @@ namespace Ship {
 		std::shared_ptr<Archive> parent;
 		std::string path;
 		std::shared_ptr<char[]> buffer;
-		uint32_t dwBufferSize;
+		uint32_t dwBufferSize = 0;
 		bool bIsLoaded = false;
 		bool bHasLoadError = false;
 		std::condition_variable FileLoadNotifier;
@@ -159,22 +159,24 @@ namespace Ship {
 
 			if (overlay->type == OverlayType::TEXT) {
 				const char* text = ImStrdup(overlay->value);
-				const CVar* var = CVar_Get(text);
+				CVar var;
 				ImVec4 color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-				switch (var->type) {
-				case CVarType::Float:
-					this->TextDraw(30, textY, true, color, "%s %.2f", text, var->value.valueFloat);
-					break;
-				case CVarType::S32:
-					this->TextDraw(30, textY, true, color, "%s %d", text, var->value.valueS32);
-					break;
-				case CVarType::String:
-					this->TextDraw(30, textY, true, color, "%s %s", text, var->value.valueStr);
-					break;
-				case CVarType::RGBA:
-					this->TextDraw(30, textY, true, color, "#%08X", text, var->value.valueRGBA);
-					break;
+				if (CVar_GetCopy(text, &var)) {
+					switch (var.type) {
+					case CVarType::Float:
+						this->TextDraw(30, textY, true, color, "%s %.2f", text, var.value.valueFloat);
+						break;
+					case CVarType::S32:
+						this->TextDraw(30, textY, true, color, "%s %d", text, var.value.valueS32);
+						break;
+					case CVarType::String:
+						this->TextDraw(30, textY, true, color, "%s %s", text, var.value.valueStr);
+						break;
+					case CVarType::RGBA:
+						this->TextDraw(30, textY, true, color, "#%08X", text, var.value.valueRGBA);
+						break;
+					}
 				}
 
 				free((void*)text);
@@ -1,7 +1,9 @@
 #include "GlobalCtx2.h"
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include "ResourceMgr.h"
+#include "Audio.h"
 #include "Window.h"
 #include "spdlog/async.h"
 #include "spdlog/sinks/rotating_file_sink.h"
@@ -65,7 +67,13 @@ namespace Ship {
         MainPath = Config->getString("Game.Main Archive", GetPathRelativeToAppDirectory("oot.otr"));
         PatchesPath = Config->getString("Game.Patches Archive", GetAppDirectoryPath() + "/mods");
 
-        ResMan = std::make_shared<ResourceMgr>(GetInstance(), MainPath, PatchesPath);
+        // Read before any resource is, samples only check it as they load.
+        AudioSample::Predecode = Config->getBool("Game.Predecode Audio Samples", false);
+        // Each load thread is a pair of workers with its own archive handles, a negative count would wrap around.
+        const int ResourceLoadThreads = std::clamp(Config->getInt("Game.Resource Load Threads", 0), 0, 64);
+        ResMan = std::make_shared<ResourceMgr>(GetInstance(), MainPath, PatchesPath, ResourceLoadThreads,
+                                               Config->getBool("Game.Memory Map Archive", false), Config->getBool("Game.Resource Disk Cache", false));
+        ResMan->SetMemoryBudget((size_t)std::max(Config->getInt("Game.Resource Memory Budget", 0), 0) * 1024 * 1024);
         Win = std::make_shared<Window>(GetInstance());
 
         if (!ResMan->DidLoadSuccessfully())
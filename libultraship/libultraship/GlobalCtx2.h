@@ -24,6 +24,8 @@ namespace Ship {
 			std::shared_ptr<ResourceMgr> GetResourceManager() { return ResMan; }
 			std::shared_ptr<spdlog::logger> GetLogger() { return Logger; }
 			std::shared_ptr<Mercury> GetConfig() { return Config; }
+			std::string GetMainPath() { return MainPath; }
+			std::string GetPatchesPath() { return PatchesPath; }
 
 			static std::string GetAppDirectoryPath();
 			static std::string GetPathRelativeToAppDirectory(const char* path);
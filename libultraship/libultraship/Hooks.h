@@ -7,6 +7,7 @@
 
 namespace Ship {
     class Controller;
+    class Resource;
 
     template <typename H>
     struct RegisteredHooks {
@@ -31,4 +32,5 @@ namespace Ship {
     DEFINE_HOOK(LoadTexture, void(const char* path, uint8_t** texture));
     DEFINE_HOOK(GfxInit, void());
     DEFINE_HOOK(ExitGame, void());
+    DEFINE_HOOK(ResourceEvicted, void(Resource* resource));
 }
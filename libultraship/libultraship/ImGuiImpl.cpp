@@ -282,6 +282,14 @@ namespace SohImGui {
 
     void ImGuiBackendNewFrame() {
         switch (impl.backend) {
+        case Backend::Null:
+            // There is no renderer backend to build the font atlas, and ImGui refuses to start a frame without one.
+            if (!io->Fonts->IsBuilt()) {
+                unsigned char* pixels;
+                int width, height;
+                io->Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+            }
+            break;
 #ifdef __WIIU__
         case Backend::GX2:
             io->DeltaTime = (float) frametime / 1000.0f / 1000.0f;
@@ -459,6 +467,11 @@ namespace SohImGui {
         io->DisplaySize.y =  window_impl.gx2.height;
 #endif
 
+        if (window_impl.backend == Backend::Null) {
+            io->DisplaySize.x = window_impl.null.width;
+            io->DisplaySize.y = window_impl.null.height;
+        }
+
         lastBackendID = GetBackendID(GlobalCtx2::GetInstance()->GetConfig());
         if (CVar_GetS32("gOpenMenuBar", 0) != 1) {
             #if defined(__SWITCH__) || defined(__WIIU__)
@@ -911,13 +924,13 @@ namespace SohImGui {
         if ((ImGui::IsKeyDown(ImGuiKey_LeftSuper) ||
              ImGui::IsKeyDown(ImGuiKey_RightSuper)) &&
              ImGui::IsKeyPressed(ImGuiKey_R, false)) {
-            console->Commands["reset"].handler(emptyArgs);
+            console->Run([]() { console->Commands["reset"].handler(emptyArgs); });
         }
         #else
         if ((ImGui::IsKeyDown(ImGuiKey_LeftCtrl) ||
              ImGui::IsKeyDown(ImGuiKey_RightCtrl)) &&
              ImGui::IsKeyPressed(ImGuiKey_R, false)) {
-            console->Commands["reset"].handler(emptyArgs);
+            console->Run([]() { console->Commands["reset"].handler(emptyArgs); });
         }
         #endif
 
@@ -948,7 +961,7 @@ namespace SohImGui {
                     "Ctrl+R"
                     #endif
                     )) {
-                    console->Commands["reset"].handler(emptyArgs);
+                    console->Run([]() { console->Commands["reset"].handler(emptyArgs); });
                 }
                 ImGui::EndMenu();
             }
@@ -1617,7 +1630,7 @@ namespace SohImGui {
                         CVar_SetS32("gEnableBetaQuest", betaQuestEnabled);
                         CVar_SetS32("gBetaQuestWorld", betaQuestWorld);
 
-                        console->Commands["reset"].handler(emptyArgs);
+                        console->Run([]() { console->Commands["reset"].handler(emptyArgs); });
 
                         needs_save = true;
                     }
@@ -1846,6 +1859,23 @@ namespace SohImGui {
         }
     }
 
+    bool IsAnyMenuOpen() {
+        if (CVar_GetS32("gOpenMenuBar", 0) || console->opened) {
+            return true;
+        }
+
+        // Hidden windows only keep cosmetic CVars up to date.
+        for (const auto& category : windowCategories) {
+            for (const std::string& name : category.second) {
+                if (customWindows[name].enabled) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
     void BindCmd(const std::string& cmd, CommandEntry entry) {
         console->Commands[cmd] = std::move(entry);
     }
@@ -26,6 +26,7 @@ namespace SohImGui {
         DX11,
         SDL,
         GX2,
+        Null,
     };
 
     enum class Dialogues {
@@ -50,6 +51,10 @@ namespace SohImGui {
                 uint32_t width;
                 uint32_t height;
             } gx2;
+            struct {
+                uint32_t width;
+                uint32_t height;
+            } null;
         };
     } WindowImpl;
 
@@ -99,6 +104,8 @@ namespace SohImGui {
     void DrawFramebufferAndGameInput(void);
     void Render(void);
     void CancelFrame(void);
+    // True while the menu bar, the console or a window added with AddWindow is shown. Render thread only.
+    bool IsAnyMenuOpen(void);
     void ShowCursor(bool hide, Dialogues w);
     void BindCmd(const std::string& cmd, Ship::CommandEntry entry);
     void AddWindow(const std::string& category, const std::string& name, WindowDrawFunc drawFunc, bool isEnabled=false, bool isHidden=false);
@@ -170,6 +170,14 @@
 #define G_TEXRECT_WIDE          0x37
 #define G_FILLWIDERECT          0x38
 
+/*
+ * 128-bit G_*_OTR commands whose first word has this bit set keep the resource
+ * lookup table slot of the resource they reference in that word's w1, so repeat
+ * executions skip hashing and probing entirely. Bit 12 is unused by every opcode
+ * resolved this way, including the texture width of G_SETTIMG_OTR.
+ */
+#define G_OTR_RESOLVED          0x1000
+
 /* GFX Effects */
 
 // RDP Cmd
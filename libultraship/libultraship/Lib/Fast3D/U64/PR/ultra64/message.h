@@ -50,6 +50,7 @@ typedef struct OSMesgQueue {
     /* 0x0C */ s32 first;
     /* 0x10 */ s32 msgCount;
     /* 0x14 */ OSMesg* msg;
-} OSMesgQueue; // size = 0x18
+    /* 0x18 */ s32 next; // PC port: where the sender writes next, so it never reads the receiver's first
+} OSMesgQueue; // size = 0x1C
 
 #endif
@@ -31,6 +31,7 @@
 
 #include "gfx_cc.h"
 #include "gfx_rendering_api.h"
+#include "gfx_flat_map.h"
 #include "gfx_pc.h"
 #define DEBUG_D3D 0
 
@@ -122,7 +123,7 @@ static struct {
     PerFrameCB per_frame_cb_data;
     PerDrawCB per_draw_cb_data;
 
-    std::map<std::pair<uint64_t, uint32_t>, struct ShaderProgramD3D11> shader_program_pool;
+    GfxFlatMap<std::pair<uint64_t, uint32_t>, struct ShaderProgramD3D11, hash_shader_id> shader_program_pool;
 
     std::vector<struct TextureData> textures;
     int current_tile;
@@ -300,7 +301,7 @@ static void gfx_d3d11_init(void) {
     ZeroMemory(&vertex_buffer_desc, sizeof(D3D11_BUFFER_DESC));
 
     vertex_buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
-    vertex_buffer_desc.ByteWidth = 256 * 32 * 3 * sizeof(float); // Same as buf_vbo size in gfx_pc
+    vertex_buffer_desc.ByteWidth = 256 * 32 * 3 * sizeof(float); // Same as draw_vbo size in gfx_pc
     vertex_buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     vertex_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     vertex_buffer_desc.MiscFlags = 0;
@@ -508,8 +509,7 @@ static struct ShaderProgram *gfx_d3d11_create_and_load_new_shader(uint64_t shade
 }
 
 static struct ShaderProgram *gfx_d3d11_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
-    auto it = d3d.shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
-    return it == d3d.shader_program_pool.end() ? nullptr : (struct ShaderProgram *)&it->second;
+    return (struct ShaderProgram *)d3d.shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
 }
 
 static void gfx_d3d11_shader_get_info(struct ShaderProgram *prg, uint8_t *num_inputs, bool used_textures[2]) {
@@ -36,6 +36,7 @@
 #include "gfx_window_manager_api.h"
 #include "gfx_rendering_api.h"
 #include "gfx_direct3d_common.h"
+#include "gfx_flat_map.h"
 
 #include "gfx_screen_config.h"
 
@@ -43,6 +44,12 @@
 
 using namespace Microsoft::WRL; // For ComPtr
 
+struct hash_shader_id_d3d12 {
+    uint64_t operator()(uint32_t shader_id) const {
+        return shader_id;
+    }
+};
+
 namespace {
 
 struct ShaderProgramD3D12 {
@@ -103,8 +110,7 @@ static struct {
     HMODULE d3dcompiler_module;
     pD3DCompile D3DCompile;
     
-    struct ShaderProgramD3D12 shader_program_pool[64];
-    uint8_t shader_program_pool_size;
+    GfxFlatMap<uint32_t, struct ShaderProgramD3D12, hash_shader_id_d3d12> shader_program_pool;
     
     uint32_t current_width, current_height;
     
@@ -238,7 +244,7 @@ static struct ShaderProgram *gfx_direct3d12_create_and_load_new_shader(uint32_t
     fprintf(fp, "0x%08x\n", shader_id);
     fflush(fp);*/
     
-    struct ShaderProgramD3D12 *prg = &d3d.shader_program_pool[d3d.shader_program_pool_size++];
+    struct ShaderProgramD3D12 *prg = &d3d.shader_program_pool[shader_id];
     
     CCFeatures cc_features;
     gfx_cc_get_features(shader_id, &cc_features);
@@ -267,12 +273,7 @@ static struct ShaderProgram *gfx_direct3d12_create_and_load_new_shader(uint32_t
 }
 
 static struct ShaderProgram *gfx_direct3d12_lookup_shader(uint32_t shader_id) {
-    for (size_t i = 0; i < d3d.shader_program_pool_size; i++) {
-        if (d3d.shader_program_pool[i].shader_id == shader_id) {
-            return (struct ShaderProgram *)&d3d.shader_program_pool[i];
-        }
-    }
-    return nullptr;
+    return (struct ShaderProgram *)d3d.shader_program_pool.find(shader_id);
 }
 
 static void gfx_direct3d12_shader_get_info(struct ShaderProgram *prg, uint8_t *num_inputs, bool used_textures[2]) {
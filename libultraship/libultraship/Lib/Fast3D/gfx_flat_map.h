@@ -0,0 +1,117 @@
+#ifndef GFX_FLAT_MAP_H
+#define GFX_FLAT_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Insert only hash table for the small lookup tables hit on every render state change. Keys are probed linearly in one
+// flat array, and a direct mapped front cache ahead of it answers the few keys a frame keeps coming back to without
+// probing at all. Values are kept in a deque, so pointers to them stay valid while the table grows.
+// Hash returns a 64 bit hash, which does not need to be well distributed.
+template <typename Key, typename Value, typename Hash>
+class GfxFlatMap {
+public:
+    // Returns nullptr if the key was never inserted.
+    Value *find(const Key &key) {
+        const uint64_t hash = mix(key);
+        FrontEntry &front = front_cache[hash >> (64 - FRONT_CACHE_BITS)];
+        if (front.value != nullptr && front.key == key) {
+            return front.value;
+        }
+
+        if (slots.empty()) {
+            return nullptr;
+        }
+
+        for (size_t i = hash >> shift;; i = (i + 1) & (slots.size() - 1)) {
+            const Slot &slot = slots[i];
+            if (slot.value == nullptr) {
+                return nullptr;
+            }
+            if (slot.key == key) {
+                front.key = key;
+                front.value = slot.value;
+                return slot.value;
+            }
+        }
+    }
+
+    // Value initializes the entry if the key is not in the table yet.
+    Value &operator[](const Key &key) {
+        if (Value *value = find(key)) {
+            return *value;
+        }
+
+        // Kept at most 3/4 full so probe sequences stay short.
+        if ((values.size() + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+
+        Value *value = &values.emplace_back();
+        insert(key, value);
+        return *value;
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+
+private:
+    static constexpr int FRONT_CACHE_BITS = 3;
+    static constexpr int INITIAL_BITS = 6;
+
+    struct Slot {
+        Key key;
+        Value *value;
+    };
+
+    struct FrontEntry {
+        Key key;
+        Value *value;
+    };
+
+    // Spreads the hash over the high bits, which both tables are indexed by.
+    static uint64_t mix(const Key &key) {
+        return Hash{}(key) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    void insert(const Key &key, Value *value) {
+        size_t i = mix(key) >> shift;
+        while (slots[i].value != nullptr) {
+            i = (i + 1) & (slots.size() - 1);
+        }
+        slots[i].key = key;
+        slots[i].value = value;
+    }
+
+    void grow() {
+        std::vector<Slot> old_slots = std::move(slots);
+        const int bits = old_slots.empty() ? INITIAL_BITS : 64 - shift + 1;
+
+        slots.assign((size_t)1 << bits, Slot{ Key(), nullptr });
+        shift = 64 - bits;
+        for (const Slot &slot : old_slots) {
+            if (slot.value != nullptr) {
+                insert(slot.key, slot.value);
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    int shift = 64;
+    std::deque<Value> values;
+    FrontEntry front_cache[1 << FRONT_CACHE_BITS] = {};
+};
+
+// Hashes the (shader_id0, shader_id1) pair the rendering backends key their shader programs by.
+struct hash_shader_id {
+    uint64_t operator()(const std::pair<uint64_t, uint32_t> &id) const {
+        return id.first ^ ((uint64_t)id.second << 32 | id.second);
+    }
+};
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "gfx_cc.h"
 #include "gfx_rendering_api.h"
+#include "gfx_flat_map.h"
 #include "../../GlobalCtx2.h"
 #include "gfx_pc.h"
 #include "gfx_wiiu.h"
@@ -77,7 +78,7 @@ static struct Framebuffer main_framebuffer;
 static GX2DepthBuffer depthReadBuffer;
 static struct Framebuffer *current_framebuffer;
 
-static std::map<std::pair<uint64_t, uint32_t>, struct ShaderProgram> shader_program_pool;
+static GfxFlatMap<std::pair<uint64_t, uint32_t>, struct ShaderProgram, hash_shader_id> shader_program_pool;
 static struct ShaderProgram *current_shader_program;
 
 static struct Texture *current_texture;
@@ -221,8 +222,7 @@ static struct ShaderProgram* gfx_gx2_create_and_load_new_shader(uint64_t shader_
 }
 
 static struct ShaderProgram *gfx_gx2_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
-    auto it = shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
-    return it == shader_program_pool.end() ? nullptr : &it->second;
+    return shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
 }
 
 static void gfx_gx2_shader_get_info(struct ShaderProgram *prg, uint8_t *num_inputs, bool used_textures[2]) {
@@ -0,0 +1,318 @@
+
+#include <chrono>
+
+#include "PR/ultra64/gbi.h"
+
+#include "gfx_null.h"
+#include "gfx_cc.h"
+#include "gfx_pc.h"
+#include "gfx_flat_map.h"
+#include "../../ImGuiImpl.h"
+#include "../../GlobalCtx2.h"
+#include "../../Hooks.h"
+
+#define NULL_WINDOW_WIDTH 640
+#define NULL_WINDOW_HEIGHT 480
+
+struct ShaderProgram {
+    uint8_t num_inputs;
+    bool used_textures[2];
+};
+
+static GfxFlatMap<std::pair<uint64_t, uint32_t>, struct ShaderProgram, hash_shader_id> shader_program_pool;
+static struct ShaderProgram* current_shader_program;
+static uint32_t next_texture_id = 1;
+static int next_framebuffer_id = 1;
+static FilteringMode current_filter_mode = FILTER_THREE_POINT;
+static struct GfxNullStats stats;
+
+static uint32_t window_width = NULL_WINDOW_WIDTH;
+static uint32_t window_height = NULL_WINDOW_HEIGHT;
+static uint64_t frame_limit;
+static uint64_t frame_count;
+static std::chrono::steady_clock::time_point start_time;
+
+struct GfxNullStats gfx_null_get_stats(void) {
+    return stats;
+}
+
+void gfx_null_reset_stats(void) {
+    stats = {};
+}
+
+static struct GfxClipParameters gfx_null_get_clip_parameters(void) {
+    return { false, false };
+}
+
+static void gfx_null_unload_shader(struct ShaderProgram* old_prg) {
+}
+
+static void gfx_null_load_shader(struct ShaderProgram* new_prg) {
+    if (new_prg != current_shader_program) {
+        current_shader_program = new_prg;
+        stats.shader_switches++;
+    }
+}
+
+static struct ShaderProgram* gfx_null_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    struct CCFeatures cc_features;
+    gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
+
+    struct ShaderProgram* prg = &shader_program_pool[std::make_pair(shader_id0, shader_id1)];
+    prg->num_inputs = cc_features.num_inputs;
+    prg->used_textures[0] = cc_features.used_textures[0];
+    prg->used_textures[1] = cc_features.used_textures[1];
+    stats.shaders_created++;
+
+    gfx_null_load_shader(prg);
+    return prg;
+}
+
+static struct ShaderProgram* gfx_null_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    return shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
+}
+
+static void gfx_null_shader_get_info(struct ShaderProgram* prg, uint8_t* num_inputs, bool used_textures[2]) {
+    *num_inputs = prg->num_inputs;
+    used_textures[0] = prg->used_textures[0];
+    used_textures[1] = prg->used_textures[1];
+}
+
+static uint32_t gfx_null_new_texture(void) {
+    return next_texture_id++;
+}
+
+static void gfx_null_delete_texture(uint32_t texID) {
+}
+
+static void gfx_null_select_texture(int tile, uint32_t texture_id) {
+}
+
+static void gfx_null_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    stats.texture_uploads++;
+    stats.texture_upload_bytes += (uint64_t)width * height * 4;
+}
+
+static void gfx_null_set_sampler_parameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) {
+}
+
+static void gfx_null_set_depth_test_and_mask(bool depth_test, bool z_upd) {
+}
+
+static void gfx_null_set_zmode_decal(bool zmode_decal) {
+}
+
+static void gfx_null_set_viewport(int x, int y, int width, int height) {
+}
+
+static void gfx_null_set_scissor(int x, int y, int width, int height) {
+}
+
+static void gfx_null_set_use_alpha(bool use_alpha) {
+}
+
+static void gfx_null_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    stats.draw_calls++;
+    stats.triangles += buf_vbo_num_tris;
+}
+
+static void gfx_null_draw_indexed_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_verts, uint16_t buf_ibo[], size_t buf_ibo_num_tris) {
+    stats.draw_calls++;
+    stats.triangles += buf_ibo_num_tris;
+}
+
+static void gfx_null_init(void) {
+}
+
+static void gfx_null_on_resize(void) {
+}
+
+static void gfx_null_start_frame(void) {
+    current_shader_program = nullptr;
+}
+
+static void gfx_null_end_frame(void) {
+    stats.frames++;
+    frame_count++;
+}
+
+static void gfx_null_finish_render(void) {
+}
+
+static int gfx_null_create_framebuffer() {
+    return next_framebuffer_id++;
+}
+
+static void gfx_null_update_framebuffer_parameters(int fb_id, uint32_t width, uint32_t height, uint32_t msaa_level, bool opengl_invert_y, bool render_target, bool has_depth_buffer, bool can_extract_depth) {
+}
+
+static void gfx_null_start_draw_to_framebuffer(int fb_id, float noise_scale) {
+    stats.framebuffer_switches++;
+}
+
+static void gfx_null_clear_framebuffer(void) {
+}
+
+static void gfx_null_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
+}
+
+static std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> gfx_null_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
+
+    // Nothing is ever drawn, so every pixel reads back as a freshly cleared depth buffer would.
+    for (const auto& coordinate : coordinates) {
+        res.emplace(coordinate, 0xFFFC);
+    }
+
+    return res;
+}
+
+static void* gfx_null_get_framebuffer_texture_id(int fb_id) {
+    return (void*)(uintptr_t)fb_id;
+}
+
+static void gfx_null_select_texture_fb(int fb_id) {
+}
+
+static void gfx_null_set_texture_filter(FilteringMode mode) {
+    current_filter_mode = mode;
+    gfx_texture_cache_clear();
+}
+
+static FilteringMode gfx_null_get_texture_filter(void) {
+    return current_filter_mode;
+}
+
+static void gfx_null_wapi_init(const char* game_name, bool start_in_fullscreen, uint32_t width, uint32_t height) {
+    window_width = width != 0 ? width : NULL_WINDOW_WIDTH;
+    window_height = height != 0 ? height : NULL_WINDOW_HEIGHT;
+
+    // Stops the main loop after this many frames, 0 runs until the game exits.
+    frame_limit = Ship::GlobalCtx2::GetInstance()->GetConfig()->getInt("Window.Null.FrameLimit", 0);
+    start_time = std::chrono::steady_clock::now();
+
+    SohImGui::WindowImpl window_impl;
+    window_impl.backend = SohImGui::Backend::Null;
+    window_impl.null.width = window_width;
+    window_impl.null.height = window_height;
+    SohImGui::Init(window_impl);
+}
+
+static void gfx_null_wapi_set_keyboard_callbacks(bool (*on_key_down)(int scancode), bool (*on_key_up)(int scancode), void (*on_all_keys_up)(void)) {
+}
+
+static void gfx_null_wapi_set_fullscreen_changed_callback(void (*on_fullscreen_changed)(bool is_now_fullscreen)) {
+}
+
+static void gfx_null_wapi_set_fullscreen(bool enable) {
+}
+
+static void gfx_null_wapi_show_cursor(bool hide) {
+}
+
+static void gfx_null_wapi_main_loop(void (*run_one_game_iter)(void)) {
+    while (frame_limit == 0 || frame_count < frame_limit) {
+        run_one_game_iter();
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    const double frames = stats.frames != 0 ? (double)stats.frames : 1.0;
+
+    SPDLOG_INFO("gfx_null: {} frames in {:.2f} s ({:.1f} fps)", stats.frames, elapsed, stats.frames / elapsed);
+    SPDLOG_INFO("gfx_null: per frame {:.1f} draw calls, {:.1f} triangles, {:.2f} texture uploads ({:.1f} KB), {:.1f} shader switches",
+                stats.draw_calls / frames, stats.triangles / frames, stats.texture_uploads / frames,
+                stats.texture_upload_bytes / frames / 1024.0, stats.shader_switches / frames);
+
+    Ship::ExecuteHooks<Ship::ExitGame>();
+}
+
+static void gfx_null_wapi_get_dimensions(uint32_t* width, uint32_t* height) {
+    *width = window_width;
+    *height = window_height;
+}
+
+static void gfx_null_wapi_handle_events(void) {
+}
+
+static bool gfx_null_wapi_start_frame(void) {
+    return true;
+}
+
+static void gfx_null_wapi_swap_buffers_begin(void) {
+}
+
+static void gfx_null_wapi_swap_buffers_end(void) {
+}
+
+static double gfx_null_wapi_get_time(void) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+static void gfx_null_wapi_set_target_fps(int fps) {
+}
+
+static void gfx_null_wapi_set_maximum_frame_latency(int latency) {
+}
+
+static float gfx_null_wapi_get_detected_hz(void) {
+    return 0;
+}
+
+static const char* gfx_null_wapi_get_key_name(int scancode) {
+    return "";
+}
+
+struct GfxRenderingAPI gfx_null_api = {
+    gfx_null_get_clip_parameters,
+    gfx_null_unload_shader,
+    gfx_null_load_shader,
+    gfx_null_create_and_load_new_shader,
+    gfx_null_lookup_shader,
+    gfx_null_shader_get_info,
+    gfx_null_new_texture,
+    gfx_null_select_texture,
+    gfx_null_upload_texture,
+    gfx_null_set_sampler_parameters,
+    gfx_null_set_depth_test_and_mask,
+    gfx_null_set_zmode_decal,
+    gfx_null_set_viewport,
+    gfx_null_set_scissor,
+    gfx_null_set_use_alpha,
+    gfx_null_draw_triangles,
+    gfx_null_init,
+    gfx_null_on_resize,
+    gfx_null_start_frame,
+    gfx_null_end_frame,
+    gfx_null_finish_render,
+    gfx_null_create_framebuffer,
+    gfx_null_update_framebuffer_parameters,
+    gfx_null_start_draw_to_framebuffer,
+    gfx_null_clear_framebuffer,
+    gfx_null_resolve_msaa_color_buffer,
+    gfx_null_get_pixel_depth,
+    gfx_null_get_framebuffer_texture_id,
+    gfx_null_select_texture_fb,
+    gfx_null_delete_texture,
+    gfx_null_set_texture_filter,
+    gfx_null_get_texture_filter,
+    gfx_null_draw_indexed_triangles
+};
+
+struct GfxWindowManagerAPI gfx_null_wapi = {
+    gfx_null_wapi_init,
+    gfx_null_wapi_set_keyboard_callbacks,
+    gfx_null_wapi_set_fullscreen_changed_callback,
+    gfx_null_wapi_set_fullscreen,
+    gfx_null_wapi_show_cursor,
+    gfx_null_wapi_main_loop,
+    gfx_null_wapi_get_dimensions,
+    gfx_null_wapi_handle_events,
+    gfx_null_wapi_start_frame,
+    gfx_null_wapi_swap_buffers_begin,
+    gfx_null_wapi_swap_buffers_end,
+    gfx_null_wapi_get_time,
+    gfx_null_wapi_set_target_fps,
+    gfx_null_wapi_set_maximum_frame_latency,
+    gfx_null_wapi_get_detected_hz,
+    gfx_null_wapi_get_key_name
+};
@@ -0,0 +1,27 @@
+#ifndef GFX_NULL_H
+#define GFX_NULL_H
+
+#include "gfx_rendering_api.h"
+#include "gfx_window_manager_api.h"
+
+// Headless backend: accepts every call without touching a window or GPU, so gfx_run can be driven at uncapped
+// speed on machines without one. Selected with Window.GfxBackend set to "null".
+struct GfxNullStats {
+    uint64_t frames;
+    uint64_t draw_calls;
+    uint64_t triangles;
+    uint64_t texture_uploads;
+    uint64_t texture_upload_bytes;
+    uint64_t shader_switches;
+    uint64_t shaders_created;
+    uint64_t framebuffer_switches;
+};
+
+// Totals since startup or the last gfx_null_reset_stats.
+struct GfxNullStats gfx_null_get_stats(void);
+void gfx_null_reset_stats(void);
+
+extern struct GfxRenderingAPI gfx_null_api;
+extern struct GfxWindowManagerAPI gfx_null_wapi;
+
+#endif
@@ -5,8 +5,11 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <filesystem>
 #include <map>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #ifndef _LANGUAGE_C
 #define _LANGUAGE_C
@@ -43,6 +46,7 @@
 
 #include "gfx_cc.h"
 #include "gfx_rendering_api.h"
+#include "gfx_flat_map.h"
 #include "../../ImGuiImpl.h"
 #include "../../GlobalCtx2.h"
 #include "gfx_pc.h"
@@ -71,8 +75,19 @@ struct Framebuffer {
     GLuint fbo, clrbuf, clrbuf_msaa, rbo;
 };
 
-static map<pair<uint64_t, uint32_t>, struct ShaderProgram> shader_program_pool;
+struct ProgramBinary {
+    uint64_t source_hash; // Of the shader sources the binary was linked from
+    GLenum format;
+    vector<uint8_t> data;
+};
+
+static GfxFlatMap<pair<uint64_t, uint32_t>, struct ShaderProgram, hash_shader_id> shader_program_pool;
+#define PROGRAM_BINARY_MAGIC 0x32424750 // "PGB2"
+static bool program_binaries_supported;
+static string program_binary_path;
+static map<pair<uint64_t, uint32_t>, ProgramBinary> program_binaries; // Loaded from program_binary_path, not linked yet
 static GLuint opengl_vbo;
+static GLuint opengl_ibo;
 #ifdef __APPLE__
 static GLuint opengl_vao;
 #endif
@@ -218,6 +233,223 @@ static void append_formula(char *buf, size_t *len, uint8_t c[2][4], bool do_sing
     }
 }
 
+// Identifies the driver program binaries were built by, any other driver may not load them.
+static string gfx_opengl_driver_id(void) {
+    return string((const char*)glGetString(GL_VENDOR)) + "/" + (const char*)glGetString(GL_RENDERER) + "/" + (const char*)glGetString(GL_VERSION);
+}
+
+// FNV-1a over the generated shader sources. A record whose sources no longer match is stale and gets relinked.
+static uint64_t gfx_opengl_source_hash(const char* vs_buf, size_t vs_len, const char* fs_buf, size_t fs_len) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const auto& [buf, len] : { make_pair(vs_buf, vs_len), make_pair(fs_buf, fs_len) }) {
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ (uint8_t)buf[i]) * 0x100000001B3ULL;
+        }
+    }
+    return hash;
+}
+
+// The program binary cache starts with the driver id and holds one record per linked program: shader ids, source hash,
+// binary format and size, then the binary. Records are appended as programs are first linked, a later record for the
+// same shader ids replaces an earlier one, such as one linked from what an older shader generator produced.
+static void gfx_opengl_write_program_binary_header(FILE* file) {
+    const string driver_id = gfx_opengl_driver_id();
+    const uint32_t magic = PROGRAM_BINARY_MAGIC;
+    const uint32_t driver_id_len = driver_id.size();
+    fwrite(&magic, sizeof(magic), 1, file);
+    fwrite(&driver_id_len, sizeof(driver_id_len), 1, file);
+    fwrite(driver_id.data(), 1, driver_id_len, file);
+}
+
+static void gfx_opengl_write_program_binary(FILE* file, uint64_t shader_id0, uint32_t shader_id1, const ProgramBinary& binary) {
+    const uint32_t format32 = binary.format;
+    const uint32_t size = binary.data.size();
+    fwrite(&shader_id0, sizeof(shader_id0), 1, file);
+    fwrite(&shader_id1, sizeof(shader_id1), 1, file);
+    fwrite(&binary.source_hash, sizeof(binary.source_hash), 1, file);
+    fwrite(&format32, sizeof(format32), 1, file);
+    fwrite(&size, sizeof(size), 1, file);
+    fwrite(binary.data.data(), 1, size, file);
+}
+
+// Writes only the records that were loaded, dropping the ones they replaced, through a temporary file so a crash can't
+// leave a truncated cache behind.
+static void gfx_opengl_compact_program_binaries(void) {
+    const string temp_path = program_binary_path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL) {
+        return;
+    }
+
+    gfx_opengl_write_program_binary_header(file);
+    for (const auto& [id, binary] : program_binaries) {
+        gfx_opengl_write_program_binary(file, id.first, id.second, binary);
+    }
+
+    std::error_code error;
+    if (ferror(file) != 0 || fclose(file) != 0) {
+        std::filesystem::remove(temp_path, error);
+        return;
+    }
+
+    std::filesystem::rename(temp_path, program_binary_path, error);
+}
+
+static void gfx_opengl_load_program_binaries(void) {
+    FILE* file = fopen(program_binary_path.c_str(), "rb");
+    if (file == NULL) {
+        return;
+    }
+
+    const string driver_id = gfx_opengl_driver_id();
+    uint32_t magic = 0;
+    uint32_t driver_id_len = 0;
+    bool valid = fread(&magic, sizeof(magic), 1, file) == 1 && magic == PROGRAM_BINARY_MAGIC &&
+                 fread(&driver_id_len, sizeof(driver_id_len), 1, file) == 1 && driver_id_len == driver_id.size();
+    if (valid) {
+        string file_driver_id(driver_id_len, '\0');
+        valid = fread(&file_driver_id[0], 1, driver_id_len, file) == driver_id_len && file_driver_id == driver_id;
+    }
+
+    // Records replaced by a later one, or cut short.
+    bool dropped = false;
+
+    while (valid) {
+        uint64_t shader_id0, source_hash;
+        uint32_t shader_id1, format, size;
+        if (fread(&shader_id0, sizeof(shader_id0), 1, file) != 1 || fread(&shader_id1, sizeof(shader_id1), 1, file) != 1 ||
+            fread(&source_hash, sizeof(source_hash), 1, file) != 1 || fread(&format, sizeof(format), 1, file) != 1 ||
+            fread(&size, sizeof(size), 1, file) != 1) {
+            break;
+        }
+
+        if (program_binaries.count(make_pair(shader_id0, shader_id1)) != 0) {
+            dropped = true;
+        }
+
+        ProgramBinary& binary = program_binaries[make_pair(shader_id0, shader_id1)];
+        binary.source_hash = source_hash;
+        binary.format = format;
+        binary.data.resize(size);
+        if (fread(binary.data.data(), 1, size, file) != size) {
+            program_binaries.erase(make_pair(shader_id0, shader_id1));
+            dropped = true;
+            break;
+        }
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        // Built by another driver or version, start over
+        program_binaries.clear();
+        remove(program_binary_path.c_str());
+    } else if (dropped) {
+        gfx_opengl_compact_program_binaries();
+    }
+}
+
+static GLuint gfx_opengl_load_program_binary(uint64_t shader_id0, uint32_t shader_id1, uint64_t source_hash) {
+    auto it = program_binaries.find(make_pair(shader_id0, shader_id1));
+    if (it == program_binaries.end()) {
+        return 0;
+    }
+
+    // Linked from what an older shader generator produced.
+    if (it->second.source_hash != source_hash) {
+        program_binaries.erase(it);
+        return 0;
+    }
+
+    GLuint shader_program = glCreateProgram();
+    glProgramBinary(shader_program, it->second.format, it->second.data.data(), it->second.data.size());
+    program_binaries.erase(it);
+
+    GLint success;
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(shader_program);
+        return 0;
+    }
+
+    return shader_program;
+}
+
+static void gfx_opengl_save_program_binary(uint64_t shader_id0, uint32_t shader_id1, uint64_t source_hash, GLuint shader_program) {
+    if (!program_binaries_supported || program_binary_path.empty()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(shader_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    ProgramBinary binary;
+    binary.source_hash = source_hash;
+    binary.data.resize(length);
+    glGetProgramBinary(shader_program, length, NULL, &binary.format, binary.data.data());
+
+    FILE* file = fopen(program_binary_path.c_str(), "ab");
+    if (file == NULL) {
+        return;
+    }
+
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        gfx_opengl_write_program_binary_header(file);
+    }
+
+    // Replacing a record for the same shader ids leaves the old one behind until the next start compacts the file.
+    gfx_opengl_write_program_binary(file, shader_id0, shader_id1, binary);
+    fclose(file);
+}
+
+static GLuint gfx_opengl_compile_program(const char *vs_buf, size_t vs_len, const char *fs_buf, size_t fs_len) {
+    const GLchar *sources[2] = { vs_buf, fs_buf };
+    const GLint lengths[2] = { (GLint) vs_len, (GLint) fs_len };
+    GLint success;
+
+    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &sources[0], &lengths[0]);
+    glCompileShader(vertex_shader);
+    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint max_length = 0;
+        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &max_length);
+        char error_log[1024];
+        //fprintf(stderr, "Vertex shader compilation failed\n");
+        glGetShaderInfoLog(vertex_shader, max_length, &max_length, &error_log[0]);
+        //fprintf(stderr, "%s\n", &error_log[0]);
+        abort();
+    }
+
+    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &sources[1], &lengths[1]);
+    glCompileShader(fragment_shader);
+    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint max_length = 0;
+        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &max_length);
+        char error_log[1024];
+        fprintf(stderr, "Fragment shader compilation failed\n");
+        glGetShaderInfoLog(fragment_shader, max_length, &max_length, &error_log[0]);
+        fprintf(stderr, "%s\n", &error_log[0]);
+        abort();
+    }
+
+    GLuint shader_program = glCreateProgram();
+    glAttachShader(shader_program, vertex_shader);
+    glAttachShader(shader_program, fragment_shader);
+    if (program_binaries_supported) {
+        glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(shader_program);
+
+    return shader_program;
+}
+
 static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
     struct CCFeatures cc_features;
     gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
@@ -503,43 +735,13 @@ static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shad
     puts(fs_buf);
     puts("End");*/
 
-    const GLchar *sources[2] = { vs_buf, fs_buf };
-    const GLint lengths[2] = { (GLint) vs_len, (GLint) fs_len };
-    GLint success;
-
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &sources[0], &lengths[0]);
-    glCompileShader(vertex_shader);
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        //fprintf(stderr, "Vertex shader compilation failed\n");
-        glGetShaderInfoLog(vertex_shader, max_length, &max_length, &error_log[0]);
-        //fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
-    }
-
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &sources[1], &lengths[1]);
-    glCompileShader(fragment_shader);
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        fprintf(stderr, "Fragment shader compilation failed\n");
-        glGetShaderInfoLog(fragment_shader, max_length, &max_length, &error_log[0]);
-        fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
+    const uint64_t source_hash = gfx_opengl_source_hash(vs_buf, vs_len, fs_buf, fs_len);
+    GLuint shader_program = gfx_opengl_load_program_binary(shader_id0, shader_id1, source_hash);
+    if (shader_program == 0) {
+        shader_program = gfx_opengl_compile_program(vs_buf, vs_len, fs_buf, fs_len);
+        gfx_opengl_save_program_binary(shader_id0, shader_id1, source_hash, shader_program);
     }
 
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
-
     size_t cnt = 0;
 
     struct ShaderProgram* prg = &shader_program_pool[make_pair(shader_id0, shader_id1)];
@@ -616,8 +818,7 @@ static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shad
 }
 
 static struct ShaderProgram *gfx_opengl_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
-    auto it = shader_program_pool.find(make_pair(shader_id0, shader_id1));
-    return it == shader_program_pool.end() ? nullptr : &it->second;
+    return shader_program_pool.find(make_pair(shader_id0, shader_id1));
 }
 
 static void gfx_opengl_shader_get_info(struct ShaderProgram *prg, uint8_t *num_inputs, bool used_textures[2]) {
@@ -715,13 +916,28 @@ static void gfx_opengl_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_
     glDrawArrays(GL_TRIANGLES, 0, 3 * buf_vbo_num_tris);
 }
 
+static void gfx_opengl_draw_indexed_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_verts, uint16_t buf_ibo[], size_t buf_ibo_num_tris) {
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * buf_vbo_len, buf_vbo, GL_STREAM_DRAW);
+    // Bound on every draw, the menu renderer binds its own index buffer between frames.
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, opengl_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * 3 * buf_ibo_num_tris, buf_ibo, GL_STREAM_DRAW);
+    glDrawElements(GL_TRIANGLES, 3 * buf_ibo_num_tris, GL_UNSIGNED_SHORT, 0);
+}
+
 static void gfx_opengl_init(void) {
 #ifndef __SWITCH__
     glewInit();
+    program_binaries_supported = GLEW_ARB_get_program_binary;
 #endif
 
+    if (program_binaries_supported && Ship::GlobalCtx2::GetInstance()->GetConfig()->getBool("Window.ShaderCache", true)) {
+        program_binary_path = Ship::GlobalCtx2::GetPathRelativeToAppDirectory("shaders_opengl.cache");
+        gfx_opengl_load_program_binaries();
+    }
+
     glGenBuffers(1, &opengl_vbo);
     glBindBuffer(GL_ARRAY_BUFFER, opengl_vbo);
+    glGenBuffers(1, &opengl_ibo);
 
 #ifdef __APPLE__
     glGenVertexArrays(1, &opengl_vao);
@@ -980,7 +1196,8 @@ struct GfxRenderingAPI gfx_opengl_api = {
     gfx_opengl_select_texture_fb,
     gfx_opengl_delete_texture,
     gfx_opengl_set_texture_filter,
-    gfx_opengl_get_texture_filter
+    gfx_opengl_get_texture_filter,
+    gfx_opengl_draw_indexed_triangles
 };
 
 #endif
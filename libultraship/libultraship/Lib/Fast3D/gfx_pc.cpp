@@ -6,11 +6,28 @@
 #include <assert.h>
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define GFX_SIMD_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define GFX_SIMD_NEON
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <vector>
 #include <list>
+#include <tuple>
 
 #ifndef _LANGUAGE_C
 #define _LANGUAGE_C
@@ -27,6 +44,7 @@
 #include "gfx_window_manager_api.h"
 #include "gfx_rendering_api.h"
 #include "gfx_screen_config.h"
+#include "gfx_flat_map.h"
 #include "../../Hooks.h"
 
 #include "../../luslog.h"
@@ -42,7 +60,10 @@ extern "C" {
     int32_t* ResourceMgr_LoadMtxByCRC(uint64_t crc);
     Vtx* ResourceMgr_LoadVtxByCRC(uint64_t crc);
     Gfx* ResourceMgr_LoadGfxByCRC(uint64_t crc);
+    Gfx* ResourceMgr_LoadGfxByOTRCmd(Gfx* cmd);
+    int32_t* ResourceMgr_LoadMtxByOTRCmd(Gfx* cmd);
     char* ResourceMgr_LoadTexByCRC(uint64_t crc);
+    char* ResourceMgr_LoadTexByOTRCmd(Gfx* cmd);
     void ResourceMgr_RegisterResourcePatch(uint64_t hash, uint32_t instrIndex, uintptr_t origData);
     char* ResourceMgr_LoadTexByName(char* texPath);
     int ResourceMgr_OTRSigCheck(char* imgData);
@@ -71,7 +92,8 @@ using namespace std;
 #define RATIO_X (gfx_current_dimensions.width / (2.0f * HALF_SCREEN_WIDTH))
 #define RATIO_Y (gfx_current_dimensions.height / (2.0f * HALF_SCREEN_HEIGHT))
 
-#define MAX_BUFFERED 256
+#define MAX_BUFFERED 256 // Triangles per draw call, the backends size their vertex buffers for this
+#define MAX_DEFERRED 4096 // Triangles recorded before the draw list has to be submitted
 //#define MAX_LIGHTS 2
 #define MAX_LIGHTS 32
 #define MAX_VERTICES 64
@@ -93,6 +115,19 @@ static struct {
     TextureCacheMap map;
     list<TextureCacheMapIter> lru;
     vector<uint32_t> free_texture_ids;
+
+    bool content_hash;
+    size_t budget;
+    size_t bytes;
+    uint64_t hits, misses, upload_bytes;
+
+    // Content hashes computed this frame, by texture address. Hashing is only needed once per address and frame,
+    // and G_INVALTEXCACHE just has to drop the address from here.
+    struct ContentHash {
+        TextureCacheKey key;
+        uint64_t hash;
+    };
+    unordered_map<const uint8_t*, ContentHash> content_hashes;
 } gfx_texture_cache;
 
 struct ColorCombiner {
@@ -103,8 +138,13 @@ struct ColorCombiner {
     uint8_t shader_input_mapping[2][7];
 };
 
-static unordered_map<uint64_t, struct ColorCombiner> color_combiner_pool;
-static unordered_map<uint64_t, struct ColorCombiner>::iterator prev_combiner = color_combiner_pool.end();
+struct hash_cc_id {
+    uint64_t operator()(uint64_t cc_id) const {
+        return cc_id;
+    }
+};
+
+static GfxFlatMap<uint64_t, struct ColorCombiner, hash_cc_id> color_combiner_pool;
 
 static struct RSP {
     float modelview_matrix_stack[11][4][4];
@@ -168,20 +208,48 @@ static struct RDP {
     uint8_t prim_lod_fraction;
     struct RGBA env_color, prim_color, fog_color, fill_color, grayscale_color;
     struct XYWidthHeight viewport, scissor;
-    bool viewport_or_scissor_changed;
     void *z_buf_address;
     void *color_image_address;
 } rdp;
 
+// What the rendering backend currently has set.
 static struct RenderingState {
     uint8_t depth_test_and_mask; // 1: depth test, 2: depth mask
     bool decal_mode;
     bool alpha_blend;
     struct XYWidthHeight viewport, scissor;
     struct ShaderProgram *shader_program;
-    TextureCacheNode *textures[2];
+    uint32_t texture_ids[2];
 } rendering_state;
 
+// Everything a run of triangles is drawn with. Texture slots the combiner does not use are left empty.
+struct DrawState {
+    struct ShaderProgram *shader_program;
+    TextureCacheNode *textures[2];
+    bool linear_filter[2];
+    uint8_t cms[2], cmt[2];
+    uint8_t depth_test_and_mask;
+    bool decal_mode;
+    bool alpha_blend;
+    struct XYWidthHeight viewport, scissor;
+
+    bool operator==(const DrawState&) const noexcept = default;
+};
+
+struct DrawBatch {
+    DrawState state;
+    bool reorderable;
+    size_t vbo_offset, vbo_len; // In floats, into buf_vbo
+    size_t ibo_offset; // Into buf_ibo, indices count from the batch's first vertex
+    size_t num_verts;
+    size_t num_tris;
+};
+
+// Texture cache entries last imported into each texture slot
+static TextureCacheNode *texture_slots[2];
+// Slot 0 holds the framebuffer bound by G_SETTIMG_FB rather than texture_slots[0]
+static bool texture_fb_bound;
+
 struct GfxDimensions gfx_current_window_dimensions;
 struct GfxDimensions gfx_current_dimensions;
 static struct GfxDimensions gfx_prev_dimensions;
@@ -199,13 +267,36 @@ static bool dropped_frame;
 
 static const std::unordered_map<Mtx *, MtxF> *current_mtx_replacements;
 
-static float buf_vbo[MAX_BUFFERED * (32 * 3)]; // 3 vertices in a triangle and 32 floats per vtx
+// Triangles are recorded into buf_vbo as a list of batches and only drawn when gfx_flush submits them, which happens
+// before the backend is used for anything else than drawing (framebuffer switches, texture eviction, end of frame).
+static float buf_vbo[MAX_DEFERRED * (32 * 3)]; // 3 vertices in a triangle and 32 floats per vtx
 static size_t buf_vbo_len;
 static size_t buf_vbo_num_tris;
+static uint16_t buf_ibo[MAX_DEFERRED * 3];
+static size_t buf_ibo_len;
+static vector<DrawBatch> draw_list;
+static float draw_vbo[MAX_BUFFERED * (32 * 3)]; // Batches drawn with the same state are merged here
+static uint16_t draw_ibo[MAX_BUFFERED * 3];
+static vector<uint16_t> vertex_remap;
+
+// Index each loaded vertex was last output at in the current batch, so triangles sharing it reuse the output when the
+// backend draws indexed. Entries from an older epoch are stale: the epoch advances with every new batch and with every
+// display list command that is not a triangle, as any of those may change what a vertex outputs.
+static struct {
+    uint32_t epoch;
+    uint16_t index;
+} vertex_outputs[MAX_VERTICES + 4];
+static uint32_t vertex_output_epoch = 1;
+static bool draw_reordering;
+static struct GfxDrawStats draw_stats;
 
 static struct GfxWindowManagerAPI *gfx_wapi;
 static struct GfxRenderingAPI *gfx_rapi;
 
+#define SHADER_CACHE_MAGIC 0x31434853 // "SHC1"
+static string shader_cache_path;
+static struct GfxShaderStats shader_stats;
+
 static int markerOn;
 static uintptr_t segmentPointers[16];
 
@@ -237,32 +328,277 @@ static unsigned long get_time(void) {
 }
 #endif
 
+static void gfx_draw_triangles(float* vbo, size_t num_tris, size_t floats_per_tri) {
+    gfx_rapi->draw_triangles(vbo, num_tris * floats_per_tri, num_tris);
+    draw_stats.draw_calls++;
+}
+
+static void gfx_draw_indexed_triangles(float* vbo, size_t num_verts, size_t floats_per_vtx, uint16_t* ibo, size_t num_tris) {
+    gfx_rapi->draw_indexed_triangles(vbo, num_verts * floats_per_vtx, num_verts, ibo, num_tris);
+    draw_stats.draw_calls++;
+}
+
+// Draws draw_list[begin, end), which share their state. Without indexed drawing no vertex is shared, so the batches
+// are plain triangle lists.
+static void gfx_draw_group(size_t begin, size_t end) {
+    // The shader decides the vertex layout, so every batch of the group has the same one.
+    size_t floats_per_tri = draw_list[begin].vbo_len / draw_list[begin].num_tris;
+    size_t staged = 0;
+
+    for (size_t i = begin; i < end; i++) {
+        float* vbo = buf_vbo + draw_list[i].vbo_offset;
+        size_t num_tris = draw_list[i].num_tris;
+
+        while (num_tris > 0) {
+            size_t n;
+            if (staged == 0 && (num_tris >= MAX_BUFFERED || i + 1 == end)) {
+                // Nothing to merge with, draw straight from buf_vbo
+                n = min(num_tris, (size_t)MAX_BUFFERED);
+                gfx_draw_triangles(vbo, n, floats_per_tri);
+            } else {
+                n = min(num_tris, MAX_BUFFERED - staged);
+                memcpy(draw_vbo + staged * floats_per_tri, vbo, n * floats_per_tri * sizeof(float));
+                staged += n;
+                if (staged == MAX_BUFFERED) {
+                    gfx_draw_triangles(draw_vbo, staged, floats_per_tri);
+                    staged = 0;
+                }
+            }
+            vbo += n * floats_per_tri;
+            num_tris -= n;
+        }
+    }
+
+    if (staged > 0) {
+        gfx_draw_triangles(draw_vbo, staged, floats_per_tri);
+    }
+}
+
+// Indexed version of gfx_draw_group. Batches are merged by appending their vertices and offsetting their indices, and
+// batches with more triangles than one draw takes are split, copying the vertices each part uses.
+static void gfx_draw_indexed_group(size_t begin, size_t end) {
+    size_t floats_per_vtx = draw_list[begin].vbo_len / draw_list[begin].num_verts;
+    size_t staged_verts = 0;
+    size_t staged_tris = 0;
+
+    auto draw_staged = [&]() {
+        if (staged_tris > 0) {
+            gfx_draw_indexed_triangles(draw_vbo, staged_verts, floats_per_vtx, draw_ibo, staged_tris);
+        }
+        staged_verts = 0;
+        staged_tris = 0;
+    };
+
+    for (size_t i = begin; i < end; i++) {
+        const DrawBatch& batch = draw_list[i];
+        float* vbo = buf_vbo + batch.vbo_offset;
+        uint16_t* ibo = buf_ibo + batch.ibo_offset;
+
+        // A triangle uses at most three vertices, so staying within MAX_BUFFERED triangles keeps the vertices in
+        // draw_vbo as well.
+        if (batch.num_tris <= MAX_BUFFERED) {
+            if (begin + 1 == end) {
+                gfx_draw_indexed_triangles(vbo, batch.num_verts, floats_per_vtx, ibo, batch.num_tris);
+                continue;
+            }
+            if (staged_tris + batch.num_tris > MAX_BUFFERED) {
+                draw_staged();
+            }
+            memcpy(draw_vbo + staged_verts * floats_per_vtx, vbo, batch.vbo_len * sizeof(float));
+            for (size_t k = 0; k < batch.num_tris * 3; k++) {
+                draw_ibo[staged_tris * 3 + k] = ibo[k] + staged_verts;
+            }
+            staged_verts += batch.num_verts;
+            staged_tris += batch.num_tris;
+            continue;
+        }
+
+        draw_staged();
+        vertex_remap.assign(batch.num_verts, UINT16_MAX);
+        for (size_t t = 0; t < batch.num_tris; t++) {
+            if (staged_tris == MAX_BUFFERED) {
+                draw_staged();
+                fill(vertex_remap.begin(), vertex_remap.end(), UINT16_MAX);
+            }
+            for (size_t k = 0; k < 3; k++) {
+                uint16_t index = ibo[t * 3 + k];
+                if (vertex_remap[index] == UINT16_MAX) {
+                    memcpy(draw_vbo + staged_verts * floats_per_vtx, vbo + index * floats_per_vtx, floats_per_vtx * sizeof(float));
+                    vertex_remap[index] = staged_verts++;
+                }
+                draw_ibo[staged_tris * 3 + k] = vertex_remap[index];
+            }
+            staged_tris++;
+        }
+        draw_staged();
+    }
+
+    draw_staged();
+}
+
+static void gfx_apply_draw_state(const DrawState& state) {
+    if (state.shader_program != rendering_state.shader_program) {
+        gfx_rapi->unload_shader(rendering_state.shader_program);
+        gfx_rapi->load_shader(state.shader_program);
+        rendering_state.shader_program = state.shader_program;
+        draw_stats.state_switches++;
+    }
+    if (state.alpha_blend != rendering_state.alpha_blend) {
+        gfx_rapi->set_use_alpha(state.alpha_blend);
+        rendering_state.alpha_blend = state.alpha_blend;
+        draw_stats.state_switches++;
+    }
+    if (state.depth_test_and_mask != rendering_state.depth_test_and_mask) {
+        gfx_rapi->set_depth_test_and_mask((state.depth_test_and_mask & 1) != 0, (state.depth_test_and_mask & 2) != 0);
+        rendering_state.depth_test_and_mask = state.depth_test_and_mask;
+        draw_stats.state_switches++;
+    }
+    if (state.decal_mode != rendering_state.decal_mode) {
+        gfx_rapi->set_zmode_decal(state.decal_mode);
+        rendering_state.decal_mode = state.decal_mode;
+        draw_stats.state_switches++;
+    }
+    if (!(state.viewport == rendering_state.viewport)) {
+        gfx_rapi->set_viewport(state.viewport.x, state.viewport.y, state.viewport.width, state.viewport.height);
+        rendering_state.viewport = state.viewport;
+        draw_stats.state_switches++;
+    }
+    if (!(state.scissor == rendering_state.scissor)) {
+        gfx_rapi->set_scissor(state.scissor.x, state.scissor.y, state.scissor.width, state.scissor.height);
+        rendering_state.scissor = state.scissor;
+        draw_stats.state_switches++;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        TextureCacheNode* node = state.textures[i];
+        if (node == nullptr) {
+            continue;
+        }
+
+        // Sampler parameters belong to the texture, and some backends apply them to the last selected one.
+        bool sampler_changed = state.linear_filter[i] != node->second.linear_filter || state.cms[i] != node->second.cms || state.cmt[i] != node->second.cmt;
+        if (node->second.texture_id != rendering_state.texture_ids[i] || sampler_changed) {
+            gfx_rapi->select_texture(i, node->second.texture_id);
+            rendering_state.texture_ids[i] = node->second.texture_id;
+            draw_stats.state_switches++;
+        }
+        if (sampler_changed) {
+            gfx_rapi->set_sampler_parameters(i, state.linear_filter[i], state.cms[i], state.cmt[i]);
+            node->second.linear_filter = state.linear_filter[i];
+            node->second.cms = state.cms[i];
+            node->second.cmt = state.cmt[i];
+            draw_stats.state_switches++;
+        }
+    }
+}
+
 static void gfx_flush(void) {
-    if (buf_vbo_len > 0) {
-        int num = buf_vbo_num_tris;
-        unsigned long t0 = get_time();
+    if (draw_list.empty()) {
+        return;
+    }
 
-        if (markerOn)
-        {
-            int bp = 0;
+    if (draw_reordering) {
+        // Opaque triangles that test and write depth come out the same in whatever order they are drawn (save for
+        // exact depth ties), so runs of them are grouped by shader and textures. Other triangles keep their place.
+        auto key = [](const DrawBatch& batch) {
+            return make_tuple((uintptr_t)batch.state.shader_program, (uintptr_t)batch.state.textures[0], (uintptr_t)batch.state.textures[1]);
+        };
+        for (auto run = draw_list.begin(); run != draw_list.end();) {
+            auto run_end = find_if(run, draw_list.end(), [](const DrawBatch& batch) { return !batch.reorderable; });
+            stable_sort(run, run_end, [&](const DrawBatch& a, const DrawBatch& b) { return key(a) < key(b); });
+            run = run_end == draw_list.end() ? run_end : run_end + 1;
+        }
+    }
+
+    for (size_t i = 0; i < draw_list.size();) {
+        const DrawState& state = draw_list[i].state;
+        size_t end = i + 1;
+        while (end < draw_list.size() && draw_list[end].state == state) {
+            end++;
         }
 
-        gfx_rapi->draw_triangles(buf_vbo, buf_vbo_len, buf_vbo_num_tris);
-        buf_vbo_len = 0;
-        buf_vbo_num_tris = 0;
-        unsigned long t1 = get_time();
-        /*if (t1 - t0 > 1000) {
-            printf("f: %d %d\n", num, (int)(t1 - t0));
-        }*/
+        gfx_apply_draw_state(state);
+
+        if (gfx_rapi->draw_indexed_triangles != nullptr) {
+            gfx_draw_indexed_group(i, end);
+        } else {
+            gfx_draw_group(i, end);
+        }
+        i = end;
+    }
+
+    draw_stats.batches += draw_list.size();
+    draw_stats.triangles += buf_vbo_num_tris;
+    draw_list.clear();
+    buf_vbo_len = 0;
+    buf_vbo_num_tris = 0;
+    buf_ibo_len = 0;
+    vertex_output_epoch++;
+}
+
+static struct ShaderProgram *gfx_create_shader_program(uint64_t shader_id0, uint32_t shader_id1) {
+    gfx_rapi->unload_shader(rendering_state.shader_program);
+    struct ShaderProgram *prg = gfx_rapi->create_and_load_new_shader(shader_id0, shader_id1);
+    rendering_state.shader_program = prg;
+    return prg;
+}
+
+// Lists the shader ids of every program created so far, so the next run can create them before its first frame. Only
+// appended to, a record at a time. Bump the magic whenever the meaning of shader ids changes in gfx_cc.
+static void gfx_shader_cache_append(uint64_t shader_id0, uint32_t shader_id1) {
+    if (shader_cache_path.empty()) {
+        return;
+    }
+
+    FILE* file = fopen(shader_cache_path.c_str(), "ab");
+    if (file == NULL) {
+        return;
+    }
+
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        const uint32_t magic = SHADER_CACHE_MAGIC;
+        fwrite(&magic, sizeof(magic), 1, file);
+    }
+    fwrite(&shader_id0, sizeof(shader_id0), 1, file);
+    fwrite(&shader_id1, sizeof(shader_id1), 1, file);
+    fclose(file);
+}
+
+static void gfx_shader_cache_precompile(void) {
+    FILE* file = shader_cache_path.empty() ? NULL : fopen(shader_cache_path.c_str(), "rb");
+    if (file == NULL) {
+        return;
+    }
+
+    uint32_t magic = 0;
+    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != SHADER_CACHE_MAGIC) {
+        fclose(file);
+        remove(shader_cache_path.c_str());
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t shader_id0;
+    uint32_t shader_id1;
+    while (fread(&shader_id0, sizeof(shader_id0), 1, file) == 1 && fread(&shader_id1, sizeof(shader_id1), 1, file) == 1) {
+        if (gfx_rapi->lookup_shader(shader_id0, shader_id1) == NULL && gfx_create_shader_program(shader_id0, shader_id1) != NULL) {
+            shader_stats.precompiled++;
+        }
     }
+    fclose(file);
+
+    shader_stats.precompile_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 static struct ShaderProgram *gfx_lookup_or_create_shader_program(uint64_t shader_id0, uint32_t shader_id1) {
     struct ShaderProgram *prg = gfx_rapi->lookup_shader(shader_id0, shader_id1);
     if (prg == NULL) {
-        gfx_rapi->unload_shader(rendering_state.shader_program);
-        prg = gfx_rapi->create_and_load_new_shader(shader_id0, shader_id1);
-        rendering_state.shader_program = prg;
+        auto start = std::chrono::steady_clock::now();
+        prg = gfx_create_shader_program(shader_id0, shader_id1);
+        shader_stats.compiled++;
+        shader_stats.compile_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        gfx_shader_cache_append(shader_id0, shader_id1);
     }
     return prg;
 }
@@ -491,27 +827,132 @@ static void gfx_generate_cc(struct ColorCombiner *comb, uint64_t cc_id) {
 }
 
 static struct ColorCombiner *gfx_lookup_or_create_color_combiner(uint64_t cc_id) {
-    if (prev_combiner != color_combiner_pool.end() && prev_combiner->first == cc_id) {
-        return &prev_combiner->second;
+    if (struct ColorCombiner *comb = color_combiner_pool.find(cc_id)) {
+        return comb;
     }
+    gfx_flush();
+    struct ColorCombiner *comb = &color_combiner_pool[cc_id];
+    gfx_generate_cc(comb, cc_id);
+    return comb;
+}
 
-    prev_combiner = color_combiner_pool.find(cc_id);
-    if (prev_combiner != color_combiner_pool.end()) {
-        return &prev_combiner->second;
-    }
+// Triangles not submitted yet may still sample the texture, and the slots it is loaded into have to import it again.
+static void gfx_texture_cache_release(TextureCacheNode* node) {
     gfx_flush();
-    prev_combiner = color_combiner_pool.insert(make_pair(cc_id, ColorCombiner())).first;
-    gfx_generate_cc(&prev_combiner->second, cc_id);
-    return &prev_combiner->second;
+    for (int i = 0; i < 2; i++) {
+        if (node == nullptr || texture_slots[i] == node) {
+            texture_slots[i] = nullptr;
+            rdp.textures_changed[i] = true;
+        }
+    }
 }
 
 void gfx_texture_cache_clear()
 {
+    gfx_texture_cache_release(nullptr);
     for (const auto& entry : gfx_texture_cache.map) {
         gfx_texture_cache.free_texture_ids.push_back(entry.second.texture_id);
     }
     gfx_texture_cache.map.clear();
     gfx_texture_cache.lru.clear();
+    gfx_texture_cache.content_hashes.clear();
+    gfx_texture_cache.bytes = 0;
+}
+
+void gfx_texture_cache_set_mode(bool content_hash, size_t budget) {
+    gfx_texture_cache_clear();
+    gfx_texture_cache.content_hash = content_hash;
+    gfx_texture_cache.budget = budget;
+}
+
+struct GfxTextureCacheStats gfx_texture_cache_get_stats(void) {
+    return { gfx_texture_cache.hits, gfx_texture_cache.misses, gfx_texture_cache.upload_bytes,
+             gfx_texture_cache.map.size(), gfx_texture_cache.bytes, gfx_texture_cache.budget };
+}
+
+// xxHash64 style hash: four independent lanes over 8 byte words, folded together with the tail at the end.
+static uint64_t gfx_hash_bytes(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t prime3 = 0x165667B19E3779F9ULL;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&](uint64_t acc, uint64_t word) { return rotl(acc + word * prime2, 31) * prime1; };
+
+    uint64_t h;
+    size_t i = 0;
+
+    if (size >= 32) {
+        uint64_t lanes[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        for (; i + 32 <= size; i += 32) {
+            for (int lane = 0; lane < 4; lane++) {
+                uint64_t word;
+                memcpy(&word, data + i + lane * 8, 8);
+                lanes[lane] = round(lanes[lane], word);
+            }
+        }
+
+        h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        for (int lane = 0; lane < 4; lane++) {
+            h = (h ^ round(0, lanes[lane])) * prime1 + prime3;
+        }
+    } else {
+        h = seed + prime3;
+    }
+
+    h += size;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = rotl(h ^ round(0, word), 27) * prime1 + prime3;
+    }
+    for (; i < size; i++) {
+        h = rotl(h ^ (data[i] * prime3), 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Hashes exactly the bytes the importer for the tile's format reads, palette included.
+static uint64_t gfx_hash_texture(int tile) {
+    const auto& loaded = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index];
+    uint8_t fmt = rdp.texture_tile[tile].fmt;
+    uint8_t siz = rdp.texture_tile[tile].siz;
+
+    if (fmt == G_IM_FMT_CI && siz == G_IM_SIZ_8b) {
+        uint32_t rows = (loaded.size_bytes + loaded.line_size_bytes - 1) / loaded.line_size_bytes;
+        uint64_t hash = 0;
+        bool upper_half = false;
+
+        for (uint32_t y = 0; y < rows; y++) {
+            const uint8_t* row = loaded.addr + y * loaded.full_image_line_size_bytes;
+            hash = gfx_hash_bytes(row, loaded.line_size_bytes, hash);
+            for (uint32_t x = 0; x < loaded.line_size_bytes; x++) {
+                upper_half |= (row[x] & 0x80) != 0;
+            }
+        }
+
+        hash = gfx_hash_bytes(rdp.palettes[0], 128 * 2, hash);
+        return upper_half ? gfx_hash_bytes(rdp.palettes[1], 128 * 2, hash) : hash;
+    }
+
+    uint64_t hash = gfx_hash_bytes(loaded.addr, loaded.size_bytes, 0);
+
+    if (fmt == G_IM_FMT_CI) {
+        uint32_t pal_idx = rdp.texture_tile[tile].palette;
+        hash = gfx_hash_bytes(rdp.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2, 16 * 2, hash);
+    }
+
+    return hash;
+}
+
+static void gfx_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    gfx_texture_cache.upload_bytes += (uint64_t)width * height * 4;
+    gfx_rapi->upload_texture(rgba32_buf, width, height);
 }
 
 static bool gfx_texture_cache_lookup(int i, int tile) {
@@ -519,7 +960,7 @@ static bool gfx_texture_cache_lookup(int i, int tile) {
     uint8_t siz = rdp.texture_tile[tile].siz;
     uint32_t tmem_index = rdp.texture_tile[tile].tmem_index;
 
-    TextureCacheNode** n = &rendering_state.textures[i];
+    TextureCacheNode** n = &texture_slots[i];
     const uint8_t* orig_addr = rdp.loaded_texture[tmem_index].addr;
     uint8_t palette_index = rdp.texture_tile[tile].palette;
 
@@ -530,21 +971,52 @@ static bool gfx_texture_cache_lookup(int i, int tile) {
         key = { orig_addr, { }, fmt, siz, palette_index };
     }
 
+    uint32_t size_bytes = rdp.loaded_texture[tmem_index].size_bytes;
+    uint32_t line_size_bytes = rdp.texture_tile[tile].line_size_bytes;
+
+    if (gfx_texture_cache.content_hash) {
+        key.size_bytes = size_bytes;
+        key.line_size_bytes = rdp.loaded_texture[tmem_index].full_image_line_size_bytes;
+
+        auto hashed = gfx_texture_cache.content_hashes.find(orig_addr);
+        if (hashed == gfx_texture_cache.content_hashes.end() || !(hashed->second.key == key)) {
+            hashed = gfx_texture_cache.content_hashes.insert_or_assign(orig_addr, decltype(gfx_texture_cache)::ContentHash{ key, gfx_hash_texture(tile) }).first;
+        }
+
+        // The width the texture is uploaded with comes from the tile, so it is part of what makes two textures equal.
+        key = { nullptr, { }, fmt, siz, 0, hashed->second.hash, size_bytes, line_size_bytes };
+    }
+
     TextureCacheMap::iterator it = gfx_texture_cache.map.find(key);
 
     if (it != gfx_texture_cache.map.end()) {
-        gfx_rapi->select_texture(i, it->second.texture_id);
         *n = &*it;
         gfx_texture_cache.lru.splice(gfx_texture_cache.lru.end(), gfx_texture_cache.lru, it->second.lru_location); // move to back
+        gfx_texture_cache.hits++;
         return true;
     }
 
-    if (gfx_texture_cache.map.size() >= TEXTURE_CACHE_MAX_SIZE) {
-        // Remove the texture that was least recently used
-        it = gfx_texture_cache.lru.front().it;
+    gfx_texture_cache.misses++;
+
+    // Every format is expanded to RGBA32, except RGBA32 itself which is uploaded as is.
+    uint32_t upload_bytes = siz == G_IM_SIZ_32b ? size_bytes : size_bytes * 8 / (4 << siz) * 4;
+
+    auto victim = gfx_texture_cache.lru.begin();
+    while (victim != gfx_texture_cache.lru.end() &&
+           (gfx_texture_cache.budget != 0 ? gfx_texture_cache.bytes + upload_bytes > gfx_texture_cache.budget
+                                          : gfx_texture_cache.map.size() >= TEXTURE_CACHE_MAX_SIZE)) {
+        // Remove the texture that was least recently used, unless it is bound for the draw being set up. Importing
+        // tile 1 must not take away the texture just imported for tile 0.
+        it = victim->it;
+        if (&*it == texture_slots[0] || &*it == texture_slots[1]) {
+            ++victim;
+            continue;
+        }
+        gfx_texture_cache_release(&*it);
         gfx_texture_cache.free_texture_ids.push_back(it->second.texture_id);
+        gfx_texture_cache.bytes -= it->second.upload_bytes;
         gfx_texture_cache.map.erase(it);
-        gfx_texture_cache.lru.pop_front();
+        victim = gfx_texture_cache.lru.erase(victim);
     }
 
     uint32_t texture_id;
@@ -558,24 +1030,35 @@ static bool gfx_texture_cache_lookup(int i, int tile) {
     it = gfx_texture_cache.map.insert(make_pair(key, TextureCacheValue())).first;
     TextureCacheNode* node = &*it;
     node->second.texture_id = texture_id;
+    node->second.upload_bytes = upload_bytes;
+    gfx_texture_cache.bytes += upload_bytes;
     node->second.lru_location = gfx_texture_cache.lru.insert(gfx_texture_cache.lru.end(), { it });
 
     gfx_rapi->select_texture(i, texture_id);
     gfx_rapi->set_sampler_parameters(i, false, 0, 0);
+    rendering_state.texture_ids[i] = texture_id;
     *n = node;
     return false;
 }
 
-static void gfx_texture_cache_delete(const uint8_t* orig_addr)
+void gfx_texture_cache_delete(const uint8_t* orig_addr)
 {
+    // Entries keyed by content never go stale, only the hash remembered for the address does.
+    if (gfx_texture_cache.content_hash) {
+        gfx_texture_cache.content_hashes.erase(orig_addr);
+        return;
+    }
+
     while (gfx_texture_cache.map.bucket_count() > 0) {
         TextureCacheKey key = { orig_addr, {0}, 0, 0 }; // bucket index only depends on the address
         size_t bucket = gfx_texture_cache.map.bucket(key);
         bool again = false;
         for (auto it = gfx_texture_cache.map.begin(bucket); it != gfx_texture_cache.map.end(bucket); ++it) {
             if (it->first.texture_addr == orig_addr) {
+                gfx_texture_cache_release(&*it);
                 gfx_texture_cache.lru.erase(it->second.lru_location);
                 gfx_texture_cache.free_texture_ids.push_back(it->second.texture_id);
+                gfx_texture_cache.bytes -= it->second.upload_bytes;
                 gfx_texture_cache.map.erase(it->first);
                 again = true;
                 break;
@@ -587,30 +1070,202 @@ static void gfx_texture_cache_delete(const uint8_t* orig_addr)
     }
 }
 
+// Shared by the importers below, big enough for the largest texture any of them converts.
+static uint8_t rgba32_buf[480 * 240 * 4];
+
+// RGBA32 texels for every possible input byte of the formats that pack one or two texels into a byte.
+static const struct TextureConversionTables {
+    uint8_t ia4[256][8];
+    uint8_t i4[256][8];
+    uint8_t ia8[256][4];
+
+    TextureConversionTables() {
+        for (int byte = 0; byte < 256; byte++) {
+            for (int half = 0; half < 2; half++) {
+                uint8_t part = (byte >> (4 - half * 4)) & 0xf;
+                uint8_t intensity = SCALE_3_8(part >> 1);
+                uint8_t* ia = &ia4[byte][half * 4];
+                ia[0] = ia[1] = ia[2] = intensity;
+                ia[3] = (part & 1) ? 255 : 0;
+
+                uint8_t* i = &i4[byte][half * 4];
+                i[0] = i[1] = i[2] = i[3] = SCALE_4_8(part);
+            }
+
+            ia8[byte][0] = ia8[byte][1] = ia8[byte][2] = SCALE_4_8(byte >> 4);
+            ia8[byte][3] = SCALE_4_8(byte & 0xf);
+        }
+    }
+} texture_conversion_tables;
+
+static void convert_texture_rgba16(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    uint32_t i = 0;
+
+    // SCALE_5_8(x) is exactly (x * 1053) >> 7 for every 5-bit x, which keeps the vector math in 16 bits.
+#if defined(GFX_SIMD_SSE2)
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i scale = _mm_set1_epi16(1053);
+    const __m128i one = _mm_set1_epi16(1);
+    for (; i + 8 <= n_texels; i += 8) {
+        __m128i col16 = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        col16 = _mm_or_si128(_mm_slli_epi16(col16, 8), _mm_srli_epi16(col16, 8)); // Big endian load
+        __m128i r = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(col16, 11), scale), 7);
+        __m128i g = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(col16, 6), mask5), scale), 7);
+        __m128i b = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(col16, 1), mask5), scale), 7);
+        __m128i a = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(col16, one));
+        __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+#elif defined(GFX_SIMD_NEON)
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    for (; i + 8 <= n_texels; i += 8) {
+        uint16x8_t col16 = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + 2 * i))); // Big endian load
+        uint8x8x4_t rgba;
+        rgba.val[0] = vmovn_u16(vshrq_n_u16(vmulq_n_u16(vshrq_n_u16(col16, 11), 1053), 7));
+        rgba.val[1] = vmovn_u16(vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(col16, 6), mask5), 1053), 7));
+        rgba.val[2] = vmovn_u16(vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(col16, 1), mask5), 1053), 7));
+        rgba.val[3] = vmovn_u16(vtstq_u16(col16, vdupq_n_u16(1)));
+        vst4_u8(dst + 4 * i, rgba);
+    }
+#endif
+
+    for (; i < n_texels; i++) {
+        uint16_t col16 = (src[2 * i] << 8) | src[2 * i + 1];
+        uint8_t a = col16 & 1;
+        uint8_t r = col16 >> 11;
+        uint8_t g = (col16 >> 6) & 0x1f;
+        uint8_t b = (col16 >> 1) & 0x1f;
+        dst[4*i + 0] = SCALE_5_8(r);
+        dst[4*i + 1] = SCALE_5_8(g);
+        dst[4*i + 2] = SCALE_5_8(b);
+        dst[4*i + 3] = a ? 255 : 0;
+    }
+}
+
+static void convert_texture_ia4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes; i++) {
+        memcpy(dst + 8 * i, texture_conversion_tables.ia4[src[i]], 8);
+    }
+}
+
+static void convert_texture_ia8(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes; i++) {
+        memcpy(dst + 4 * i, texture_conversion_tables.ia8[src[i]], 4);
+    }
+}
+
+static void convert_texture_ia16(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    uint32_t i = 0;
+
+#if defined(GFX_SIMD_SSE2)
+    const __m128i intensity_mask = _mm_set1_epi16(0xff);
+    for (; i + 8 <= n_texels; i += 8) {
+        __m128i ia = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128i intensity = _mm_and_si128(ia, intensity_mask);
+        __m128i ii = _mm_or_si128(intensity, _mm_slli_epi16(intensity, 8));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_unpacklo_epi16(ii, ia));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 16), _mm_unpackhi_epi16(ii, ia));
+    }
+#elif defined(GFX_SIMD_NEON)
+    for (; i + 16 <= n_texels; i += 16) {
+        uint8x16x2_t ia = vld2q_u8(src + 2 * i);
+        uint8x16x4_t rgba = { { ia.val[0], ia.val[0], ia.val[0], ia.val[1] } };
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+#endif
+
+    for (; i < n_texels; i++) {
+        uint8_t intensity = src[2 * i];
+        uint8_t alpha = src[2 * i + 1];
+        dst[4*i + 0] = intensity;
+        dst[4*i + 1] = intensity;
+        dst[4*i + 2] = intensity;
+        dst[4*i + 3] = alpha;
+    }
+}
+
+static void convert_texture_i4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes; i++) {
+        memcpy(dst + 8 * i, texture_conversion_tables.i4[src[i]], 8);
+    }
+}
+
+static void convert_texture_i8(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    uint32_t i = 0;
+
+#if defined(GFX_SIMD_SSE2)
+    for (; i + 16 <= n_texels; i += 16) {
+        __m128i intensity = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(intensity, intensity);
+        __m128i hi = _mm_unpackhi_epi8(intensity, intensity);
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_unpacklo_epi16(lo, lo));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 16), _mm_unpackhi_epi16(lo, lo));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 32), _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 48), _mm_unpackhi_epi16(hi, hi));
+    }
+#elif defined(GFX_SIMD_NEON)
+    for (; i + 16 <= n_texels; i += 16) {
+        uint8x16_t intensity = vld1q_u8(src + i);
+        uint8x16x4_t rgba = { { intensity, intensity, intensity, intensity } };
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+#endif
+
+    for (; i < n_texels; i++) {
+        memset(dst + 4 * i, src[i], 4);
+    }
+}
+
+// The palette is expanded to RGBA32 once, after which every texel is a plain copy out of it.
+static void convert_texture_ci4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes, const uint8_t* palette) {
+    uint8_t palette_rgba32[16 * 4];
+    convert_texture_rgba16(palette_rgba32, palette, 16);
+
+    for (uint32_t i = 0; i < size_bytes; i++) {
+        memcpy(dst + 8 * i, &palette_rgba32[(src[i] >> 4) * 4], 4);
+        memcpy(dst + 8 * i + 4, &palette_rgba32[(src[i] & 0xf) * 4], 4);
+    }
+}
+
+static void convert_texture_ci8(uint8_t* dst, const uint8_t* src, uint32_t width, uint32_t height, uint32_t src_stride, const uint8_t* const palettes[2]) {
+    uint8_t palette_rgba32[256 * 4];
+    bool upper_half = false;
+
+    // The upper half of the palette is only loaded by textures that use it.
+    for (uint32_t y = 0; y < height && !upper_half; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            upper_half |= (src[y * src_stride + x] & 0x80) != 0;
+        }
+    }
+
+    convert_texture_rgba16(palette_rgba32, palettes[0], 128);
+    if (upper_half) {
+        convert_texture_rgba16(palette_rgba32 + 128 * 4, palettes[1], 128);
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = src + y * src_stride;
+        for (uint32_t x = 0; x < width; x++, dst += 4) {
+            memcpy(dst, &palette_rgba32[row[x] * 4], 4);
+        }
+    }
+}
+
 static void import_texture_rgba16(int tile) {
-    uint8_t rgba32_buf[480 * 240 * 4];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     //SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes / 2; i++) {
-        uint16_t col16 = (addr[2 * i] << 8) | addr[2 * i + 1];
-        uint8_t a = col16 & 1;
-        uint8_t r = col16 >> 11;
-        uint8_t g = (col16 >> 6) & 0x1f;
-        uint8_t b = (col16 >> 1) & 0x1f;
-        rgba32_buf[4*i + 0] = SCALE_5_8(r);
-        rgba32_buf[4*i + 1] = SCALE_5_8(g);
-        rgba32_buf[4*i + 2] = SCALE_5_8(b);
-        rgba32_buf[4*i + 3] = a ? 255 : 0;
-    }
+    convert_texture_rgba16(rgba32_buf, addr, size_bytes / 2);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes / 2;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
@@ -623,152 +1278,92 @@ static void import_texture_rgba32(int tile) {
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes / 2;
     uint32_t height = (size_bytes / 2) / rdp.texture_tile[tile].line_size_bytes;
-    gfx_rapi->upload_texture(addr, width, height);
+    gfx_upload_texture(addr, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, addr, width, height);
 }
 
 static void import_texture_ia4(int tile) {
-    uint8_t rgba32_buf[32768];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t part = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint8_t intensity = part >> 1;
-        uint8_t alpha = part & 1;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        rgba32_buf[4*i + 0] = SCALE_3_8(r);
-        rgba32_buf[4*i + 1] = SCALE_3_8(g);
-        rgba32_buf[4*i + 2] = SCALE_3_8(b);
-        rgba32_buf[4*i + 3] = alpha ? 255 : 0;
-    }
+    convert_texture_ia4(rgba32_buf, addr, size_bytes);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes * 2;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 static void import_texture_ia8(int tile) {
-    uint8_t rgba32_buf[16384];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes; i++) {
-        uint8_t intensity = addr[i] >> 4;
-        uint8_t alpha = addr[i] & 0xf;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        rgba32_buf[4*i + 0] = SCALE_4_8(r);
-        rgba32_buf[4*i + 1] = SCALE_4_8(g);
-        rgba32_buf[4*i + 2] = SCALE_4_8(b);
-        rgba32_buf[4*i + 3] = SCALE_4_8(alpha);
-    }
+    convert_texture_ia8(rgba32_buf, addr, size_bytes);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 static void import_texture_ia16(int tile) {
-    uint8_t rgba32_buf[8192];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes / 2; i++) {
-        uint8_t intensity = addr[2 * i];
-        uint8_t alpha = addr[2 * i + 1];
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        rgba32_buf[4*i + 0] = r;
-        rgba32_buf[4*i + 1] = g;
-        rgba32_buf[4*i + 2] = b;
-        rgba32_buf[4*i + 3] = alpha;
-    }
+    convert_texture_ia16(rgba32_buf, addr, size_bytes / 2);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes / 2;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 static void import_texture_i4(int tile) {
-    uint8_t rgba32_buf[32768];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     //SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t part = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint8_t intensity = part;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        uint8_t a = intensity;
-        rgba32_buf[4*i + 0] = SCALE_4_8(r);
-        rgba32_buf[4*i + 1] = SCALE_4_8(g);
-        rgba32_buf[4*i + 2] = SCALE_4_8(b);
-        rgba32_buf[4 * i + 3] = SCALE_4_8(a);
-    }
+    convert_texture_i4(rgba32_buf, addr, size_bytes);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes * 2;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 static void import_texture_i8(int tile) {
-    uint8_t rgba32_buf[16384];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
     //SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes; i++) {
-        uint8_t intensity = addr[i];
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        uint8_t a = intensity;
-        rgba32_buf[4*i + 0] = r;
-        rgba32_buf[4*i + 1] = g;
-        rgba32_buf[4*i + 2] = b;
-        rgba32_buf[4 * i + 3] = a;
-    }
+    convert_texture_i8(rgba32_buf, addr, size_bytes);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 
 static void import_texture_ci4(int tile) {
-    uint8_t rgba32_buf[32768];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
@@ -777,60 +1372,242 @@ static void import_texture_ci4(int tile) {
     const uint8_t *palette = rdp.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2; // 16 pixel entries, 16 bits each
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t idx = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint16_t col16 = (palette[idx * 2] << 8) | palette[idx * 2 + 1]; // Big endian load
-        uint8_t a = col16 & 1;
-        uint8_t r = col16 >> 11;
-        uint8_t g = (col16 >> 6) & 0x1f;
-        uint8_t b = (col16 >> 1) & 0x1f;
-        rgba32_buf[4*i + 0] = SCALE_5_8(r);
-        rgba32_buf[4*i + 1] = SCALE_5_8(g);
-        rgba32_buf[4*i + 2] = SCALE_5_8(b);
-        rgba32_buf[4*i + 3] = a ? 255 : 0;
-    }
+    convert_texture_ci4(rgba32_buf, addr, size_bytes, palette);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes * 2;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
+    gfx_upload_texture(rgba32_buf, width, height);
     // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
 }
 
 static void import_texture_ci8(int tile) {
-    uint8_t rgba32_buf[16384];
     const uint8_t* addr = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].line_size_bytes;
+    uint32_t rows = (size_bytes + line_size_bytes - 1) / line_size_bytes;
 
-    for (uint32_t i = 0, j = 0; i < size_bytes; j += full_image_line_size_bytes - line_size_bytes)
-    {
-        for (uint32_t k = 0; k < line_size_bytes; i++, k++, j++) {
-            uint8_t idx = addr[j];
-            uint16_t col16 = (rdp.palettes[idx / 128][(idx % 128) * 2] << 8) | rdp.palettes[idx / 128][(idx % 128) * 2 + 1]; // Big endian load
-            uint8_t a = col16 & 1;
-            uint8_t r = col16 >> 11;
-            uint8_t g = (col16 >> 6) & 0x1f;
-            uint8_t b = (col16 >> 1) & 0x1f;
-            rgba32_buf[4 * i + 0] = SCALE_5_8(r);
-            rgba32_buf[4 * i + 1] = SCALE_5_8(g);
-            rgba32_buf[4 * i + 2] = SCALE_5_8(b);
-            rgba32_buf[4 * i + 3] = a ? 255 : 0;
-        }
-    }
+    convert_texture_ci8(rgba32_buf, addr, line_size_bytes, rows, full_image_line_size_bytes, rdp.palettes);
 
     uint32_t width = rdp.texture_tile[tile].line_size_bytes;
     uint32_t height = size_bytes / rdp.texture_tile[tile].line_size_bytes;
 
-    if (size_bytes > 15000)
+    gfx_upload_texture(rgba32_buf, width, height);
+    // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
+}
+
+// The per texel conversions the importers did before they were vectorized, which the converters above must match
+// byte for byte.
+static void reference_texture_rgba16(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    for (uint32_t i = 0; i < n_texels; i++) {
+        uint16_t col16 = (src[2 * i] << 8) | src[2 * i + 1];
+        dst[4*i + 0] = SCALE_5_8(col16 >> 11);
+        dst[4*i + 1] = SCALE_5_8((col16 >> 6) & 0x1f);
+        dst[4*i + 2] = SCALE_5_8((col16 >> 1) & 0x1f);
+        dst[4*i + 3] = (col16 & 1) ? 255 : 0;
+    }
+}
+
+static void reference_texture_ia4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes * 2; i++) {
+        uint8_t part = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        dst[4*i + 0] = dst[4*i + 1] = dst[4*i + 2] = SCALE_3_8(part >> 1);
+        dst[4*i + 3] = (part & 1) ? 255 : 0;
+    }
+}
+
+static void reference_texture_ia8(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes; i++) {
+        dst[4*i + 0] = dst[4*i + 1] = dst[4*i + 2] = SCALE_4_8(src[i] >> 4);
+        dst[4*i + 3] = SCALE_4_8(src[i] & 0xf);
+    }
+}
+
+static void reference_texture_ia16(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    for (uint32_t i = 0; i < n_texels; i++) {
+        dst[4*i + 0] = dst[4*i + 1] = dst[4*i + 2] = src[2 * i];
+        dst[4*i + 3] = src[2 * i + 1];
+    }
+}
+
+static void reference_texture_i4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes) {
+    for (uint32_t i = 0; i < size_bytes * 2; i++) {
+        uint8_t part = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        dst[4*i + 0] = dst[4*i + 1] = dst[4*i + 2] = dst[4*i + 3] = SCALE_4_8(part);
+    }
+}
+
+static void reference_texture_i8(uint8_t* dst, const uint8_t* src, uint32_t n_texels) {
+    for (uint32_t i = 0; i < n_texels; i++) {
+        dst[4*i + 0] = dst[4*i + 1] = dst[4*i + 2] = dst[4*i + 3] = src[i];
+    }
+}
+
+static void reference_texture_ci4(uint8_t* dst, const uint8_t* src, uint32_t size_bytes, const uint8_t* palette) {
+    for (uint32_t i = 0; i < size_bytes * 2; i++) {
+        uint8_t idx = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        reference_texture_rgba16(dst + 4 * i, palette + idx * 2, 1);
+    }
+}
+
+static void reference_texture_ci8(uint8_t* dst, const uint8_t* src, uint32_t width, uint32_t height, uint32_t src_stride, const uint8_t* const palettes[2]) {
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++, dst += 4) {
+            uint8_t idx = src[y * src_stride + x];
+            reference_texture_rgba16(dst, palettes[idx / 128] + (idx % 128) * 2, 1);
+        }
+    }
+}
+
+std::vector<GfxTextureBenchmarkResult> gfx_benchmark_texture_import(void) {
+    // TMEM holds 4 KB, so each converter gets one full texture load's worth of random data.
+    static uint8_t input[4096];
+    // Both halves of a CI8 palette, loaded separately so they need not be adjacent.
+    static uint8_t tlut[2][256];
+    // Room past the largest output for the guard bytes check() fills in.
+    static uint8_t expected[8192 * 4 + 64];
+    static uint8_t actual[8192 * 4 + 64];
+
+    const uint8_t* const palettes[2] = { tlut[0], tlut[1] };
+    std::vector<GfxTextureBenchmarkResult> results;
+
+    auto randomize = [&]() {
+        for (size_t i = 0; i < sizeof(input); i++) {
+            input[i] = rand();
+        }
+        for (size_t i = 0; i < sizeof(tlut); i++) {
+            tlut[i / 256][i % 256] = rand();
+        }
+    };
+
+    // Compares the converter against the reference, starting from different garbage in each buffer so that texels the
+    // converter skips are caught too.
+    auto check = [&](GfxTextureBenchmarkResult& result, uint32_t output_bytes, auto&& reference, auto&& convert) {
+        memset(expected, 0xAA, output_bytes + 64);
+        memset(actual, 0x55, output_bytes + 64);
+        reference();
+        convert();
+        if (memcmp(expected, actual, output_bytes) != 0) {
+            result.mismatches++;
+        }
+    };
+
+    auto run = [&results](GfxTextureBenchmarkResult& result, uint32_t output_bytes, auto&& convert) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t iterations = 0;
+        double elapsed;
+
+        do {
+            for (int i = 0; i < 64; i++) {
+                convert();
+            }
+            iterations += 64;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.1);
+
+        result.mb_per_second = output_bytes * iterations / elapsed / (1024.0 * 1024.0);
+        results.push_back(result);
+    };
+
+    // Every size from a single texel up to a little past the widest vector loop, so each tail length is covered, then
+    // a few loads that fill most or all of TMEM.
+    std::vector<uint32_t> sizes;
+    for (uint32_t size = 1; size <= 66; size++) {
+        sizes.push_back(size);
+    }
+    for (uint32_t size : { 255, 256, 1000, 2047, 2048, 4095, 4096 }) {
+        sizes.push_back(size);
+    }
+
+    // Formats whose converters take a single size, counted in bytes or in texels depending on the format.
+    static const struct {
+        const char* name;
+        void (*convert)(uint8_t*, const uint8_t*, uint32_t);
+        void (*reference)(uint8_t*, const uint8_t*, uint32_t);
+        uint32_t input_bytes_per_unit; // Bytes of input per unit of the size argument
+        uint32_t output_bytes_per_unit;
+    } plain_formats[] = {
+        { "rgba16", convert_texture_rgba16, reference_texture_rgba16, 2, 4 },
+        { "ia4", convert_texture_ia4, reference_texture_ia4, 1, 8 },
+        { "ia8", convert_texture_ia8, reference_texture_ia8, 1, 4 },
+        { "ia16", convert_texture_ia16, reference_texture_ia16, 2, 4 },
+        { "i4", convert_texture_i4, reference_texture_i4, 1, 8 },
+        { "i8", convert_texture_i8, reference_texture_i8, 1, 4 },
+    };
+
+    for (const auto& format : plain_formats) {
+        GfxTextureBenchmarkResult result = {};
+        result.format = format.name;
+
+        for (uint32_t size : sizes) {
+            const uint32_t units = size / format.input_bytes_per_unit;
+            if (units == 0) {
+                continue;
+            }
+            randomize();
+            check(result, units * format.output_bytes_per_unit, [&]() { format.reference(expected, input, units); },
+                  [&]() { format.convert(actual, input, units); });
+            result.checks++;
+        }
+
+        const uint32_t units = sizeof(input) / format.input_bytes_per_unit;
+        run(result, units * format.output_bytes_per_unit, [&]() { format.convert(rgba32_buf, input, units); });
+    }
+
     {
-        int bp = 0;
+        GfxTextureBenchmarkResult result = {};
+        result.format = "ci4";
+
+        // Every one of the 16 palettes a CI4 tile can select out of the 256 entry TLUT.
+        for (uint32_t pal_idx = 0; pal_idx < 16; pal_idx++) {
+            const uint8_t* palette = palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2;
+            for (uint32_t size : sizes) {
+                randomize();
+                check(result, size * 8, [&]() { reference_texture_ci4(expected, input, size, palette); },
+                      [&]() { convert_texture_ci4(actual, input, size, palette); });
+                result.checks++;
+            }
+        }
+
+        run(result, 8192 * 4, [&]() { convert_texture_ci4(rgba32_buf, input, 4096, palettes[0]); });
     }
 
-    gfx_rapi->upload_texture(rgba32_buf, width, height);
-    // DumpTexture(rdp.loaded_texture[rdp.texture_tile[tile].tmem_index].otr_path, rgba32_buf, width, height);
+    {
+        GfxTextureBenchmarkResult result = {};
+        result.format = "ci8";
+
+        // Rows that use only the lower half of the TLUT and rows that use both, laid out contiguously and with padding
+        // between rows, as tiles cut out of a wider image are.
+        static const struct {
+            uint32_t width;
+            uint32_t height;
+            uint32_t src_stride;
+        } layouts[] = {
+            { 1, 1, 1 }, { 7, 3, 7 }, { 16, 16, 16 }, { 17, 5, 32 }, { 32, 64, 32 }, { 33, 31, 64 }, { 64, 64, 64 },
+            { 48, 40, 100 },
+        };
+
+        for (const auto& layout : layouts) {
+            for (int upper_half = 0; upper_half < 2; upper_half++) {
+                randomize();
+                if (!upper_half) {
+                    for (size_t i = 0; i < sizeof(input); i++) {
+                        input[i] &= 0x7f;
+                    }
+                }
+                check(result, layout.width * layout.height * 4,
+                      [&]() { reference_texture_ci8(expected, input, layout.width, layout.height, layout.src_stride, palettes); },
+                      [&]() { convert_texture_ci8(actual, input, layout.width, layout.height, layout.src_stride, palettes); });
+                result.checks++;
+            }
+        }
+
+        randomize();
+        run(result, 4096 * 4, [&]() { convert_texture_ci8(rgba32_buf, input, 64, 64, 64, palettes); });
+    }
+
+    return results;
 }
 
 static void import_texture(int i, int tile) {
@@ -1001,7 +1778,435 @@ static void gfx_adjust_width_height_for_scale(uint32_t& width, uint32_t& height)
     }
 }
 
-static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx *vertices) {
+static void gfx_sp_calculate_lights_coeffs(void) {
+    for (int i = 0; i < rsp.current_num_lights - 1; i++) {
+        calculate_normal_dir(&rsp.current_lights[i], rsp.current_lights_coeffs[i]);
+    }
+    /*static const Light_t lookat_x = {{0, 0, 0}, 0, {0, 0, 0}, 0, {127, 0, 0}, 0};
+    static const Light_t lookat_y = {{0, 0, 0}, 0, {0, 0, 0}, 0, {0, 127, 0}, 0};*/
+    calculate_normal_dir(&rsp.lookat[0], rsp.current_lookat_coeffs[0]);
+    calculate_normal_dir(&rsp.lookat[1], rsp.current_lookat_coeffs[1]);
+    rsp.lights_changed = false;
+}
+
+static void gfx_calculate_texture_gen(const Vtx_tn* vn, short& U, short& V) {
+    float dotx = 0, doty = 0;
+    dotx += vn->n[0] * rsp.current_lookat_coeffs[0][0];
+    dotx += vn->n[1] * rsp.current_lookat_coeffs[0][1];
+    dotx += vn->n[2] * rsp.current_lookat_coeffs[0][2];
+    doty += vn->n[0] * rsp.current_lookat_coeffs[1][0];
+    doty += vn->n[1] * rsp.current_lookat_coeffs[1][1];
+    doty += vn->n[2] * rsp.current_lookat_coeffs[1][2];
+
+
+    dotx /= 127.0f;
+    doty /= 127.0f;
+
+    dotx = Ship::Math::clamp(dotx, -1.0f, 1.0f);
+    doty = Ship::Math::clamp(doty, -1.0f, 1.0f);
+
+    if (rsp.geometry_mode & G_TEXTURE_GEN_LINEAR) {
+                        // Not sure exactly what formula we should use to get accurate values
+                        /*dotx = (2.906921f * dotx * dotx + 1.36114f) * dotx;
+                        doty = (2.906921f * doty * doty + 1.36114f) * doty;
+                        dotx = (dotx + 1.0f) / 4.0f;
+                        doty = (doty + 1.0f) / 4.0f;*/
+        dotx = acosf(-dotx) /* M_PI */ / 4.0f;
+        doty = acosf(-doty) /* M_PI */ / 4.0f;
+    }
+    else {
+        dotx = (dotx + 1.0f) / 4.0f;
+        doty = (doty + 1.0f) / 4.0f;
+    }
+
+    U = (int32_t)(dotx * rsp.texture_scaling_factor.s);
+    V = (int32_t)(doty * rsp.texture_scaling_factor.t);
+}
+
+// Writes one vertex of a batch once its position, clip flags, lit color and fog are known, the same way
+// gfx_sp_vertex_scalar does.
+static inline void gfx_sp_vertex_finish(const Vtx* vertex, struct LoadedVertex* d, float x, float y, float z, float w,
+                                        uint8_t clip_rej, int32_t r, int32_t g, int32_t b, int32_t fog_alpha) {
+    const Vtx_t *v = &vertex->v;
+
+    short U = v->tc[0] * rsp.texture_scaling_factor.s >> 16;
+    short V = v->tc[1] * rsp.texture_scaling_factor.t >> 16;
+
+    if (rsp.geometry_mode & G_LIGHTING) {
+        d->color.r = r > 255 ? 255 : r;
+        d->color.g = g > 255 ? 255 : g;
+        d->color.b = b > 255 ? 255 : b;
+
+        if (rsp.geometry_mode & G_TEXTURE_GEN) {
+            gfx_calculate_texture_gen(&vertex->n, U, V);
+        }
+    } else {
+        d->color.r = v->cn[0];
+        d->color.g = v->cn[1];
+        d->color.b = v->cn[2];
+    }
+
+    d->u = U;
+    d->v = V;
+    d->clip_rej = clip_rej;
+
+    d->x = x;
+    d->y = y;
+    d->z = z;
+    d->w = w;
+
+    d->color.a = (rsp.geometry_mode & G_FOG) ? fog_alpha : v->cn[3];
+}
+
+#if defined(GFX_SIMD_SSE2) || defined(GFX_SIMD_NEON)
+#define GFX_SIMD_VERTEX
+
+// Four lane float operations for the batched vertex path. Each maps to one IEEE operation, and the batched path
+// performs them in the same order as the scalar one, so both produce identical vertices.
+#ifdef GFX_SIMD_SSE2
+typedef __m128 f32x4;
+typedef __m128i i32x4;
+
+static inline f32x4 f32x4_load(const float* p) { return _mm_loadu_ps(p); }
+static inline f32x4 f32x4_splat(float v) { return _mm_set1_ps(v); }
+static inline void f32x4_store(float* p, f32x4 a) { _mm_storeu_ps(p, a); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b) { return _mm_div_ps(a, b); }
+static inline f32x4 f32x4_neg(f32x4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+static inline f32x4 f32x4_abs(f32x4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline f32x4 f32x4_lt(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a, b); }
+static inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline int f32x4_movemask(f32x4 mask) { return _mm_movemask_ps(mask); }
+static inline i32x4 f32x4_to_i32x4(f32x4 a) { return _mm_cvttps_epi32(a); }
+static inline f32x4 i32x4_to_f32x4(i32x4 a) { return _mm_cvtepi32_ps(a); }
+static inline void i32x4_store(int32_t* p, i32x4 a) { _mm_storeu_si128((__m128i*)p, a); }
+
+// Transposes the positions of four vertices into one vector per axis. A Vtx is 16 bytes with ob[] first.
+static inline void f32x4_load_positions(const Vtx* v, f32x4 ob[3]) {
+    const __m128i r0 = _mm_loadu_si128((const __m128i*)&v[0]);
+    const __m128i r1 = _mm_loadu_si128((const __m128i*)&v[1]);
+    const __m128i r2 = _mm_loadu_si128((const __m128i*)&v[2]);
+    const __m128i r3 = _mm_loadu_si128((const __m128i*)&v[3]);
+    const __m128i lo = _mm_unpacklo_epi16(r0, r1);
+    const __m128i hi = _mm_unpacklo_epi16(r2, r3);
+    const __m128i xy = _mm_unpacklo_epi32(lo, hi);
+    const __m128i zf = _mm_unpackhi_epi32(lo, hi);
+    ob[0] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(xy, xy), 16));
+    ob[1] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(xy, xy), 16));
+    ob[2] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zf, zf), 16));
+}
+
+// Same for the normals, which are the first three bytes of each vertex's last word.
+static inline void f32x4_load_normals(const Vtx* v, f32x4 n[3]) {
+    const __m128i r01 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i*)&v[0]), _mm_loadu_si128((const __m128i*)&v[1]));
+    const __m128i r23 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i*)&v[2]), _mm_loadu_si128((const __m128i*)&v[3]));
+    const __m128i words = _mm_unpackhi_epi64(r01, r23);
+    n[0] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(words, 24), 24));
+    n[1] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(words, 16), 24));
+    n[2] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(words, 8), 24));
+}
+#else
+typedef float32x4_t f32x4;
+typedef int32x4_t i32x4;
+
+static inline f32x4 f32x4_load(const float* p) { return vld1q_f32(p); }
+static inline f32x4 f32x4_splat(float v) { return vdupq_n_f32(v); }
+static inline void f32x4_store(float* p, f32x4 a) { vst1q_f32(p, a); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b) { return vdivq_f32(a, b); }
+static inline f32x4 f32x4_neg(f32x4 a) { return vnegq_f32(a); }
+static inline f32x4 f32x4_abs(f32x4 a) { return vabsq_f32(a); }
+static inline f32x4 f32x4_lt(f32x4 a, f32x4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+static inline int f32x4_movemask(f32x4 mask) {
+    static const int32_t shifts[4] = { 0, 1, 2, 3 };
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(mask), 31), vld1q_s32(shifts)));
+}
+static inline i32x4 f32x4_to_i32x4(f32x4 a) { return vcvtq_s32_f32(a); }
+static inline f32x4 i32x4_to_f32x4(i32x4 a) { return vcvtq_f32_s32(a); }
+static inline void i32x4_store(int32_t* p, i32x4 a) { vst1q_s32(p, a); }
+
+static inline void f32x4_load_positions(const Vtx* v, f32x4 ob[3]) {
+    for (int k = 0; k < 3; k++) {
+        const int32_t lanes[4] = { v[0].v.ob[k], v[1].v.ob[k], v[2].v.ob[k], v[3].v.ob[k] };
+        ob[k] = vcvtq_f32_s32(vld1q_s32(lanes));
+    }
+}
+
+static inline void f32x4_load_normals(const Vtx* v, f32x4 n[3]) {
+    for (int k = 0; k < 3; k++) {
+        const int32_t lanes[4] = { v[0].n.n[k], v[1].n.n[k], v[2].n.n[k], v[3].n.n[k] };
+        n[k] = vcvtq_f32_s32(vld1q_s32(lanes));
+    }
+}
+#endif
+
+// Transforms, lights, fogs and clip tests vertices four at a time. n_vertices must be a multiple of four.
+static void gfx_sp_vertex_batched(size_t n_vertices, size_t dest_index, const Vtx *vertices) {
+    const bool lighting = (rsp.geometry_mode & G_LIGHTING) != 0;
+    const bool fog = (rsp.geometry_mode & G_FOG) != 0;
+
+    if (lighting && rsp.lights_changed) {
+        gfx_sp_calculate_lights_coeffs();
+    }
+
+    f32x4 mp[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            mp[i][j] = f32x4_splat(rsp.MP_matrix[i][j]);
+        }
+    }
+
+    const f32x4 zero = f32x4_splat(0.0f);
+    const f32x4 aspect_ratio = f32x4_splat((float)gfx_current_dimensions.width / (float)gfx_current_dimensions.height);
+
+    for (size_t i = 0; i < n_vertices; i += 4, dest_index += 4) {
+        f32x4 ob[3];
+        f32x4_load_positions(&vertices[i], ob);
+        const f32x4 obx = ob[0];
+        const f32x4 oby = ob[1];
+        const f32x4 obz = ob[2];
+
+        f32x4 x = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(obx, mp[0][0]), f32x4_mul(oby, mp[1][0])), f32x4_mul(obz, mp[2][0])), mp[3][0]);
+        f32x4 y = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(obx, mp[0][1]), f32x4_mul(oby, mp[1][1])), f32x4_mul(obz, mp[2][1])), mp[3][1]);
+        f32x4 z = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(obx, mp[0][2]), f32x4_mul(oby, mp[1][2])), f32x4_mul(obz, mp[2][2])), mp[3][2]);
+        f32x4 w = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(obx, mp[0][3]), f32x4_mul(oby, mp[1][3])), f32x4_mul(obz, mp[2][3])), mp[3][3]);
+
+        if (!fbActive) {
+            x = f32x4_div(f32x4_mul(x, f32x4_splat(4.0f / 3.0f)), aspect_ratio);
+        }
+
+        const f32x4 neg_w = f32x4_neg(w);
+        const int clip_left = f32x4_movemask(f32x4_lt(x, neg_w));
+        const int clip_right = f32x4_movemask(f32x4_lt(w, x));
+        const int clip_bottom = f32x4_movemask(f32x4_lt(y, neg_w));
+        const int clip_top = f32x4_movemask(f32x4_lt(w, y));
+        const int clip_far = f32x4_movemask(f32x4_lt(w, z));
+
+        int32_t rgb[3][4] = {};
+        if (lighting) {
+            f32x4 n[3];
+            f32x4_load_normals(&vertices[i], n);
+            const f32x4 nx = n[0];
+            const f32x4 ny = n[1];
+            const f32x4 nz = n[2];
+            const Light_t& ambient = rsp.current_lights[rsp.current_num_lights - 1];
+            f32x4 col[3] = { f32x4_splat(ambient.col[0]), f32x4_splat(ambient.col[1]), f32x4_splat(ambient.col[2]) };
+
+            for (int l = 0; l < rsp.current_num_lights - 1; l++) {
+                f32x4 intensity = f32x4_add(zero, f32x4_mul(nx, f32x4_splat(rsp.current_lights_coeffs[l][0])));
+                intensity = f32x4_add(intensity, f32x4_mul(ny, f32x4_splat(rsp.current_lights_coeffs[l][1])));
+                intensity = f32x4_add(intensity, f32x4_mul(nz, f32x4_splat(rsp.current_lights_coeffs[l][2])));
+                intensity = f32x4_div(intensity, f32x4_splat(127.0f));
+
+                // The color accumulates as an integer, so every light truncates it again like the scalar path does.
+                const f32x4 lit = f32x4_lt(zero, intensity);
+                for (int k = 0; k < 3; k++) {
+                    f32x4 sum = f32x4_add(col[k], f32x4_mul(intensity, f32x4_splat(rsp.current_lights[l].col[k])));
+                    col[k] = f32x4_select(lit, i32x4_to_f32x4(f32x4_to_i32x4(sum)), col[k]);
+                }
+            }
+
+            for (int k = 0; k < 3; k++) {
+                i32x4_store(rgb[k], f32x4_to_i32x4(col[k]));
+            }
+        }
+
+        int32_t fog_alpha[4] = {};
+        if (fog) {
+            f32x4 fog_w = f32x4_select(f32x4_lt(f32x4_abs(w), f32x4_splat(0.001f)), f32x4_splat(0.001f), w);
+            f32x4 winv = f32x4_div(f32x4_splat(1.0f), fog_w);
+            winv = f32x4_select(f32x4_lt(winv, zero), f32x4_splat(std::numeric_limits<int16_t>::max()), winv);
+
+            f32x4 fog_z = f32x4_add(f32x4_mul(f32x4_mul(z, winv), f32x4_splat(rsp.fog_mul)), f32x4_splat(rsp.fog_offset));
+            fog_z = f32x4_select(f32x4_lt(fog_z, zero), zero, fog_z);
+            fog_z = f32x4_select(f32x4_lt(f32x4_splat(255.0f), fog_z), f32x4_splat(255.0f), fog_z);
+            i32x4_store(fog_alpha, f32x4_to_i32x4(fog_z));
+        }
+
+        float out[4][4];
+        f32x4_store(out[0], x);
+        f32x4_store(out[1], y);
+        f32x4_store(out[2], z);
+        f32x4_store(out[3], w);
+
+        for (int lane = 0; lane < 4; lane++) {
+            const uint8_t clip_rej = ((clip_left >> lane) & 1) | (((clip_right >> lane) & 1) << 1) |
+                                     (((clip_bottom >> lane) & 1) << 2) | (((clip_top >> lane) & 1) << 3) |
+                                     (((clip_far >> lane) & 1) << 5);
+            gfx_sp_vertex_finish(&vertices[i + lane], &rsp.loaded_vertices[dest_index + lane], out[0][lane],
+                                 out[1][lane], out[2][lane], out[3][lane], clip_rej, rgb[0][lane], rgb[1][lane],
+                                 rgb[2][lane], fog_alpha[lane]);
+        }
+    }
+}
+#endif
+
+#ifdef GFX_SIMD_SSE2
+#define GFX_SIMD_VERTEX_AVX
+
+// AVX is not baseline on x86, so the eight lane path is compiled for it on its own and only used when the CPU has it.
+// It needs nothing from AVX2 or FMA, and must not use FMA: a fused multiply-add rounds once where the scalar path
+// rounds twice.
+#if defined(__GNUC__) || defined(__clang__)
+#define GFX_TARGET_AVX __attribute__((target("avx")))
+#else
+#define GFX_TARGET_AVX
+#endif
+
+typedef __m256 f32x8;
+typedef __m256i i32x8;
+
+GFX_TARGET_AVX static inline f32x8 f32x8_load(const float* p) { return _mm256_loadu_ps(p); }
+GFX_TARGET_AVX static inline f32x8 f32x8_splat(float v) { return _mm256_set1_ps(v); }
+GFX_TARGET_AVX static inline void f32x8_store(float* p, f32x8 a) { _mm256_storeu_ps(p, a); }
+GFX_TARGET_AVX static inline f32x8 f32x8_add(f32x8 a, f32x8 b) { return _mm256_add_ps(a, b); }
+GFX_TARGET_AVX static inline f32x8 f32x8_mul(f32x8 a, f32x8 b) { return _mm256_mul_ps(a, b); }
+GFX_TARGET_AVX static inline f32x8 f32x8_div(f32x8 a, f32x8 b) { return _mm256_div_ps(a, b); }
+GFX_TARGET_AVX static inline f32x8 f32x8_neg(f32x8 a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+GFX_TARGET_AVX static inline f32x8 f32x8_abs(f32x8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+GFX_TARGET_AVX static inline f32x8 f32x8_lt(f32x8 a, f32x8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OS); }
+GFX_TARGET_AVX static inline f32x8 f32x8_select(f32x8 mask, f32x8 a, f32x8 b) { return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b)); }
+GFX_TARGET_AVX static inline int f32x8_movemask(f32x8 mask) { return _mm256_movemask_ps(mask); }
+GFX_TARGET_AVX static inline i32x8 f32x8_to_i32x8(f32x8 a) { return _mm256_cvttps_epi32(a); }
+GFX_TARGET_AVX static inline f32x8 i32x8_to_f32x8(i32x8 a) { return _mm256_cvtepi32_ps(a); }
+GFX_TARGET_AVX static inline void i32x8_store(int32_t* p, i32x8 a) { _mm256_storeu_si256((__m256i*)p, a); }
+GFX_TARGET_AVX static inline f32x8 f32x8_join(f32x4 lo, f32x4 hi) { return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1); }
+
+// gfx_sp_vertex_batched eight vertices at a time. n_vertices must be a multiple of eight.
+GFX_TARGET_AVX static void gfx_sp_vertex_batched_avx(size_t n_vertices, size_t dest_index, const Vtx *vertices) {
+    const bool lighting = (rsp.geometry_mode & G_LIGHTING) != 0;
+    const bool fog = (rsp.geometry_mode & G_FOG) != 0;
+
+    if (lighting && rsp.lights_changed) {
+        gfx_sp_calculate_lights_coeffs();
+    }
+
+    f32x8 mp[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            mp[i][j] = f32x8_splat(rsp.MP_matrix[i][j]);
+        }
+    }
+
+    const f32x8 zero = f32x8_splat(0.0f);
+    const f32x8 aspect_ratio = f32x8_splat((float)gfx_current_dimensions.width / (float)gfx_current_dimensions.height);
+
+    for (size_t i = 0; i < n_vertices; i += 8, dest_index += 8) {
+        f32x4 ob[2][3];
+        f32x4_load_positions(&vertices[i], ob[0]);
+        f32x4_load_positions(&vertices[i + 4], ob[1]);
+        const f32x8 obx = f32x8_join(ob[0][0], ob[1][0]);
+        const f32x8 oby = f32x8_join(ob[0][1], ob[1][1]);
+        const f32x8 obz = f32x8_join(ob[0][2], ob[1][2]);
+
+        f32x8 x = f32x8_add(f32x8_add(f32x8_add(f32x8_mul(obx, mp[0][0]), f32x8_mul(oby, mp[1][0])), f32x8_mul(obz, mp[2][0])), mp[3][0]);
+        f32x8 y = f32x8_add(f32x8_add(f32x8_add(f32x8_mul(obx, mp[0][1]), f32x8_mul(oby, mp[1][1])), f32x8_mul(obz, mp[2][1])), mp[3][1]);
+        f32x8 z = f32x8_add(f32x8_add(f32x8_add(f32x8_mul(obx, mp[0][2]), f32x8_mul(oby, mp[1][2])), f32x8_mul(obz, mp[2][2])), mp[3][2]);
+        f32x8 w = f32x8_add(f32x8_add(f32x8_add(f32x8_mul(obx, mp[0][3]), f32x8_mul(oby, mp[1][3])), f32x8_mul(obz, mp[2][3])), mp[3][3]);
+
+        if (!fbActive) {
+            x = f32x8_div(f32x8_mul(x, f32x8_splat(4.0f / 3.0f)), aspect_ratio);
+        }
+
+        const f32x8 neg_w = f32x8_neg(w);
+        const int clip_left = f32x8_movemask(f32x8_lt(x, neg_w));
+        const int clip_right = f32x8_movemask(f32x8_lt(w, x));
+        const int clip_bottom = f32x8_movemask(f32x8_lt(y, neg_w));
+        const int clip_top = f32x8_movemask(f32x8_lt(w, y));
+        const int clip_far = f32x8_movemask(f32x8_lt(w, z));
+
+        int32_t rgb[3][8] = {};
+        if (lighting) {
+            f32x4 n[2][3];
+            f32x4_load_normals(&vertices[i], n[0]);
+            f32x4_load_normals(&vertices[i + 4], n[1]);
+            const f32x8 nx = f32x8_join(n[0][0], n[1][0]);
+            const f32x8 ny = f32x8_join(n[0][1], n[1][1]);
+            const f32x8 nz = f32x8_join(n[0][2], n[1][2]);
+            const Light_t& ambient = rsp.current_lights[rsp.current_num_lights - 1];
+            f32x8 col[3] = { f32x8_splat(ambient.col[0]), f32x8_splat(ambient.col[1]), f32x8_splat(ambient.col[2]) };
+
+            for (int l = 0; l < rsp.current_num_lights - 1; l++) {
+                f32x8 intensity = f32x8_add(zero, f32x8_mul(nx, f32x8_splat(rsp.current_lights_coeffs[l][0])));
+                intensity = f32x8_add(intensity, f32x8_mul(ny, f32x8_splat(rsp.current_lights_coeffs[l][1])));
+                intensity = f32x8_add(intensity, f32x8_mul(nz, f32x8_splat(rsp.current_lights_coeffs[l][2])));
+                intensity = f32x8_div(intensity, f32x8_splat(127.0f));
+
+                const f32x8 lit = f32x8_lt(zero, intensity);
+                for (int k = 0; k < 3; k++) {
+                    f32x8 sum = f32x8_add(col[k], f32x8_mul(intensity, f32x8_splat(rsp.current_lights[l].col[k])));
+                    col[k] = f32x8_select(lit, i32x8_to_f32x8(f32x8_to_i32x8(sum)), col[k]);
+                }
+            }
+
+            for (int k = 0; k < 3; k++) {
+                i32x8_store(rgb[k], f32x8_to_i32x8(col[k]));
+            }
+        }
+
+        int32_t fog_alpha[8] = {};
+        if (fog) {
+            f32x8 fog_w = f32x8_select(f32x8_lt(f32x8_abs(w), f32x8_splat(0.001f)), f32x8_splat(0.001f), w);
+            f32x8 winv = f32x8_div(f32x8_splat(1.0f), fog_w);
+            winv = f32x8_select(f32x8_lt(winv, zero), f32x8_splat(std::numeric_limits<int16_t>::max()), winv);
+
+            f32x8 fog_z = f32x8_add(f32x8_mul(f32x8_mul(z, winv), f32x8_splat(rsp.fog_mul)), f32x8_splat(rsp.fog_offset));
+            fog_z = f32x8_select(f32x8_lt(fog_z, zero), zero, fog_z);
+            fog_z = f32x8_select(f32x8_lt(f32x8_splat(255.0f), fog_z), f32x8_splat(255.0f), fog_z);
+            i32x8_store(fog_alpha, f32x8_to_i32x8(fog_z));
+        }
+
+        float out[4][8];
+        f32x8_store(out[0], x);
+        f32x8_store(out[1], y);
+        f32x8_store(out[2], z);
+        f32x8_store(out[3], w);
+
+        for (int lane = 0; lane < 8; lane++) {
+            const uint8_t clip_rej = ((clip_left >> lane) & 1) | (((clip_right >> lane) & 1) << 1) |
+                                     (((clip_bottom >> lane) & 1) << 2) | (((clip_top >> lane) & 1) << 3) |
+                                     (((clip_far >> lane) & 1) << 5);
+            gfx_sp_vertex_finish(&vertices[i + lane], &rsp.loaded_vertices[dest_index + lane], out[0][lane],
+                                 out[1][lane], out[2][lane], out[3][lane], clip_rej, rgb[0][lane], rgb[1][lane],
+                                 rgb[2][lane], fog_alpha[lane]);
+        }
+    }
+
+    // Leaves no dirty upper register halves behind to slow down the SSE code that follows.
+    _mm256_zeroupper();
+}
+
+static bool gfx_cpu_has_avx(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    // The CPU supports AVX, and the OS saves the upper register halves across context switches.
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0) {
+        return false;
+    }
+    return (_xgetbv(0) & 6) == 6;
+#else
+    // Runs from a static initializer, possibly before the one that fills in what __builtin_cpu_supports reads.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+// The widest batch gfx_sp_vertex uses on this CPU.
+static const size_t gfx_vertex_batch_width =
+#if defined(GFX_SIMD_VERTEX_AVX)
+    gfx_cpu_has_avx() ? 8 : 4;
+#elif defined(GFX_SIMD_VERTEX)
+    4;
+#else
+    1;
+#endif
+
+static void gfx_sp_vertex_scalar(size_t n_vertices, size_t dest_index, const Vtx *vertices) {
     for (size_t i = 0; i < n_vertices; i++, dest_index++) {
         const Vtx_t *v = &vertices[i].v;
         const Vtx_tn *vn = &vertices[i].n;
@@ -1022,14 +2227,7 @@ static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx *verti
 
         if (rsp.geometry_mode & G_LIGHTING) {
             if (rsp.lights_changed) {
-                for (int i = 0; i < rsp.current_num_lights - 1; i++) {
-                    calculate_normal_dir(&rsp.current_lights[i], rsp.current_lights_coeffs[i]);
-                }
-                /*static const Light_t lookat_x = {{0, 0, 0}, 0, {0, 0, 0}, 0, {127, 0, 0}, 0};
-                static const Light_t lookat_y = {{0, 0, 0}, 0, {0, 0, 0}, 0, {0, 127, 0}, 0};*/
-                calculate_normal_dir(&rsp.lookat[0], rsp.current_lookat_coeffs[0]);
-                calculate_normal_dir(&rsp.lookat[1], rsp.current_lookat_coeffs[1]);
-                rsp.lights_changed = false;
+                gfx_sp_calculate_lights_coeffs();
             }
 
             int r = rsp.current_lights[rsp.current_num_lights - 1].col[0];
@@ -1054,37 +2252,7 @@ static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx *verti
             d->color.b = b > 255 ? 255 : b;
 
             if (rsp.geometry_mode & G_TEXTURE_GEN) {
-                float dotx = 0, doty = 0;
-                dotx += vn->n[0] * rsp.current_lookat_coeffs[0][0];
-                dotx += vn->n[1] * rsp.current_lookat_coeffs[0][1];
-                dotx += vn->n[2] * rsp.current_lookat_coeffs[0][2];
-                doty += vn->n[0] * rsp.current_lookat_coeffs[1][0];
-                doty += vn->n[1] * rsp.current_lookat_coeffs[1][1];
-                doty += vn->n[2] * rsp.current_lookat_coeffs[1][2];
-
-
-                dotx /= 127.0f;
-                doty /= 127.0f;
-
-                dotx = Ship::Math::clamp(dotx, -1.0f, 1.0f);
-                doty = Ship::Math::clamp(doty, -1.0f, 1.0f);
-
-                if (rsp.geometry_mode & G_TEXTURE_GEN_LINEAR) {
-                                    // Not sure exactly what formula we should use to get accurate values
-                                    /*dotx = (2.906921f * dotx * dotx + 1.36114f) * dotx;
-                                    doty = (2.906921f * doty * doty + 1.36114f) * doty;
-                                    dotx = (dotx + 1.0f) / 4.0f;
-                                    doty = (doty + 1.0f) / 4.0f;*/
-                    dotx = acosf(-dotx) /* M_PI */ / 4.0f;
-                    doty = acosf(-doty) /* M_PI */ / 4.0f;
-                }
-                else {
-                    dotx = (dotx + 1.0f) / 4.0f;
-                    doty = (doty + 1.0f) / 4.0f;
-                }
-
-                U = (int32_t)(dotx * rsp.texture_scaling_factor.s);
-                V = (int32_t)(doty * rsp.texture_scaling_factor.t);
+                gfx_calculate_texture_gen(vn, U, V);
             }
         } else {
             d->color.r = v->cn[0];
@@ -1127,6 +2295,165 @@ static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx *verti
     }
 }
 
+// Loads vertices in batches no wider than max_batch, leaving the rest to the scalar loop.
+static void gfx_sp_vertex_batches(size_t n_vertices, size_t dest_index, const Vtx *vertices, size_t max_batch) {
+    if (vertices != NULL) {
+#ifdef GFX_SIMD_VERTEX_AVX
+        if (max_batch >= 8 && n_vertices >= 8) {
+            size_t n_batched = n_vertices & ~(size_t)7;
+            gfx_sp_vertex_batched_avx(n_batched, dest_index, vertices);
+            n_vertices -= n_batched;
+            dest_index += n_batched;
+            vertices += n_batched;
+        }
+#endif
+#ifdef GFX_SIMD_VERTEX
+        if (max_batch >= 4 && n_vertices >= 4) {
+            size_t n_batched = n_vertices & ~(size_t)3;
+            gfx_sp_vertex_batched(n_batched, dest_index, vertices);
+            n_vertices -= n_batched;
+            dest_index += n_batched;
+            vertices += n_batched;
+        }
+#endif
+    }
+
+    gfx_sp_vertex_scalar(n_vertices, dest_index, vertices);
+}
+
+static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx *vertices) {
+    gfx_sp_vertex_batches(n_vertices, dest_index, vertices, gfx_vertex_batch_width);
+}
+
+std::vector<GfxVertexBenchmarkResult> gfx_benchmark_vertices(void) {
+    // One less than a full load, so the eight and four wide batches and the scalar loop all get some vertices.
+    const size_t n_vertices = MAX_VERTICES - 1;
+    static Vtx vertices[MAX_VERTICES];
+    static struct LoadedVertex expected[MAX_VERTICES];
+    const auto saved_rsp = rsp;
+    const bool saved_fb_active = fbActive;
+    std::vector<GfxVertexBenchmarkResult> results;
+
+    auto random_float = [](float range) { return ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * range; };
+    auto randomize = [&]() {
+        for (size_t i = 0; i < n_vertices; i++) {
+            Vtx_t& v = vertices[i].v;
+            for (int k = 0; k < 3; k++) {
+                // The first vertex sits at the origin, which puts its w on MP_matrix[3][3] and hits the fog path's
+                // guard against dividing by zero when that is 0.
+                v.ob[k] = i == 0 ? 0 : (int16_t)(rand() % 8192 - 4096);
+            }
+            v.tc[0] = (int16_t)rand();
+            v.tc[1] = (int16_t)rand();
+            for (int k = 0; k < 4; k++) {
+                v.cn[k] = (uint8_t)rand();
+            }
+        }
+
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                rsp.MP_matrix[i][j] = random_float(2.0f);
+            }
+        }
+        rsp.MP_matrix[3][3] = rand() % 4 == 0 ? 0.0f : random_float(1000.0f);
+
+        rsp.current_num_lights = 1 + rand() % 8;
+        for (int i = 0; i < rsp.current_num_lights; i++) {
+            for (int k = 0; k < 3; k++) {
+                rsp.current_lights[i].col[k] = (uint8_t)rand();
+                rsp.current_lights_coeffs[i][k] = random_float(1.0f);
+            }
+        }
+        for (int i = 0; i < 2; i++) {
+            for (int k = 0; k < 3; k++) {
+                rsp.current_lookat_coeffs[i][k] = random_float(1.0f);
+            }
+        }
+        rsp.lights_changed = false;
+
+        rsp.fog_mul = (int16_t)(rand() % 0x10000);
+        rsp.fog_offset = (int16_t)(rand() % 0x10000);
+        rsp.texture_scaling_factor.s = (uint16_t)rand();
+        rsp.texture_scaling_factor.t = (uint16_t)rand();
+    };
+
+    auto same_vertices = [&]() {
+        for (size_t i = 0; i < n_vertices; i++) {
+            const struct LoadedVertex& a = expected[i];
+            const struct LoadedVertex& b = rsp.loaded_vertices[i];
+            // Compares bit patterns, so -0.0f and 0.0f differ and NaN matches itself.
+            if (memcmp(&a.x, &b.x, sizeof(float) * 6) != 0 || memcmp(&a.color, &b.color, sizeof(a.color)) != 0 ||
+                a.clip_rej != b.clip_rej) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto run = [&](size_t max_batch) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t iterations = 0;
+        double elapsed;
+
+        do {
+            for (int i = 0; i < 64; i++) {
+                gfx_sp_vertex_batches(n_vertices, 0, vertices, max_batch);
+            }
+            iterations += 64;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.1);
+
+        return n_vertices * iterations / elapsed;
+    };
+
+    static const struct {
+        uint32_t geometry_mode;
+        const char* name;
+    } lighting_modes[] = {
+        { 0, "unlit" },
+        { G_LIGHTING, "lit" },
+        { G_LIGHTING | G_TEXTURE_GEN, "lit, texgen" },
+        { G_LIGHTING | G_TEXTURE_GEN | G_TEXTURE_GEN_LINEAR, "lit, linear texgen" },
+    };
+
+    for (int aspect = 0; aspect < 2; aspect++) {
+        for (const auto& lighting : lighting_modes) {
+            for (int fog = 0; fog < 2; fog++) {
+                GfxVertexBenchmarkResult result = {};
+                result.modes = std::string(lighting.name) + (fog ? ", fog" : "") + (aspect ? ", aspect corrected" : "");
+                result.bit_exact = true;
+                fbActive = !aspect;
+
+                // Every batch width is compared against the scalar loop over many random loads before any timing.
+                for (int trial = 0; trial < 256; trial++) {
+                    randomize();
+                    rsp.geometry_mode = lighting.geometry_mode | (fog ? G_FOG : 0);
+                    gfx_sp_vertex_batches(n_vertices, 0, vertices, 1);
+                    memcpy(expected, rsp.loaded_vertices, sizeof(expected));
+
+                    for (size_t width = 4; width <= gfx_vertex_batch_width; width *= 2) {
+                        memset(rsp.loaded_vertices, 0, sizeof(rsp.loaded_vertices));
+                        gfx_sp_vertex_batches(n_vertices, 0, vertices, width);
+                        result.bit_exact &= same_vertices();
+                    }
+                }
+
+                // Timed with two directional lights and an ambient one, as most of the game's lit geometry uses.
+                rsp.current_num_lights = 3;
+                result.scalar_vertices_per_second = run(1);
+                for (size_t width = 4, i = 0; width <= gfx_vertex_batch_width; width *= 2, i++) {
+                    result.batched_vertices_per_second[i] = run(width);
+                }
+                results.push_back(result);
+            }
+        }
+    }
+
+    rsp = saved_rsp;
+    fbActive = saved_fb_active;
+    return results;
+}
+
 static void gfx_sp_modify_vertex(uint16_t vtx_idx, uint8_t where, uint32_t val) {
     SUPPORT_CHECK(where == G_MWO_POINT_ST);
 
@@ -1179,34 +2506,13 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
 
     bool depth_test = (rsp.geometry_mode & G_ZBUFFER) == G_ZBUFFER;
     bool depth_mask = (rdp.other_mode_l & Z_UPD) == Z_UPD;
-    uint8_t depth_test_and_mask = (depth_test ? 1 : 0) | (depth_mask ? 2 : 0);
-    if (depth_test_and_mask != rendering_state.depth_test_and_mask) {
-        gfx_flush();
-        gfx_rapi->set_depth_test_and_mask(depth_test, depth_mask);
-        rendering_state.depth_test_and_mask = depth_test_and_mask;
-    }
-
     bool zmode_decal = (rdp.other_mode_l & ZMODE_DEC) == ZMODE_DEC;
-    if (zmode_decal != rendering_state.decal_mode) {
-        gfx_flush();
-        gfx_rapi->set_zmode_decal(zmode_decal);
-        rendering_state.decal_mode = zmode_decal;
-    }
-
-    if (rdp.viewport_or_scissor_changed) {
-        if (memcmp(&rdp.viewport, &rendering_state.viewport, sizeof(rdp.viewport)) != 0) {
-            gfx_flush();
-            gfx_rapi->set_viewport(rdp.viewport.x, rdp.viewport.y, rdp.viewport.width, rdp.viewport.height);
-            rendering_state.viewport = rdp.viewport;
-        }
-        if (memcmp(&rdp.scissor, &rendering_state.scissor, sizeof(rdp.scissor)) != 0) {
-            gfx_flush();
-            gfx_rapi->set_scissor(rdp.scissor.x, rdp.scissor.y, rdp.scissor.width, rdp.scissor.height);
-            rendering_state.scissor = rdp.scissor;
-        }
-        rdp.viewport_or_scissor_changed = false;
-    }
 
+    DrawState state = {};
+    state.depth_test_and_mask = (depth_test ? 1 : 0) | (depth_mask ? 2 : 0);
+    state.decal_mode = zmode_decal;
+    state.viewport = rdp.viewport;
+    state.scissor = rdp.scissor;
 
     uint64_t cc_id = rdp.combine_mode;
     bool use_alpha = (rdp.other_mode_l & (3 << 20)) == (G_BL_CLR_MEM << 20) && (rdp.other_mode_l & (3 << 16)) == (G_BL_1MA << 16);
@@ -1244,7 +2550,11 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
         uint32_t tile = rdp.first_tile_index + i;
         if (comb->used_textures[i]) {
             if (rdp.textures_changed[i]) {
-                gfx_flush();
+                if (i == 0 && texture_fb_bound) {
+                    // Triangles recorded so far sample the framebuffer, which importing replaces
+                    gfx_flush();
+                    texture_fb_bound = false;
+                }
                 import_texture(i, tile);
                 rdp.textures_changed[i] = false;
             }
@@ -1290,13 +2600,11 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
                 cmt &= ~G_TX_CLAMP;
             }
 
-            bool linear_filter = (rdp.other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT;
-            if (linear_filter != rendering_state.textures[i]->second.linear_filter || cms != rendering_state.textures[i]->second.cms || cmt != rendering_state.textures[i]->second.cmt) {
-                gfx_flush();
-                gfx_rapi->set_sampler_parameters(i, linear_filter, cms, cmt);
-                rendering_state.textures[i]->second.linear_filter = linear_filter;
-                rendering_state.textures[i]->second.cms = cms;
-                rendering_state.textures[i]->second.cmt = cmt;
+            if (i != 0 || !texture_fb_bound) {
+                state.textures[i] = texture_slots[i];
+                state.linear_filter[i] = (rdp.other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT;
+                state.cms[i] = cms;
+                state.cmt[i] = cmt;
             }
         }
     }
@@ -1305,16 +2613,13 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
     if (prg == NULL) {
         comb->prg[tm] = prg = gfx_lookup_or_create_shader_program(comb->shader_id0, comb->shader_id1 | (tm * SHADER_OPT_TEXEL0_CLAMP_S));
     }
-    if (prg != rendering_state.shader_program) {
-        gfx_flush();
-        gfx_rapi->unload_shader(rendering_state.shader_program);
-        gfx_rapi->load_shader(prg);
-        rendering_state.shader_program = prg;
-    }
-    if (use_alpha != rendering_state.alpha_blend) {
-        gfx_flush();
-        gfx_rapi->set_use_alpha(use_alpha);
-        rendering_state.alpha_blend = use_alpha;
+    state.shader_program = prg;
+    state.alpha_blend = use_alpha;
+
+    if (draw_list.empty() || !(draw_list.back().state == state)) {
+        bool reorderable = state.depth_test_and_mask == 3 && !zmode_decal && !use_alpha && !invisible;
+        draw_list.push_back({ state, reorderable, buf_vbo_len, 0, buf_ibo_len, 0, 0 });
+        vertex_output_epoch++;
     }
     uint8_t num_inputs;
     bool used_textures[2];
@@ -1328,7 +2633,27 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
 
     struct GfxClipParameters clip_parameters = gfx_rapi->get_clip_parameters();
 
+    // The LOD fraction below is the only vertex input that depends on the triangle rather than the vertex.
+    bool share_vertices = gfx_rapi->draw_indexed_triangles != nullptr;
+    for (int j = 0; j < num_inputs; j++) {
+        if (comb->shader_input_mapping[0][j] == G_CCMUX_LOD_FRACTION || (use_alpha && comb->shader_input_mapping[1][j] == G_CCMUX_LOD_FRACTION)) {
+            share_vertices = false;
+        }
+    }
+
+    DrawBatch& batch = draw_list.back();
+
     for (int i = 0; i < 3; i++) {
+        size_t vtx_idx = v_arr[i] - rsp.loaded_vertices;
+        if (share_vertices && vertex_outputs[vtx_idx].epoch == vertex_output_epoch) {
+            buf_ibo[buf_ibo_len++] = vertex_outputs[vtx_idx].index;
+            continue;
+        }
+        if (share_vertices) {
+            vertex_outputs[vtx_idx] = { vertex_output_epoch, (uint16_t)batch.num_verts };
+        }
+        buf_ibo[buf_ibo_len++] = (uint16_t)batch.num_verts++;
+
         float z = v_arr[i]->z, w = v_arr[i]->w;
         if (clip_parameters.z_is_from_0_to_1) {
             z = (z + w) / 2.0f;
@@ -1502,12 +2827,10 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
         //buf_vbo[buf_vbo_len++] = color->a / 255.0f;
     }
 
-    if (++buf_vbo_num_tris == MAX_BUFFERED) {
-        //if (++buf_vbo_num_tris == 1) {
-        if (markerOn)
-        {
-            int bp = 0;
-        }
+    batch.vbo_len = buf_vbo_len - batch.vbo_offset;
+    batch.num_tris++;
+
+    if (++buf_vbo_num_tris == MAX_DEFERRED) {
         gfx_flush();
     }
 }
@@ -1552,7 +2875,6 @@ static void gfx_calc_and_set_viewport(const Vp_t *viewport) {
 
     gfx_adjust_viewport_or_scissor(&rdp.viewport);
 
-    rdp.viewport_or_scissor_changed = true;
 }
 
 static void gfx_sp_movemem(uint8_t index, uint8_t offset, const void* data) {
@@ -1636,7 +2958,6 @@ static void gfx_dp_set_scissor(uint32_t mode, uint32_t ulx, uint32_t uly, uint32
 
     gfx_adjust_viewport_or_scissor(&rdp.scissor);
 
-    rdp.viewport_or_scissor_changed = true;
 }
 
 static void gfx_dp_set_texture_image(uint32_t format, uint32_t size, uint32_t width, const void* addr, const char* otr_path) {
@@ -1919,7 +3240,6 @@ static void gfx_draw_rectangle(int32_t ulx, int32_t uly, int32_t lrx, int32_t lr
     gfx_adjust_viewport_or_scissor(&default_viewport);
 
     rdp.viewport = default_viewport;
-    rdp.viewport_or_scissor_changed = true;
     rsp.geometry_mode = 0;
 
     gfx_sp_tri1(MAX_VERTICES + 0, MAX_VERTICES + 1, MAX_VERTICES + 3, true);
@@ -1927,7 +3247,6 @@ static void gfx_draw_rectangle(int32_t ulx, int32_t uly, int32_t lrx, int32_t lr
 
     rsp.geometry_mode = geometry_mode_saved;
     rdp.viewport = viewport_saved;
-    rdp.viewport_or_scissor_changed = true;
 
     if (cycle_type == G_CYC_COPY) {
         rdp.other_mode_h = saved_other_mode_h;
@@ -2113,6 +3432,122 @@ extern "C"
     uintptr_t jsjutanShadowTex = 0;
 };
 
+// Pseudo commands that only ever appear in recorded display list streams, never in game display lists.
+#define G_REPLAY_VTX            0x50
+#define G_REPLAY_MTX            0x51
+#define G_REPLAY_SETTIMG        0x52
+#define G_REPLAY_BRANCH_Z       0x53
+
+// When display list replay is enabled, the first gfx_run of a frame records everything it executes into one
+// flattened stream: called display lists are inlined, OTR references are stored resolved, and vertex loads keep
+// the state they were transformed with along with their output. Later passes of the same frame, which only differ
+// in the matrices that were replaced for interpolation, run that stream instead and reuse every vertex load whose
+// transform and lighting came out the same.
+struct RecordedVertexLoad {
+    const Vtx* vertices;
+    uint32_t n_vertices;
+    uint32_t dest_index;
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t output_offset;
+};
+
+static bool dl_replay_enabled;
+static bool dl_recording;
+static const Gfx* recorded_dl;
+static vector<Gfx> recorded_commands;
+static vector<RecordedVertexLoad> recorded_vertex_loads;
+static vector<float> recorded_vertex_keys;
+static vector<LoadedVertex> recorded_vertex_outputs;
+static struct GfxDisplayListStats dl_stats;
+static uint64_t dl_commands; // Commands gfx_run_dl has run
+static vector<Gfx*>* dl_otr_capture; // Collects the OTR lookups of the benchmarked frame
+static std::atomic<bool> dl_benchmark_requested;
+static std::mutex dl_benchmark_mutex;
+static std::function<void(const GfxDisplayListBenchmarkResult&)> dl_benchmark_report;
+
+static void gfx_record_command(uint32_t w0, uintptr_t w1) {
+    Gfx g;
+    g.words.w0 = w0;
+    g.words.w1 = w1;
+    recorded_commands.push_back(g);
+}
+
+// The state gfx_sp_vertex reads that can differ between passes of a frame. Everything else it depends on is
+// set by commands that replay identically.
+static uint32_t gfx_vertex_load_key(float* key) {
+    uint32_t size = 0;
+
+    memcpy(key, rsp.MP_matrix, sizeof(rsp.MP_matrix));
+    size += 16;
+
+    if (rsp.geometry_mode & G_LIGHTING) {
+        if (rsp.lights_changed) {
+            gfx_sp_calculate_lights_coeffs();
+        }
+
+        for (int i = 0; i < rsp.current_num_lights - 1; i++, size += 3) {
+            memcpy(&key[size], rsp.current_lights_coeffs[i], sizeof(rsp.current_lights_coeffs[i]));
+        }
+
+        memcpy(&key[size], rsp.current_lookat_coeffs, sizeof(rsp.current_lookat_coeffs));
+        size += 6;
+    }
+
+    return size;
+}
+
+static void gfx_sp_vertex_recorded(size_t n_vertices, size_t dest_index, const Vtx* vertices) {
+    gfx_sp_vertex(n_vertices, dest_index, vertices);
+
+    if (vertices == NULL || n_vertices == 0) {
+        return;
+    }
+
+    float key[16 + MAX_LIGHTS * 3 + 6];
+    RecordedVertexLoad load;
+    load.vertices = vertices;
+    load.n_vertices = n_vertices;
+    load.dest_index = dest_index;
+    load.key_offset = recorded_vertex_keys.size();
+    load.key_size = gfx_vertex_load_key(key);
+    load.output_offset = recorded_vertex_outputs.size();
+
+    recorded_vertex_keys.insert(recorded_vertex_keys.end(), key, key + load.key_size);
+    recorded_vertex_outputs.insert(recorded_vertex_outputs.end(), &rsp.loaded_vertices[dest_index], &rsp.loaded_vertices[dest_index + n_vertices]);
+    gfx_record_command(G_REPLAY_VTX << 24, recorded_vertex_loads.size());
+    recorded_vertex_loads.push_back(load);
+}
+
+static void gfx_sp_vertex_replayed(const RecordedVertexLoad& load) {
+    float key[16 + MAX_LIGHTS * 3 + 6];
+    uint32_t key_size = gfx_vertex_load_key(key);
+
+    dl_stats.vertex_loads++;
+
+    if (key_size == load.key_size && memcmp(key, &recorded_vertex_keys[load.key_offset], key_size * sizeof(float)) == 0) {
+        memcpy(&rsp.loaded_vertices[load.dest_index], &recorded_vertex_outputs[load.output_offset], load.n_vertices * sizeof(LoadedVertex));
+        dl_stats.vertex_loads_reused++;
+    } else {
+        gfx_sp_vertex(load.n_vertices, load.dest_index, load.vertices);
+    }
+}
+
+static bool gfx_is_triangle_command(uint32_t opcode) {
+    switch (opcode) {
+        case (uint8_t)G_TRI1:
+#ifdef F3DEX_GBI_2
+        case G_QUAD:
+#endif
+#if defined(F3DEX_GBI) || defined(F3DLP_GBI)
+        case (uint8_t)G_TRI2:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
 static void gfx_run_dl(Gfx* cmd) {
     //puts("dl");
     int dummy = 0;
@@ -2122,8 +3557,25 @@ static void gfx_run_dl(Gfx* cmd) {
     Gfx* dListStart = cmd;
     uint64_t ourHash = -1;
 
+    // Branches recorded by this call, whose end of display list index is only known once it returns.
+    vector<size_t> recorded_branches;
+
     for (;;) {
         uint32_t opcode = cmd->words.w0 >> 24;
+        Gfx* cmdStart = cmd;
+        bool record = dl_recording;
+
+        dl_commands++;
+        if (dl_otr_capture != nullptr) {
+            if ((opcode == G_DL_OTR && C0(16, 1) == 0) || opcode == G_MTX_OTR || opcode == G_VTX_OTR ||
+                opcode == G_SETTIMG_OTR) {
+                dl_otr_capture->push_back(cmd);
+            }
+        }
+
+        if (!gfx_is_triangle_command(opcode)) {
+            vertex_output_epoch++;
+        }
         //uint32_t opcode = cmd->words.w0 & 0xFF;
 
         //if (markerOn)
@@ -2145,6 +3597,7 @@ static void gfx_run_dl(Gfx* cmd) {
 #endif
 
             markerOn = true;
+            record = false;
         }
             break;
         case G_INVALTEXCACHE:
@@ -2183,16 +3636,24 @@ static void gfx_run_dl(Gfx* cmd) {
                 }
 
 #ifdef F3DEX_GBI_2
-                gfx_sp_matrix(C0(0, 8) ^ G_MTX_PUSH, (const int32_t *) seg_addr(mtxAddr));
+                uint8_t parameters = C0(0, 8) ^ G_MTX_PUSH;
+                const int32_t* mtx = (const int32_t *) seg_addr(mtxAddr);
 #else
-                gfx_sp_matrix(C0(16, 8), (const int32_t *) seg_addr(cmd->words.w1));
+                uint8_t parameters = C0(16, 8);
+                const int32_t* mtx = (const int32_t *) seg_addr(cmd->words.w1);
 #endif
+                gfx_sp_matrix(parameters, mtx);
+
+                if (record) {
+                    gfx_record_command((G_REPLAY_MTX << 24) | parameters, (uintptr_t)mtx);
+                    record = false;
+                }
                 break;
             }
             case G_MTX_OTR: {
-                cmd++;
+                int32_t* mtx = ResourceMgr_LoadMtxByOTRCmd(cmd);
 
-                uint64_t hash = ((uint64_t)cmd->words.w0 << 32) + cmd->words.w1;
+                cmd++;
 
 #if _DEBUG
                 //char fileName[4096];
@@ -2201,18 +3662,24 @@ static void gfx_run_dl(Gfx* cmd) {
                 //printf("G_MTX_OTR: %s\n", fileName);
 #endif
 
-                int32_t* mtx = ResourceMgr_LoadMtxByCRC(hash);
-
 #ifdef F3DEX_GBI_2
                 if (mtx != NULL)
                 {
                     cmd--;
                     gfx_sp_matrix(C0(0, 8) ^ G_MTX_PUSH, mtx);
+
+                    if (record)
+                        gfx_record_command((G_REPLAY_MTX << 24) | (C0(0, 8) ^ G_MTX_PUSH), (uintptr_t)mtx);
+
                     cmd++;
                 }
 #else
                 gfx_sp_matrix(C0(16, 8), (const int32_t*)seg_addr(cmd->words.w1));
+
+                if (record)
+                    gfx_record_command((G_REPLAY_MTX << 24) | C0(16, 8), (uintptr_t)seg_addr(cmd->words.w1));
 #endif
+                record = false;
                 break;
             }
             case (uint8_t)G_POPMTX:
@@ -2244,13 +3711,24 @@ static void gfx_run_dl(Gfx* cmd) {
 #endif
                 break;
             case G_VTX:
+            {
 #ifdef F3DEX_GBI_2
-                gfx_sp_vertex(C0(12, 8), C0(1, 7) - C0(12, 8), (const Vtx*)seg_addr(cmd->words.w1));
+                size_t n_vertices = C0(12, 8);
+                size_t dest_index = C0(1, 7) - C0(12, 8);
 #elif defined(F3DEX_GBI) || defined(F3DLP_GBI)
-                gfx_sp_vertex(C0(10, 6), C0(16, 8) / 2, seg_addr(cmd->words.w1));
+                size_t n_vertices = C0(10, 6);
+                size_t dest_index = C0(16, 8) / 2;
 #else
-                gfx_sp_vertex((C0(0, 16)) / sizeof(Vtx), C0(16, 4), seg_addr(cmd->words.w1));
+                size_t n_vertices = (C0(0, 16)) / sizeof(Vtx);
+                size_t dest_index = C0(16, 4);
 #endif
+                if (record) {
+                    gfx_sp_vertex_recorded(n_vertices, dest_index, (const Vtx*)seg_addr(cmd->words.w1));
+                    record = false;
+                } else {
+                    gfx_sp_vertex(n_vertices, dest_index, (const Vtx*)seg_addr(cmd->words.w1));
+                }
+            }
                 break;
             case G_VTX_OTR:
             {
@@ -2267,7 +3745,10 @@ static void gfx_run_dl(Gfx* cmd) {
                 if (offset > 0xFFFFF)
                 {
                     cmd--;
-                    gfx_sp_vertex(C0(12, 8), C0(1, 7) - C0(12, 8), (Vtx*)offset);
+                    if (record)
+                        gfx_sp_vertex_recorded(C0(12, 8), C0(1, 7) - C0(12, 8), (Vtx*)offset);
+                    else
+                        gfx_sp_vertex(C0(12, 8), C0(1, 7) - C0(12, 8), (Vtx*)offset);
                     cmd++;
                 }
                 else
@@ -2285,10 +3766,15 @@ static void gfx_run_dl(Gfx* cmd) {
 
                         cmd->words.w1 = (uintptr_t)vtx;
 
-                        gfx_sp_vertex(C0(12, 8), C0(1, 7) - C0(12, 8), vtx);
+                        if (record)
+                            gfx_sp_vertex_recorded(C0(12, 8), C0(1, 7) - C0(12, 8), vtx);
+                        else
+                            gfx_sp_vertex(C0(12, 8), C0(1, 7) - C0(12, 8), vtx);
                         cmd++;
                     }
                 }
+
+                record = false;
             }
                 break;
             case G_MODIFYVTX:
@@ -2307,15 +3793,18 @@ static void gfx_run_dl(Gfx* cmd) {
                     cmd = (Gfx *)seg_addr(cmd->words.w1);
                     --cmd; // increase after break
                 }
+
+                // Called display lists record themselves inline, jumps just continue recording at their target.
+                record = false;
                 break;
             case G_DL_OTR:
                 if (C0(16, 1) == 0)
                 {
                     // Push return address
 
-                    cmd++;
+                    Gfx* gfx = ResourceMgr_LoadGfxByOTRCmd(cmd);
 
-                    uint64_t hash = ((uint64_t)cmd->words.w0 << 32) + cmd->words.w1;
+                    cmd++;
 
 #if _DEBUG
                     //char fileName[4096];
@@ -2324,8 +3813,6 @@ static void gfx_run_dl(Gfx* cmd) {
                     //printf("G_DL_OTR: %s\n", fileName);
 #endif
 
-                    Gfx* gfx = ResourceMgr_LoadGfxByCRC(hash);
-
                     if (gfx != 0)
                         gfx_run_dl(gfx);
                 }
@@ -2334,6 +3821,8 @@ static void gfx_run_dl(Gfx* cmd) {
                     cmd++;
                     --cmd; // increase after break
                 }
+
+                record = false;
                 break;
             case G_BRANCH_Z_OTR:
             {
@@ -2341,10 +3830,20 @@ static void gfx_run_dl(Gfx* cmd) {
 
                 uint8_t vbidx = cmd->words.w0 & 0x00000FFF;
                 uint32_t zval = cmd->words.w1;
+                bool taken = rsp.loaded_vertices[vbidx].z <= zval;
+
+                // The outcome depends on transformed vertices, so replays check it again and fall back to
+                // interpreting from this command if it changed. The end index is patched in at G_ENDDL.
+                if (record) {
+                    recorded_branches.push_back(recorded_commands.size());
+                    gfx_record_command((G_REPLAY_BRANCH_Z << 24) | (taken ? 0x10000 : 0) | vbidx, zval);
+                    gfx_record_command(0, (uintptr_t)cmd);
+                    record = false;
+                }
 
                 cmd++;
 
-                if (rsp.loaded_vertices[vbidx].z <= zval)
+                if (taken)
                 {
 
                     uint64_t hash = ((uint64_t)cmd->words.w0 << 32) + cmd->words.w1;
@@ -2372,6 +3871,10 @@ static void gfx_run_dl(Gfx* cmd) {
                     //printf("END DL ON MARKER\n");
 
                 markerOn = false;
+
+                for (size_t index : recorded_branches) {
+                    recorded_commands[index + 1].words.w0 = recorded_commands.size();
+                }
                 return;
 #ifdef F3DEX_GBI_2
             case G_GEOMETRYMODE:
@@ -2433,6 +3936,12 @@ static void gfx_run_dl(Gfx* cmd) {
                         i = (uintptr_t)ResourceMgr_LoadTexByName(imgData);
 
                 gfx_dp_set_texture_image(C0(21, 3), C0(19, 2), C0(0, 10), (void*) i, imgData);
+
+                if (record) {
+                    gfx_record_command((G_REPLAY_SETTIMG << 24) | (cmd->words.w0 & 0x00FFFFFF), i);
+                    gfx_record_command(0, (uintptr_t)imgData);
+                    record = false;
+                }
                 break;
             }
             case G_SETTIMG_OTR:
@@ -2451,28 +3960,14 @@ static void gfx_run_dl(Gfx* cmd) {
                 char* tex = NULL;
 #endif
 
-                if (addr != 0)
-                {
+                cmd--;
+
+                // Resolved commands keep a lookup table slot rather than the texture data, so the texture can be
+                // evicted and reloaded without leaving a dangling pointer behind in the display list.
+                if (addr != 0 && !(cmd->words.w0 & G_OTR_RESOLVED))
                     tex = (char*)addr;
-                }
                 else
-                {
-                    tex = ResourceMgr_LoadTexByCRC(hash);
-
-                    if (tex != nullptr)
-                    {
-                        cmd--;
-                        uintptr_t oldData = cmd->words.w1;
-                        cmd->words.w1 = (uintptr_t)tex;
-
-                        if (ourHash != (uint64_t)-1)
-                            ResourceMgr_RegisterResourcePatch(ourHash, cmd - dListStart, oldData);
-
-                        cmd++;
-                    }
-                }
-
-                cmd--;
+                    tex = ResourceMgr_LoadTexByOTRCmd(cmd);
 
 
                 uint32_t fmt = C0(21, 3);
@@ -2482,6 +3977,12 @@ static void gfx_run_dl(Gfx* cmd) {
                 if (tex != NULL)
                     gfx_dp_set_texture_image(fmt, size, width, tex, fileName);
 
+                if (record && tex != NULL) {
+                    gfx_record_command((G_REPLAY_SETTIMG << 24) | (fmt << 21) | (size << 19) | width, (uintptr_t)tex);
+                    gfx_record_command(0, (uintptr_t)fileName);
+                }
+
+                record = false;
                 cmd++;
                 break;
             }
@@ -2505,6 +4006,8 @@ static void gfx_run_dl(Gfx* cmd) {
             {
                 gfx_flush();
                 gfx_rapi->select_texture_fb(cmd->words.w1);
+                rendering_state.texture_ids[0] = UINT32_MAX;
+                texture_fb_bound = true;
                 rdp.textures_changed[0] = false;
                 rdp.textures_changed[1] = false;
 
@@ -2650,9 +4153,50 @@ static void gfx_run_dl(Gfx* cmd) {
             case G_BG_COPY:
                 if (!markerOn)
                     gfx_s2dex_bg_copy((const uObjBg*)cmd->words.w1); // not seg_addr here it seems
+                else
+                    record = false;
+
+                break;
+            case G_REPLAY_VTX:
+                gfx_sp_vertex_replayed(recorded_vertex_loads[cmd->words.w1]);
+                break;
+            case G_REPLAY_MTX:
+                gfx_sp_matrix(C0(0, 8), (const int32_t*)cmd->words.w1);
+                break;
+            case G_REPLAY_SETTIMG:
+            {
+                const void* tex = (const void*)cmd->words.w1;
+                uint32_t fmt = C0(21, 3);
+                uint32_t size = C0(19, 2);
+                uint32_t width = C0(0, 10);
+
+                cmd++;
+                gfx_dp_set_texture_image(fmt, size, width, tex, (const char*)cmd->words.w1);
+                break;
+            }
+            case G_REPLAY_BRANCH_Z:
+            {
+                uint8_t vbidx = C0(0, 12);
+                bool taken = rsp.loaded_vertices[vbidx].z <= (uint32_t)cmd->words.w1;
+                bool recorded_taken = C0(16, 1);
+
+                cmd++;
 
+                if (taken != recorded_taken) {
+                    // Interpret the rest of the display list the branch was recorded in, then skip past it.
+                    dl_stats.branch_divergences++;
+                    gfx_run_dl((Gfx*)cmd->words.w1);
+                    cmd = &recorded_commands[cmd->words.w0];
+                    --cmd; // increase after break
+                }
                 break;
+            }
+        }
+
+        if (record) {
+            recorded_commands.insert(recorded_commands.end(), cmdStart, cmd + 1);
         }
+
         ++cmd;
     }
 }
@@ -2689,38 +4233,11 @@ void gfx_init(struct GfxWindowManagerAPI *wapi, struct GfxRenderingAPI *rapi, co
     for (int i = 0; i < 16; i++)
         segmentPointers[i] = 0;
 
-    // Used in the 120 star TAS
-    static uint32_t precomp_shaders[] = {
-        0x01200200,
-        0x00000045,
-        0x00000200,
-        0x01200a00,
-        0x00000a00,
-        0x01a00045,
-        0x00000551,
-        0x01045045,
-        0x05a00a00,
-        0x01200045,
-        0x05045045,
-        0x01045a00,
-        0x01a00a00,
-        0x0000038d,
-        0x01081081,
-        0x0120038d,
-        0x03200045,
-        0x03200a00,
-        0x01a00a6f,
-        0x01141045,
-        0x07a00a00,
-        0x05200200,
-        0x03200200,
-        0x09200200,
-        0x0920038d,
-        0x09200045
-    };
-    for (size_t i = 0; i < sizeof(precomp_shaders) / sizeof(uint32_t); i++) {
-        //gfx_lookup_or_create_shader_program(precomp_shaders[i]);
-    }
+    // Texture id 0 is valid for some backends, so nothing may count as bound yet.
+    rendering_state.texture_ids[0] = rendering_state.texture_ids[1] = UINT32_MAX;
+    draw_list.reserve(1024);
+
+    gfx_shader_cache_precompile();
 
     Ship::ExecuteHooks<Ship::GfxInit>();
 }
@@ -2773,9 +4290,154 @@ void gfx_start_frame(void) {
     fbActive = 0;
 }
 
-void gfx_run(Gfx *commands, const std::unordered_map<Mtx *, MtxF>& mtx_replacements) {
+static void* gfx_lookup_otr_command_by_hash(const Gfx* cmd) {
+    const uint64_t hash = ((uint64_t)cmd[1].words.w0 << 32) + cmd[1].words.w1;
+
+    switch (cmd->words.w0 >> 24) {
+        case G_DL_OTR:
+            return ResourceMgr_LoadGfxByCRC(hash);
+        case G_MTX_OTR:
+            return ResourceMgr_LoadMtxByCRC(hash);
+        case G_VTX_OTR:
+            return ResourceMgr_LoadVtxByCRC(hash);
+        default:
+            return ResourceMgr_LoadTexByCRC(hash);
+    }
+}
+
+static void* gfx_lookup_otr_command(Gfx* cmd) {
+    switch (cmd->words.w0 >> 24) {
+        case G_DL_OTR:
+            return ResourceMgr_LoadGfxByOTRCmd(cmd);
+        case G_MTX_OTR:
+            return ResourceMgr_LoadMtxByOTRCmd(cmd);
+        case G_VTX_OTR:
+            // Patched in place the first time it runs
+            return (void*)cmd->words.w1;
+        default: {
+            const uint64_t hash = ((uint64_t)cmd[1].words.w0 << 32) + cmd[1].words.w1;
+            ResourceMgr_GetNameByCRC(hash);
+
+            if (cmd->words.w1 != 0 && !(cmd->words.w0 & G_OTR_RESOLVED))
+                return (void*)cmd->words.w1;
+
+            return ResourceMgr_LoadTexByOTRCmd(cmd);
+        }
+    }
+}
+
+// Each pass draws the whole frame, the real one is drawn over them afterwards.
+static void gfx_run_display_list_benchmark(Gfx* commands) {
+    const uint32_t passes = 10;
+    const struct GfxDisplayListStats saved_dl_stats = dl_stats;
+    const struct GfxDrawStats saved_draw_stats = draw_stats;
+    GfxDisplayListBenchmarkResult result = {};
+    vector<Gfx*> otr_commands;
+
+    auto run_pass = [](Gfx* dl, uint64_t* commands_run) {
+        gfx_sp_reset();
+        fbActive = 0;
+        gfx_rapi->start_draw_to_framebuffer(game_renders_to_framebuffer ? game_framebuffer : 0, (float)gfx_current_dimensions.height / SCREEN_HEIGHT);
+        gfx_rapi->clear_framebuffer();
+        rendering_state.viewport = {};
+        rendering_state.scissor = {};
+        rendering_state.texture_ids[0] = rendering_state.texture_ids[1] = UINT32_MAX;
+
+        const uint64_t start_commands = dl_commands;
+        auto start = std::chrono::steady_clock::now();
+        gfx_run_dl(dl);
+        gfx_flush();
+        *commands_run += dl_commands - start_commands;
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // Records the stream to replay, which also resolves every OTR command the frame runs.
+    recorded_commands.clear();
+    recorded_vertex_loads.clear();
+    recorded_vertex_keys.clear();
+    recorded_vertex_outputs.clear();
+    uint64_t recorded_pass_commands = 0;
+    dl_recording = true;
+    dl_otr_capture = &otr_commands;
+    run_pass(commands, &recorded_pass_commands);
+    dl_otr_capture = nullptr;
+    dl_recording = false;
+    gfx_record_command((uint32_t)(uint8_t)G_ENDDL << 24, 0);
+
+    result.passes = passes;
+    for (uint32_t i = 0; i < passes; i++) {
+        result.interpret_time += run_pass(commands, &result.interpreted_commands) / passes;
+        result.replay_time += run_pass(recorded_commands.data(), &result.replayed_commands) / passes;
+    }
+
+    static const uint32_t otr_opcodes[] = { G_DL_OTR, G_MTX_OTR, G_VTX_OTR, G_SETTIMG_OTR };
+    static const char* otr_names[] = { "G_DL_OTR", "G_MTX_OTR", "G_VTX_OTR", "G_SETTIMG_OTR" };
+    volatile uintptr_t sink;
+
+    for (size_t i = 0; i < 4; i++) {
+        vector<Gfx*> cmds;
+        for (Gfx* cmd : otr_commands) {
+            if (cmd->words.w0 >> 24 == otr_opcodes[i]) {
+                cmds.push_back(cmd);
+            }
+        }
+        if (cmds.empty()) {
+            continue;
+        }
+
+        // Enough repetitions for the clock's resolution not to matter.
+        const size_t repetitions = std::max<size_t>(100000 / cmds.size(), 1);
+        const double lookups = (double)repetitions * cmds.size();
+        GfxOtrLookupBenchmarkResult lookup = { otr_names[i], (uint32_t)cmds.size() };
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repetitions; r++) {
+            for (Gfx* cmd : cmds) {
+                sink = (uintptr_t)gfx_lookup_otr_command_by_hash(cmd);
+            }
+        }
+        lookup.hash_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repetitions; r++) {
+            for (Gfx* cmd : cmds) {
+                sink = (uintptr_t)gfx_lookup_otr_command(cmd);
+            }
+        }
+        lookup.resolved_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+
+        result.otr_lookups.push_back(lookup);
+    }
+
+    result.interpreted_commands /= passes;
+    result.replayed_commands /= passes;
+
+    // The real pass records again if replay is enabled.
+    recorded_dl = nullptr;
+    dl_stats = saved_dl_stats;
+    draw_stats = saved_draw_stats;
+
+    std::function<void(const GfxDisplayListBenchmarkResult&)> report;
+    {
+        std::lock_guard<std::mutex> lock(dl_benchmark_mutex);
+        report = std::move(dl_benchmark_report);
+    }
+    if (report) {
+        report(result);
+    }
+}
+
+void gfx_run(Gfx *commands, const std::unordered_map<Mtx *, MtxF>& mtx_replacements, bool replay) {
     gfx_sp_reset();
 
+    // A dropped first pass leaves nothing to replay, the next pass records instead.
+    replay = replay && dl_replay_enabled && recorded_dl == commands;
+    if (!replay) {
+        recorded_dl = nullptr;
+        // The game may have rewritten any texture since the last frame it built.
+        gfx_texture_cache.content_hashes.clear();
+    }
+
     //puts("New frame");
     get_pixel_depth_pending.clear();
     get_pixel_depth_cached.clear();
@@ -2800,13 +4462,48 @@ void gfx_run(Gfx *commands, const std::unordered_map<Mtx *, MtxF>& mtx_replaceme
     double t0 = gfx_wapi->get_time();
     gfx_rapi->update_framebuffer_parameters(0, gfx_current_window_dimensions.width, gfx_current_window_dimensions.height, 1, false, true, true, !game_renders_to_framebuffer);
     gfx_rapi->start_frame();
+    if (!replay && dl_benchmark_requested.exchange(false)) {
+        gfx_run_display_list_benchmark(commands);
+    }
     gfx_rapi->start_draw_to_framebuffer(game_renders_to_framebuffer ? game_framebuffer : 0, (float)gfx_current_dimensions.height / SCREEN_HEIGHT);
     gfx_rapi->clear_framebuffer();
-    rdp.viewport_or_scissor_changed = true;
     rendering_state.viewport = {};
     rendering_state.scissor = {};
-    gfx_run_dl(commands);
+    // The menu is drawn with the same backend between frames and leaves its own textures bound.
+    rendering_state.texture_ids[0] = rendering_state.texture_ids[1] = UINT32_MAX;
+
+    auto dl_start = std::chrono::steady_clock::now();
+    const uint64_t dl_start_commands = dl_commands;
+    if (replay) {
+        gfx_run_dl(recorded_commands.data());
+    } else if (dl_replay_enabled) {
+        recorded_commands.clear();
+        recorded_vertex_loads.clear();
+        recorded_vertex_keys.clear();
+        recorded_vertex_outputs.clear();
+
+        dl_recording = true;
+        gfx_run_dl(commands);
+        dl_recording = false;
+
+        gfx_record_command((uint32_t)(uint8_t)G_ENDDL << 24, 0);
+        recorded_dl = commands;
+    } else {
+        gfx_run_dl(commands);
+    }
     gfx_flush();
+    draw_stats.frames++;
+
+    double dl_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - dl_start).count();
+    if (replay) {
+        dl_stats.replayed_passes++;
+        dl_stats.replayed_commands += dl_commands - dl_start_commands;
+        dl_stats.replay_time += dl_time;
+    } else {
+        dl_stats.interpreted_passes++;
+        dl_stats.interpreted_commands += dl_commands - dl_start_commands;
+        dl_stats.interpret_time += dl_time;
+    }
     gfxFramebuffer = 0;
     if (game_renders_to_framebuffer) {
         gfx_rapi->start_draw_to_framebuffer(0, 1);
@@ -2836,6 +4533,45 @@ void gfx_run(Gfx *commands, const std::unordered_map<Mtx *, MtxF>& mtx_replaceme
     has_drawn_imgui_menu = false;
 }
 
+void gfx_set_display_list_replay(bool enable) {
+    dl_replay_enabled = enable;
+    recorded_dl = nullptr;
+}
+
+struct GfxDisplayListStats gfx_get_display_list_stats(void) {
+    return dl_stats;
+}
+
+void gfx_reset_display_list_stats(void) {
+    dl_stats = {};
+}
+
+void gfx_request_display_list_benchmark(std::function<void(const GfxDisplayListBenchmarkResult&)> report) {
+    std::lock_guard<std::mutex> lock(dl_benchmark_mutex);
+    dl_benchmark_report = std::move(report);
+    dl_benchmark_requested = true;
+}
+
+void gfx_set_shader_cache_path(const char* path) {
+    shader_cache_path = path;
+}
+
+struct GfxShaderStats gfx_get_shader_stats(void) {
+    return shader_stats;
+}
+
+void gfx_set_draw_reordering(bool enable) {
+    draw_reordering = enable;
+}
+
+struct GfxDrawStats gfx_get_draw_stats(void) {
+    return draw_stats;
+}
+
+void gfx_reset_draw_stats(void) {
+    draw_stats = {};
+}
+
 void gfx_end_frame(void) {
     if (!dropped_frame) {
         gfx_rapi->finish_render();
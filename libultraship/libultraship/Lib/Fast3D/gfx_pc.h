@@ -5,8 +5,11 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <unordered_map>
+#include <vector>
 #include <list>
+#include <string>
 #include <cstddef>
+#include <functional>
 
 #include "U64/PR/ultra64/types.h"
 
@@ -22,6 +25,8 @@ struct GfxWindowManagerAPI;
 struct XYWidthHeight {
     int16_t x, y;
     uint32_t width, height;
+
+    bool operator==(const XYWidthHeight&) const noexcept = default;
 };
 
 struct GfxDimensions {
@@ -36,12 +41,16 @@ struct TextureCacheKey {
     uint8_t fmt, siz;
     uint8_t palette_index;
 
+    // Only set when the cache is keyed by content, in which case the addresses above are not.
+    uint64_t content_hash;
+    uint32_t size_bytes, line_size_bytes;
+
     bool operator==(const TextureCacheKey&) const noexcept = default;
 
     struct Hasher {
         size_t operator()(const TextureCacheKey& key) const noexcept {
             uintptr_t addr = (uintptr_t)key.texture_addr;
-            return (size_t)(addr ^ (addr >> 5));
+            return (size_t)(addr ^ (addr >> 5) ^ key.content_hash);
         }
     };
 };
@@ -53,6 +62,7 @@ struct TextureCacheValue {
     uint32_t texture_id;
     uint8_t cms, cmt;
     bool linear_filter;
+    uint32_t upload_bytes;
 
     std::list<struct TextureCacheMapIter>::iterator lru_location;
 };
@@ -61,6 +71,72 @@ struct TextureCacheMapIter {
     TextureCacheMap::iterator it;
 };
 
+struct GfxTextureCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t upload_bytes;
+    size_t entries;
+    size_t bytes; // Size of the textures currently uploaded
+    size_t budget;
+};
+
+struct GfxDisplayListStats {
+    uint64_t interpreted_passes;
+    uint64_t replayed_passes;
+    uint64_t vertex_loads; // Vertex loads run while replaying
+    uint64_t vertex_loads_reused;
+    uint64_t branch_divergences;
+    uint64_t interpreted_commands; // Commands run, nested display lists included
+    uint64_t replayed_commands;
+    double interpret_time; // Seconds spent running display lists
+    double replay_time;
+};
+
+struct GfxShaderStats {
+    uint64_t precompiled; // Created from the shader cache before the first frame
+    uint64_t compiled; // Created the first time the game used them
+    double precompile_time; // Seconds
+    double compile_time;
+};
+
+struct GfxTextureBenchmarkResult {
+    const char* format;
+    double mb_per_second; // RGBA32 output
+    uint32_t checks; // Sizes, palettes and layouts the converter was compared against the per texel reference on
+    uint32_t mismatches; // Checks whose output differed from the reference in any byte
+};
+
+struct GfxVertexBenchmarkResult {
+    std::string modes; // Geometry modes and aspect correction the vertices were loaded with
+    double scalar_vertices_per_second;
+    double batched_vertices_per_second[2]; // Four and eight wide batches, 0 where this build or CPU has none
+    bool bit_exact; // Every batch width produced the same vertices as the scalar loop
+};
+
+struct GfxOtrLookupBenchmarkResult {
+    const char* opcode;
+    uint32_t commands; // Commands of this kind the frame ran
+    double hash_ns; // Per lookup through the hash, as every command did before it was resolved
+    double resolved_ns; // Per lookup as the interpreter does it now, replays read the recorded pointer instead
+};
+
+struct GfxDisplayListBenchmarkResult {
+    uint32_t passes;
+    uint64_t interpreted_commands; // Per pass
+    uint64_t replayed_commands;
+    double interpret_time; // Seconds per pass, draw calls included
+    double replay_time;
+    std::vector<GfxOtrLookupBenchmarkResult> otr_lookups;
+};
+
+struct GfxDrawStats {
+    uint64_t frames;
+    uint64_t triangles;
+    uint64_t batches; // Runs of triangles sharing render state, each used to be its own draw call
+    uint64_t draw_calls;
+    uint64_t state_switches; // Shader, texture, sampler, depth, blend, viewport and scissor changes
+};
+
 extern "C" {
 
 extern struct GfxDimensions gfx_current_window_dimensions; // The dimensions of the window
@@ -70,16 +146,43 @@ extern uint32_t gfx_msaa_level;
 
 }
 
+// Shader programs the game creates are listed in this file, and the ones already listed are created by gfx_init.
+// Empty by default, which disables the list. Must be set before gfx_init.
+void gfx_set_shader_cache_path(const char* path);
+struct GfxShaderStats gfx_get_shader_stats(void);
 void gfx_init(struct GfxWindowManagerAPI* wapi, struct GfxRenderingAPI* rapi, const char* game_name, bool start_in_fullscreen, uint32_t width = SCREEN_WIDTH, uint32_t height = SCREEN_HEIGHT);
 struct GfxRenderingAPI* gfx_get_current_rendering_api(void);
 void gfx_start_frame(void);
-void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacements);
+// With replay set, commands are the same display list the previous gfx_run executed with different matrix
+// replacements. If display list replay is enabled, the stream recorded by that call is run in their place.
+void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacements, bool replay = false);
+void gfx_set_display_list_replay(bool enable);
+struct GfxDisplayListStats gfx_get_display_list_stats(void);
+void gfx_reset_display_list_stats(void);
+// Lets opaque, depth tested triangles be drawn out of order, grouped by shader and texture, within a framebuffer pass.
+void gfx_set_draw_reordering(bool enable);
+struct GfxDrawStats gfx_get_draw_stats(void);
+void gfx_reset_draw_stats(void);
 void gfx_end_frame(void);
 void gfx_set_target_fps(int);
 void gfx_set_maximum_frame_latency(int latency);
 float gfx_get_detected_hz(void);
 void gfx_texture_cache_clear();
+void gfx_texture_cache_delete(const uint8_t* orig_addr);
+// Keys the texture cache by a hash of the texels and palette instead of their addresses, so textures with the same
+// content share one upload. A non zero budget caps the cache by uploaded bytes rather than by entry count.
+void gfx_texture_cache_set_mode(bool content_hash, size_t budget);
+struct GfxTextureCacheStats gfx_texture_cache_get_stats(void);
 extern "C" int gfx_create_framebuffer(uint32_t width, uint32_t height);
+// Checks every texture format converter against the per texel reference over random data of many sizes, every CI4
+// palette and CI8 with and without the upper half of the TLUT, then times each one.
+std::vector<GfxTextureBenchmarkResult> gfx_benchmark_texture_import(void);
+// Loads random vertices in every combination of lighting, texture generation, fog and aspect correction, checking each
+// batch width against the scalar loop and timing all of them.
+std::vector<GfxVertexBenchmarkResult> gfx_benchmark_vertices(void);
+// Runs the next frame's display list several times interpreted and replayed before drawing it, then times the
+// lookups of every OTR command the frame ran. The report is called on the thread that renders.
+void gfx_request_display_list_benchmark(std::function<void(const GfxDisplayListBenchmarkResult&)> report);
 void gfx_get_pixel_depth_prepare(float x, float y);
 uint16_t gfx_get_pixel_depth(float x, float y);
 
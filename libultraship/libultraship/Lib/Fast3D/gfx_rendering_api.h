@@ -66,6 +66,8 @@ struct GfxRenderingAPI {
     void (*delete_texture)(uint32_t texID);
     void (*set_texture_filter)(FilteringMode mode);
     FilteringMode(*get_texture_filter)(void);
+    // Optional. Draws triangles whose corners index into buf_vbo, three indices per triangle.
+    void (*draw_indexed_triangles)(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_verts, uint16_t buf_ibo[], size_t buf_ibo_num_tris);
 };
 
 #endif
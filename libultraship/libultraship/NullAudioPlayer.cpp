@@ -0,0 +1,33 @@
+#include "NullAudioPlayer.h"
+
+namespace Ship {
+    bool NullAudioPlayer::Init(void) {
+        Start = std::chrono::steady_clock::now();
+        SamplesPlayed = 0;
+        return true;
+    }
+
+    int NullAudioPlayer::Buffered(void) {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        const uint64_t consumed = (uint64_t)(elapsed * GetSampleRate());
+
+        // A real device sits idle once it runs dry, so an underrun must not leave time to be made up for later.
+        if (consumed > SamplesPlayed) {
+            Start += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((double)(consumed - SamplesPlayed) / GetSampleRate()));
+            return 0;
+        }
+        return (int)(SamplesPlayed - consumed);
+    }
+
+    int NullAudioPlayer::GetDesiredBuffered(void) {
+        return 2480;
+    }
+
+    void NullAudioPlayer::Play(const uint8_t* Buffer, uint32_t BufferLen) {
+        // 4 is sizeof(int16_t) * num_channels (2 for stereo)
+        if (Buffered() < 6000) {
+            SamplesPlayed += BufferLen / 4;
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "AudioPlayer.h"
+#include <chrono>
+
+namespace Ship {
+	// Audio player without a device, for headless runs. Audio is thrown away as fast as a real device would play it,
+	// so the audio thread keeps generating it at the usual pace.
+	class NullAudioPlayer : public AudioPlayer {
+	public:
+		NullAudioPlayer() {  };
+
+		bool Init(void) override;
+		int Buffered(void) override;
+		int GetDesiredBuffered(void) override;
+		void Play(const uint8_t* Buffer, uint32_t BufferLen) override;
+
+	private:
+		std::chrono::steady_clock::time_point Start;
+		uint64_t SamplesPlayed = 0;
+	};
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
+#include <functional>
 #include "Utils/BinaryReader.h"
 #include "Utils/BinaryWriter.h"
 #include "GlobalCtx2.h"
@@ -68,17 +70,23 @@ namespace Ship
         uintptr_t origData;
     };
 
-    class Resource
+    class Resource : public std::enable_shared_from_this<Resource>
     {
     public:
         ResourceMgr* resMgr;
         uint64_t id; // Unique Resource ID
         ResourceType resType;
-        bool isDirty = false;
+        std::atomic<bool> isDirty = false; // Read by lock-free lookups while DirtyDirectory sets it
+        std::atomic<bool> isPinned = false; // Raw pointers into the resource were handed to game code, never evict it
+        std::atomic<uint32_t> lastUsedFrame = 0; // ResourceMgr frame of the most recent cache hit
+        size_t memorySize = 0; // Bytes charged against the ResourceMgr memory budget
         void* cachedGameAsset = 0; // Conversion to OoT friendly struct cached...
         std::shared_ptr<File> file;
         std::vector<Patch> patches;
         virtual ~Resource();
+
+        // Approximate heap footprint of the decoded data, used for the resource memory budget.
+        virtual size_t GetMemorySize() const { return sizeof(*this); }
     };
 
     class ResourceFile
@@ -103,5 +111,9 @@ namespace Ship
         std::condition_variable resourceLoadNotifier;
         std::mutex resourceLoadMutex;
         bool bHasResourceLoaded = false;
+        // Set when the resource is decoded from the disk cache, in which case file is never read from the archive.
+        bool bLoadFromDiskCache = false;
+        // Run by the worker once the resource is cached, see ResourceMgr::PrefetchResource.
+        std::vector<std::function<void(std::shared_ptr<Resource>)>> onLoaded;
     };
 }
\ No newline at end of file
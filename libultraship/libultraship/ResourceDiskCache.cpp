@@ -0,0 +1,481 @@
+#include "ResourceDiskCache.h"
+#include "Texture.h"
+#include "DisplayList.h"
+#include "Blob.h"
+#include "Array.h"
+#include "Matrix.h"
+#include "Audio.h"
+#include "spdlog/spdlog.h"
+#include "Lib/StrHash64.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif !defined(__SWITCH__) && !defined(__WIIU__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Ship
+{
+	static const uint32_t CacheMagic = 0x4F545243; // OTRC
+	// Bump whenever the layout of a cached resource changes.
+	static const uint32_t CacheVersion = 2;
+
+	struct CacheHeader {
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t ArchiveKey;
+		uint64_t IndexOffset;
+		uint32_t EntryCount;
+		uint32_t PointerSize;
+	};
+
+	class CacheWriter {
+	public:
+		CacheWriter(std::vector<char>& Out) : Out(Out) {}
+
+		void WriteBytes(const void* Data, size_t Size) {
+			Out.insert(Out.end(), (const char*)Data, (const char*)Data + Size);
+		}
+
+		template <typename T>
+		void Write(const T& Value) {
+			WriteBytes(&Value, sizeof(T));
+		}
+
+		template <typename T>
+		void WriteVector(const std::vector<T>& Values) {
+			Write<uint32_t>((uint32_t)Values.size());
+			WriteBytes(Values.data(), Values.size() * sizeof(T));
+		}
+
+	private:
+		std::vector<char>& Out;
+	};
+
+	class CacheReader {
+	public:
+		CacheReader(const char* Data, size_t Size) : Data(Data), Size(Size), Pos(0), bFailed(false) {}
+
+		bool Failed() const { return bFailed; }
+
+		void ReadBytes(void* Dest, size_t Count) {
+			if (bFailed || Count > Size - Pos) {
+				bFailed = true;
+				return;
+			}
+
+			memcpy(Dest, Data + Pos, Count);
+			Pos += Count;
+		}
+
+		template <typename T>
+		T Read() {
+			T Value {};
+			ReadBytes(&Value, sizeof(T));
+			return Value;
+		}
+
+		template <typename T>
+		void ReadVector(std::vector<T>& Values) {
+			const uint32_t Count = Read<uint32_t>();
+
+			if (bFailed || Count > (Size - Pos) / sizeof(T)) {
+				bFailed = true;
+				return;
+			}
+
+			Values.resize(Count);
+			ReadBytes(Values.data(), Count * sizeof(T));
+		}
+
+	private:
+		const char* Data;
+		size_t Size;
+		size_t Pos;
+		bool bFailed;
+	};
+
+	static void SerializeResource(const Resource* Res, CacheWriter& Writer) {
+		Writer.Write(Res->id);
+
+		switch (Res->resType) {
+		case ResourceType::Texture: {
+			auto Tex = (const Texture*)Res;
+			Writer.Write(Tex->texType);
+			Writer.Write(Tex->width);
+			Writer.Write(Tex->height);
+			Writer.Write(Tex->imageDataSize);
+			Writer.WriteBytes(Tex->imageData, Tex->imageDataSize);
+			break;
+		}
+		case ResourceType::DisplayList:
+			Writer.WriteVector(((const DisplayList*)Res)->instructions);
+			break;
+		case ResourceType::Blob:
+			Writer.WriteVector(((const Blob*)Res)->data);
+			break;
+		case ResourceType::Array:
+			Writer.WriteVector(((const Array*)Res)->scalars);
+			Writer.WriteVector(((const Array*)Res)->vertices);
+			break;
+		case ResourceType::Matrix:
+			Writer.Write(((const Matrix*)Res)->mtx);
+			break;
+		case ResourceType::AudioSample: {
+			auto Sample = (const AudioSample*)Res;
+			Writer.Write(Sample->originalOffset);
+			Writer.Write(Sample->codec);
+			Writer.Write(Sample->medium);
+			Writer.Write(Sample->unk_bit26);
+			Writer.Write(Sample->unk_bit25);
+			Writer.WriteVector(Sample->data);
+			Writer.Write(Sample->loop.start);
+			Writer.Write(Sample->loop.end);
+			Writer.Write(Sample->loop.count);
+			Writer.WriteVector(Sample->loop.states);
+			Writer.Write(Sample->book.order);
+			Writer.Write(Sample->book.npredictors);
+			Writer.WriteVector(Sample->book.books);
+			break;
+		}
+		case ResourceType::AudioSequence: {
+			auto Seq = (const AudioSequence*)Res;
+			Writer.WriteVector(Seq->seqData);
+			Writer.Write(Seq->seqNumber);
+			Writer.Write(Seq->medium);
+			Writer.Write(Seq->cachePolicy);
+			Writer.WriteVector(Seq->fonts);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	static Resource* DeserializeResource(ResourceType Type, CacheReader& Reader) {
+		const uint64_t Id = Reader.Read<uint64_t>();
+		Resource* Res = nullptr;
+
+		switch (Type) {
+		case ResourceType::Texture: {
+			auto Tex = new Texture();
+			Tex->texType = Reader.Read<TextureType>();
+			Tex->width = Reader.Read<uint16_t>();
+			Tex->height = Reader.Read<uint16_t>();
+			const uint32_t ImageDataSize = Reader.Read<uint32_t>();
+
+			if (!Reader.Failed()) {
+				Tex->AllocateImageData(ImageDataSize);
+				Reader.ReadBytes(Tex->imageData, ImageDataSize);
+			}
+
+			Res = Tex;
+			break;
+		}
+		case ResourceType::DisplayList: {
+			auto DList = new DisplayList();
+			Reader.ReadVector(DList->instructions);
+			Res = DList;
+			break;
+		}
+		case ResourceType::Blob: {
+			auto Data = new Blob();
+			Reader.ReadVector(Data->data);
+			Res = Data;
+			break;
+		}
+		case ResourceType::Array: {
+			auto Arr = new Array();
+			Reader.ReadVector(Arr->scalars);
+			Reader.ReadVector(Arr->vertices);
+			Res = Arr;
+			break;
+		}
+		case ResourceType::Matrix: {
+			auto Mtx = new Matrix();
+			Mtx->mtx = Reader.Read<decltype(Mtx->mtx)>();
+			Res = Mtx;
+			break;
+		}
+		case ResourceType::AudioSample: {
+			auto Sample = new AudioSample();
+			Sample->originalOffset = Reader.Read<uint32_t>();
+			Sample->codec = Reader.Read<uint8_t>();
+			Sample->medium = Reader.Read<uint8_t>();
+			Sample->unk_bit26 = Reader.Read<uint8_t>();
+			Sample->unk_bit25 = Reader.Read<uint8_t>();
+			Reader.ReadVector(Sample->data);
+			Sample->loop.start = Reader.Read<uint32_t>();
+			Sample->loop.end = Reader.Read<uint32_t>();
+			Sample->loop.count = Reader.Read<uint32_t>();
+			Reader.ReadVector(Sample->loop.states);
+			Sample->book.order = Reader.Read<uint32_t>();
+			Sample->book.npredictors = Reader.Read<uint32_t>();
+			Reader.ReadVector(Sample->book.books);
+
+			// Only the compressed sample is cached, which keeps the cache file small.
+			if (AudioSample::Predecode) {
+				Sample->Decode();
+			}
+			Res = Sample;
+			break;
+		}
+		case ResourceType::AudioSequence: {
+			auto Seq = new AudioSequence();
+			Reader.ReadVector(Seq->seqData);
+			Seq->seqNumber = Reader.Read<uint8_t>();
+			Seq->medium = Reader.Read<uint8_t>();
+			Seq->cachePolicy = Reader.Read<uint8_t>();
+			Reader.ReadVector(Seq->fonts);
+			Res = Seq;
+			break;
+		}
+		default:
+			return nullptr;
+		}
+
+		if (Reader.Failed()) {
+			delete Res;
+			return nullptr;
+		}
+
+		Res->id = Id;
+		Res->resType = Type;
+
+		return Res;
+	}
+
+	ResourceDiskCache::ResourceDiskCache(const std::string& CachePath, uint64_t ArchiveKey) : CachePath(CachePath), ArchiveKey(ArchiveKey), MappingSize(0) {
+		if (!Open()) {
+			SPDLOG_INFO("Resource disk cache {} is missing or out of date, it will be rebuilt", CachePath);
+		}
+	}
+
+	ResourceDiskCache::~ResourceDiskCache() {
+		Close();
+	}
+
+	bool ResourceDiskCache::CanCacheResource(ResourceType Type) {
+		switch (Type) {
+		case ResourceType::Texture:
+		case ResourceType::DisplayList:
+		case ResourceType::Blob:
+		case ResourceType::Array:
+		case ResourceType::Matrix:
+		case ResourceType::AudioSample:
+		case ResourceType::AudioSequence:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint64_t ResourceDiskCache::GetArchiveKey(const std::string& MainPath, const std::vector<std::string>& PatchPaths) {
+		std::string Key = std::to_string(CacheVersion);
+
+		std::vector<std::string> Paths = { MainPath };
+		Paths.insert(Paths.end(), PatchPaths.begin(), PatchPaths.end());
+
+		for (const auto& Path : Paths) {
+			std::error_code Error;
+			const auto Size = std::filesystem::file_size(Path, Error);
+			const auto WriteTime = std::filesystem::last_write_time(Path, Error);
+
+			Key += "|" + Path + "|" + std::to_string(Size) + "|" + std::to_string(WriteTime.time_since_epoch().count());
+		}
+
+		return CRC64(Key.c_str());
+	}
+
+	bool ResourceDiskCache::HasResource(uint64_t Crc) const {
+		return Entries.contains(Crc);
+	}
+
+	Resource* ResourceDiskCache::LoadResource(uint64_t Crc, uint64_t FileChecksum) const {
+		auto Find = Entries.find(Crc);
+
+		if (Find == Entries.end() || Find->second.FileChecksum != FileChecksum) {
+			return nullptr;
+		}
+
+		CacheReader Reader(Mapping.get() + Find->second.Offset, Find->second.Size);
+		return DeserializeResource((ResourceType)Find->second.Type, Reader);
+	}
+
+	void ResourceDiskCache::AddResource(uint64_t Crc, uint64_t FileChecksum, const Resource* Res) {
+		if (!CanCacheResource(Res->resType)) {
+			return;
+		}
+
+		auto Find = Entries.find(Crc);
+
+		if (Find != Entries.end() && Find->second.FileChecksum == FileChecksum) {
+			return;
+		}
+
+		std::vector<char> Data;
+		CacheWriter Writer(Data);
+		SerializeResource(Res, Writer);
+
+		const std::lock_guard<std::mutex> Lock(PendingMutex);
+		PendingEntries[Crc] = { (uint32_t)Res->resType, FileChecksum, std::move(Data) };
+	}
+
+	bool ResourceDiskCache::Save() {
+		const std::lock_guard<std::mutex> Lock(PendingMutex);
+
+		if (PendingEntries.empty()) {
+			return true;
+		}
+
+		const std::string TempPath = CachePath + ".tmp";
+		std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+
+		CacheHeader Header = { CacheMagic, CacheVersion, ArchiveKey, 0, 0, sizeof(uintptr_t) };
+		Out.write((const char*)&Header, sizeof(Header));
+
+		std::vector<Entry> Index;
+		Index.reserve(Entries.size() + PendingEntries.size());
+
+		auto WriteEntry = [&](uint64_t Crc, uint32_t Type, uint64_t FileChecksum, const char* Data, uint64_t Size) {
+			Index.push_back({ Crc, Type, 0, FileChecksum, (uint64_t)Out.tellp(), Size });
+			Out.write(Data, Size);
+
+			// Keep every entry 8 byte aligned within the mapping.
+			static const char Padding[8] = {};
+			Out.write(Padding, (8 - Size % 8) % 8);
+		};
+
+		for (const auto& [Crc, CacheEntry] : Entries) {
+			// Out of date entries are replaced by the pending one.
+			if (!PendingEntries.contains(Crc)) {
+				WriteEntry(Crc, CacheEntry.Type, CacheEntry.FileChecksum, Mapping.get() + CacheEntry.Offset, CacheEntry.Size);
+			}
+		}
+
+		for (const auto& [Crc, Pending] : PendingEntries) {
+			WriteEntry(Crc, Pending.Type, Pending.FileChecksum, Pending.Data.data(), Pending.Data.size());
+		}
+
+		Header.IndexOffset = Out.tellp();
+		Header.EntryCount = (uint32_t)Index.size();
+		Out.write((const char*)Index.data(), Index.size() * sizeof(Entry));
+		Out.seekp(0);
+		Out.write((const char*)&Header, sizeof(Header));
+		Out.close();
+
+		std::error_code Error;
+
+		if (Out.fail()) {
+			SPDLOG_ERROR("Failed to write resource disk cache {}", TempPath);
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		// The mapping has to go before the file it maps can be replaced.
+		Close();
+		PendingEntries.clear();
+
+		std::filesystem::rename(TempPath, CachePath, Error);
+
+		if (Error) {
+			SPDLOG_ERROR("Failed to replace resource disk cache {}: {}", CachePath, Error.message());
+			return false;
+		}
+
+		SPDLOG_INFO("Wrote {} resources to the resource disk cache", Index.size());
+		return true;
+	}
+
+	bool ResourceDiskCache::Open() {
+		std::error_code Error;
+		const uint64_t FileSize = std::filesystem::file_size(CachePath, Error);
+
+		if (Error || FileSize < sizeof(CacheHeader)) {
+			return false;
+		}
+
+#ifdef _WIN32
+		HANDLE hFile = CreateFileW(std::filesystem::path(CachePath).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (hFile == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(hFile);
+
+		if (hMapping == nullptr) {
+			return false;
+		}
+
+		char* Mapped = (char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(hMapping);
+
+		if (Mapped == nullptr) {
+			return false;
+		}
+
+		Mapping = std::shared_ptr<char>(Mapped, [](char* Ptr) { UnmapViewOfFile(Ptr); });
+#elif !defined(__SWITCH__) && !defined(__WIIU__)
+		int Fd = open(CachePath.c_str(), O_RDONLY);
+
+		if (Fd < 0) {
+			return false;
+		}
+
+		void* Mapped = mmap(nullptr, FileSize, PROT_READ, MAP_PRIVATE, Fd, 0);
+		close(Fd);
+
+		if (Mapped == MAP_FAILED) {
+			return false;
+		}
+
+		Mapping = std::shared_ptr<char>((char*)Mapped, [FileSize](char* Ptr) { munmap(Ptr, FileSize); });
+#else
+		std::ifstream In(CachePath, std::ios::binary);
+		Mapping = std::shared_ptr<char>(new char[FileSize], std::default_delete<char[]>());
+
+		if (!In.read(Mapping.get(), FileSize)) {
+			Mapping = nullptr;
+			return false;
+		}
+#endif
+
+		MappingSize = FileSize;
+
+		CacheHeader Header;
+		memcpy(&Header, Mapping.get(), sizeof(Header));
+
+		if (Header.Magic != CacheMagic || Header.Version != CacheVersion || Header.ArchiveKey != ArchiveKey || Header.PointerSize != sizeof(uintptr_t) ||
+			Header.IndexOffset > MappingSize || Header.EntryCount > (MappingSize - Header.IndexOffset) / sizeof(Entry)) {
+			Close();
+			return false;
+		}
+
+		const Entry* Index = (const Entry*)(Mapping.get() + Header.IndexOffset);
+
+		for (uint32_t i = 0; i < Header.EntryCount; i++) {
+			if (Index[i].Offset > MappingSize || Index[i].Size > MappingSize - Index[i].Offset) {
+				Close();
+				return false;
+			}
+
+			Entries[Index[i].Crc] = Index[i];
+		}
+
+		SPDLOG_INFO("Opened resource disk cache {} with {} resources", CachePath, Entries.size());
+		return true;
+	}
+
+	void ResourceDiskCache::Close() {
+		Entries.clear();
+		Mapping = nullptr;
+		MappingSize = 0;
+	}
+}
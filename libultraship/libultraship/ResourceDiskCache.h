@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Resource.h"
+
+namespace Ship
+{
+	// On disk cache of decoded resources. Entries are stored in the layout the resource keeps in memory, so loading one
+	// is a bulk copy out of a mapping of the cache file rather than a field by field parse of the archive file.
+	// The cache is tied to the exact archives it was built from and is rebuilt whenever any of them changes. Each entry also
+	// keeps the checksum of the file it was decoded from, see Archive::GetFileChecksum, and is only used while it matches.
+	class ResourceDiskCache
+	{
+	public:
+		ResourceDiskCache(const std::string& CachePath, uint64_t ArchiveKey);
+		~ResourceDiskCache();
+
+		static bool CanCacheResource(ResourceType Type);
+		// Identifies the archives by path, size and modification time.
+		static uint64_t GetArchiveKey(const std::string& MainPath, const std::vector<std::string>& PatchPaths);
+
+		bool HasResource(uint64_t Crc) const;
+		// Returns nullptr if the resource is not cached or was decoded from a file with a different checksum.
+		Resource* LoadResource(uint64_t Crc, uint64_t FileChecksum) const;
+		// Queues a freshly parsed resource to be written by the next Save, replacing an out of date entry. Thread safe.
+		void AddResource(uint64_t Crc, uint64_t FileChecksum, const Resource* Res);
+		// Writes the cache back to disk if anything was added. The cache is closed afterwards.
+		bool Save();
+
+	private:
+		struct Entry {
+			uint64_t Crc;
+			uint32_t Type;
+			uint32_t Reserved;
+			uint64_t FileChecksum;
+			uint64_t Offset;
+			uint64_t Size;
+		};
+
+		struct PendingEntry {
+			uint32_t Type;
+			uint64_t FileChecksum;
+			std::vector<char> Data;
+		};
+
+		std::string CachePath;
+		uint64_t ArchiveKey;
+		std::shared_ptr<char> Mapping;
+		uint64_t MappingSize;
+		std::unordered_map<uint64_t, Entry> Entries;
+		std::mutex PendingMutex;
+		std::unordered_map<uint64_t, PendingEntry> PendingEntries;
+
+		bool Open();
+		void Close();
+	};
+}
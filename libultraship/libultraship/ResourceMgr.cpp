@@ -3,27 +3,58 @@
 #include "spdlog/spdlog.h"
 #include "File.h"
 #include "Archive.h"
+#include "ResourceDiskCache.h"
 #include "GameVersions.h"
 #include <Utils/StringHelper.h>
 #include "StormLib.h"
+#include "Lib/StrHash64.h"
+#include "Hooks.h"
+#include <algorithm>
 
 namespace Ship {
+	// Set on the thread that calls AdvanceFrame, the only one that ever destroys evicted and retired resources. Nothing can
+	// be freed between its reading a slot and taking a reference, so its lookups read the table bare. Every other thread,
+	// such as the resource workers, the audio thread or the game thread while rendering is pipelined, is not paced by
+	// AdvanceFrame and takes the lock.
+	static thread_local bool bIsFrameThread = false;
+
+	ResourceMgr::ResourceMgr(std::shared_ptr<GlobalCtx2> Context, const std::string& MainPath, const std::string& PatchesPath, size_t ResourceLoadThreadCount, bool MemoryMapArchive,
+		bool UseDiskCache) : Context(Context), bIsRunning(false), ResourceLoadThreadCount(ResourceLoadThreadCount),
+		MemoryBudget(0), CachedBytes(0), Evictions(0), CacheHits(0), CacheMisses(0), CurrentFrame(0), DiskCacheHits(0) {
+		OTR = std::make_shared<Archive>(MainPath, PatchesPath, false, true, MemoryMapArchive);
+
+		if (this->ResourceLoadThreadCount == 0) {
+			// Leave one hardware thread for the game itself.
+			const size_t HardwareThreads = std::thread::hardware_concurrency();
+			this->ResourceLoadThreadCount = HardwareThreads > 1 ? HardwareThreads - 1 : 1;
+		}
 
-	ResourceMgr::ResourceMgr(std::shared_ptr<GlobalCtx2> Context, const std::string& MainPath, const std::string& PatchesPath) : Context(Context), bIsRunning(false), FileLoadThread(nullptr) {
-		OTR = std::make_shared<Archive>(MainPath, PatchesPath, false);
+		// Size the lock-free lookup table to at least twice the number of known paths to keep probe chains short.
+		size_t TableSize = 1024;
+		while (TableSize < OTR->GetHashCount() * 2) {
+			TableSize *= 2;
+		}
+		ResourceCacheTable = std::make_unique<ResourceCacheSlot[]>(TableSize);
+		ResourceCacheTableMask = TableSize - 1;
 
 		gameVersion = OOT_UNKNOWN;
 
+		if (UseDiskCache && OTR->IsMainMPQValid()) {
+			DiskCache = std::make_unique<ResourceDiskCache>(MainPath + ".cache", ResourceDiskCache::GetArchiveKey(OTR->GetMainPath(), OTR->GetPatchPaths()));
+		}
+
 		if (OTR->IsMainMPQValid())
 			Start();
 	}
 
 	ResourceMgr::~ResourceMgr() {
 		SPDLOG_INFO("destruct ResourceMgr");
-		Stop();
+		SaveDiskCache();
 
 		FileCache.clear();
 		ResourceCache.clear();
+		EvictedResources.clear();
+		RetiredResources.clear();
 	}
 
 	void ResourceMgr::Start() {
@@ -31,8 +62,10 @@ namespace Ship {
 		const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
 		if (!IsRunning()) {
 			bIsRunning = true;
-			FileLoadThread = std::make_shared<std::thread>(&ResourceMgr::LoadFileThread, this);
-			ResourceLoadThread = std::make_shared<std::thread>(&ResourceMgr::LoadResourceThread, this);
+			for (size_t i = 0; i < ResourceLoadThreadCount; i++) {
+				FileLoadThreads.push_back(std::make_shared<std::thread>(&ResourceMgr::LoadFileThread, this));
+				ResourceLoadThreads.push_back(std::make_shared<std::thread>(&ResourceMgr::LoadResourceThread, this));
+			}
 		}
 	}
 
@@ -46,21 +79,36 @@ namespace Ship {
 
 			FileLoadNotifier.notify_all();
 			ResourceLoadNotifier.notify_all();
-			FileLoadThread->join();
-			ResourceLoadThread->join();
+			for (const auto& FileLoadThread : FileLoadThreads) {
+				FileLoadThread->join();
+			}
+			FileLoadThreads.clear();
+
+			for (const auto& ResourceLoadThread : ResourceLoadThreads) {
+				ResourceLoadThread->join();
+			}
+			ResourceLoadThreads.clear();
 
 			if (!FileLoadQueue.empty()) {
 				SPDLOG_INFO("Resource manager stopped, but has {} Files left to load.", FileLoadQueue.size());
 			}
 
 			if (!ResourceLoadQueue.empty()) {
-				SPDLOG_INFO("Resource manager stopped, but has {} Resources left to load.", FileLoadQueue.size());
+				SPDLOG_INFO("Resource manager stopped, but has {} Resources left to load.", ResourceLoadQueue.size());
 			}
 		}
 	}
 
+	void ResourceMgr::SaveDiskCache() {
+		Stop();
+
+		if (DiskCache != nullptr) {
+			DiskCache->Save();
+		}
+	}
+
 	bool ResourceMgr::IsRunning() {
-		return bIsRunning && FileLoadThread != nullptr;
+		return bIsRunning && !FileLoadThreads.empty();
 	}
 
 	bool ResourceMgr::DidLoadSuccessfully()
@@ -72,28 +120,30 @@ namespace Ship {
 		SPDLOG_INFO("Resource Manager LoadFileThread started");
 
 		while (true) {
-			std::unique_lock<std::mutex> Lock(FileLoadMutex);
+			std::shared_ptr<File> ToLoad = nullptr;
 
-			while (bIsRunning && FileLoadQueue.empty()) {
-				FileLoadNotifier.wait(Lock);
-			}
+			{
+				std::unique_lock<std::mutex> Lock(FileLoadMutex);
 
-			if (!bIsRunning) {
-				break;
-			}
+				while (bIsRunning && FileLoadQueue.empty()) {
+					FileLoadNotifier.wait(Lock);
+				}
 
-			//Lock.lock();
-			std::shared_ptr<File> ToLoad = FileLoadQueue.front();
-			FileLoadQueue.pop();
-			//Lock.unlock();
+				if (!bIsRunning) {
+					break;
+				}
 
-			OTR->LoadFile(ToLoad->path, true, ToLoad);
-			//Lock.lock();
+				ToLoad = FileLoadQueue.front();
+				FileLoadQueue.pop();
+			}
 
-			if (!ToLoad->bHasLoadError)
-				FileCache[ToLoad->path] = ToLoad->bIsLoaded && !ToLoad->bHasLoadError ? ToLoad : nullptr;
+			// The archive hands every thread its own MPQ handle, so reads and decompression run in parallel.
+			OTR->LoadFile(ToLoad->path, true, ToLoad);
 
-			//Lock.unlock();
+			if (ToLoad->bHasLoadError) {
+				const std::lock_guard<std::mutex> Lock(FileLoadMutex);
+				FileCache.erase(ToLoad->path);
+			}
 
 			SPDLOG_DEBUG("Loaded File {} on ResourceMgr thread", ToLoad->path);
 
@@ -107,70 +157,119 @@ namespace Ship {
 		SPDLOG_INFO("Resource Manager LoadResourceThread started");
 
 		while (true) {
-			std::unique_lock<std::mutex> ResLock(ResourceLoadMutex);
-			while (bIsRunning && ResourceLoadQueue.empty()) {
-				ResourceLoadNotifier.wait(ResLock);
-			}
+			std::shared_ptr<ResourcePromise> ToLoad = nullptr;
 
-			if (!bIsRunning) {
-				break;
+			{
+				std::unique_lock<std::mutex> ResLock(ResourceLoadMutex);
+				while (bIsRunning && ResourceLoadQueue.empty()) {
+					ResourceLoadNotifier.wait(ResLock);
+				}
+
+				if (!bIsRunning) {
+					break;
+				}
+
+				ToLoad = ResourceLoadQueue.front();
+				ResourceLoadQueue.pop();
 			}
 
-			std::shared_ptr<ResourcePromise> ToLoad = nullptr;
-			//ResLock.lock();
-			ToLoad = ResourceLoadQueue.front();
-			ResourceLoadQueue.pop();
-			//ResLock.unlock();
+			const uint64_t Crc = CRC64(ToLoad->file->path.c_str());
+			Resource* UnmanagedRes = nullptr;
+			// Files the archive has no checksum for are neither loaded from nor added to the disk cache.
+			uint64_t FileChecksum = 0;
+			const bool HasFileChecksum = DiskCache != nullptr && OTR->GetFileChecksum(ToLoad->file->path, &FileChecksum);
 
-			// Wait for the underlying File to complete loading
-			{
+			if (ToLoad->bLoadFromDiskCache) {
+				if (HasFileChecksum) {
+					UnmanagedRes = DiskCache->LoadResource(Crc, FileChecksum);
+				}
+
+				if (UnmanagedRes != nullptr) {
+					DiskCacheHits.fetch_add(1, std::memory_order_relaxed);
+				} else {
+					// The cached entry is out of date or could not be decoded, so fall back to reading the file from the archive.
+					SPDLOG_DEBUG("Resource disk cache entry for {} can not be used", ToLoad->file->path);
+					OTR->LoadFile(ToLoad->file->path, true, ToLoad->file);
+				}
+			} else {
+				// Wait for the underlying File to complete loading
 				std::unique_lock<std::mutex> FileLock(ToLoad->file->FileLoadMutex);
 				while (!ToLoad->file->bIsLoaded && !ToLoad->file->bHasLoadError) {
 					ToLoad->file->FileLoadNotifier.wait(FileLock);
 				}
 			}
 
-			if (!ToLoad->file->bHasLoadError)
-			{
-				auto UnmanagedRes = ResourceLoader::LoadResource(ToLoad->file);
+			// Decoding happens outside of the queue lock so every worker can parse a different resource at the same time.
+			std::shared_ptr<Resource> Res = nullptr;
 
-				if (UnmanagedRes != nullptr)
-				{
-					UnmanagedRes->resMgr = this;
-					auto Res = std::shared_ptr<Resource>(UnmanagedRes);
+			if (UnmanagedRes == nullptr && !ToLoad->file->bHasLoadError) {
+				UnmanagedRes = ResourceLoader::LoadResource(ToLoad->file);
 
-					if (Res != nullptr) {
-						std::unique_lock<std::mutex> Lock(ToLoad->resourceLoadMutex);
+				if (UnmanagedRes != nullptr && HasFileChecksum) {
+					DiskCache->AddResource(Crc, FileChecksum, UnmanagedRes);
+				}
+			}
 
-						ToLoad->bHasResourceLoaded = true;
-						ToLoad->resource = Res;
-						ResourceCache[Res->file->path] = Res;
+			if (UnmanagedRes != nullptr)
+			{
+				UnmanagedRes->resMgr = this;
+				Res = std::shared_ptr<Resource>(UnmanagedRes);
 
-						SPDLOG_DEBUG("Loaded Resource {} on ResourceMgr thread", ToLoad->file->path);
+				// Disabled for now because it can cause random crashes
+				//FileCache[Res->File->path] = nullptr;
+				//FileCache.erase(FileCache.find(Res->File->path));
+				Res->file = nullptr;
 
-						// Disabled for now because it can cause random crashes
-						//FileCache[Res->File->path] = nullptr;
-						//FileCache.erase(FileCache.find(Res->File->path));
-						Res->file = nullptr;
-					}
-					else {
-						ToLoad->bHasResourceLoaded = false;
-						ToLoad->resource = nullptr;
+				SPDLOG_DEBUG("Loaded Resource {} on ResourceMgr thread", ToLoad->file->path);
+			}
+			else if (!ToLoad->file->bHasLoadError)
+			{
+				SPDLOG_ERROR("Resource load FAILED {} on ResourceMgr thread", ToLoad->file->path);
+			}
+
+			{
+				const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
 
-						SPDLOG_ERROR("Resource load FAILED {} on ResourceMgr thread", ToLoad->file->path);
+				if (Res != nullptr) {
+					auto& Cached = ResourceCache[ToLoad->file->path];
+					if (Cached != nullptr) {
+						CachedBytes -= Cached->memorySize;
+						// Lock-free lookups may still be taking a reference to the old resource.
+						RetiredResources.emplace_back(CurrentFrame.load(std::memory_order_relaxed), std::move(Cached));
 					}
 
-					//ResLock.lock();
-					//ResLock.unlock();
+					// The raw file stays in FileCache for as long as the resource is cached, so it is charged to the resource.
+					Res->memorySize = Res->GetMemorySize() + ToLoad->file->dwBufferSize;
+					Res->lastUsedFrame.store(CurrentFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+					CachedBytes += Res->memorySize;
+
+					Cached = Res;
+					CacheResourceByCRC(Crc, Res.get());
+				}
+
+				PendingResources.erase(ToLoad->file->path);
+
+				if (MemoryBudget != 0 && CachedBytes > MemoryBudget) {
+					EvictResources();
 				}
 			}
-			else
+
+			std::vector<std::function<void(std::shared_ptr<Resource>)>> OnLoaded;
+
 			{
-				ToLoad->bHasResourceLoaded = false;
-				ToLoad->resource = nullptr;
+				std::unique_lock<std::mutex> Lock(ToLoad->resourceLoadMutex);
+				ToLoad->resource = Res;
+				ToLoad->bHasResourceLoaded = true;
+				OnLoaded.swap(ToLoad->onLoaded);
 			}
 
 			ToLoad->resourceLoadNotifier.notify_all();
+
+			if (Res != nullptr) {
+				for (const auto& Callback : OnLoaded) {
+					Callback(Res);
+				}
+			}
 		}
 
 		SPDLOG_INFO("Resource Manager LoadResourceThread ended");
@@ -195,8 +294,10 @@ namespace Ship {
 			std::shared_ptr<File> ToLoad = std::make_shared<File>();
 			ToLoad->path = FilePath;
 
+			// Cached right away so concurrent requests for the same path wait on this load instead of starting another.
+			FileCache[FilePath] = ToLoad;
 			FileLoadQueue.push(ToLoad);
-			FileLoadNotifier.notify_all();
+			FileLoadNotifier.notify_one();
 
 			return ToLoad;
 		}
@@ -250,6 +351,12 @@ namespace Ship {
 		if (FilePath[0] == '_' && FilePath[1] == '_' && FilePath[2] == 'O' && FilePath[3] == 'T' && FilePath[4] == 'R' && FilePath[5] == '_' && FilePath[6] == '_')
 			FilePath += 7;
 
+		auto CachedRes = GetCachedResourceByCRC(CRC64(FilePath));
+		if (CachedRes != nullptr) {
+			MarkResourceUsed(CachedRes.get());
+			return CachedRes;
+		}
+
 		const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
 		auto resCacheFind = ResourceCache.find(FilePath);
 		if (resCacheFind == ResourceCache.end() || resCacheFind->second->isDirty/* || !FileData->bIsLoaded*/) {
@@ -257,35 +364,74 @@ namespace Ship {
 				SPDLOG_TRACE("Cache miss on Resource load: {}", FilePath);
 			}
 
-			std::shared_ptr<ResourcePromise> Promise = std::make_shared<ResourcePromise>();
-			std::shared_ptr<File> FileData = LoadFile(FilePath);
-			Promise->file = FileData;
+			CacheMisses.fetch_add(1, std::memory_order_relaxed);
 
-			if (Promise->file->bHasLoadError)
-			{
-				Promise->bHasResourceLoaded = true;
+			// Share the in-flight promise so a resource requested twice is only decoded once.
+			auto pendingFind = PendingResources.find(FilePath);
+			if (pendingFind != PendingResources.end()) {
+				return pendingFind->second;
 			}
-			else
-			{
-				Promise->bHasResourceLoaded = false;
-				ResourceLoadQueue.push(Promise);
-				ResourceLoadNotifier.notify_all();
+
+			std::shared_ptr<ResourcePromise> Promise = std::make_shared<ResourcePromise>();
+			Promise->bHasResourceLoaded = false;
+
+			// Resources that are up to date in the disk cache skip reading the archive entirely. A dirty resource
+			// always goes back to the archive, as it may have been replaced since the cache was written.
+			if (DiskCache != nullptr && resCacheFind == ResourceCache.end() && DiskCache->HasResource(CRC64(FilePath))) {
+				Promise->file = std::make_shared<File>();
+				Promise->file->path = FilePath;
+				Promise->bLoadFromDiskCache = true;
+			} else {
+				Promise->file = LoadFileAsync(FilePath);
 			}
 
+			PendingResources[FilePath] = Promise;
+			ResourceLoadQueue.push(Promise);
+			ResourceLoadNotifier.notify_one();
+
 			return Promise;
 		}
 		else
 		{
+			MarkResourceUsed(resCacheFind->second.get());
 			return resCacheFind->second;
 		}
 	}
 
+	void ResourceMgr::PrefetchResource(const std::string& FilePath, std::function<void(std::shared_ptr<Resource>)> OnLoaded) {
+		auto Res = LoadResourceAsync(FilePath.c_str());
+
+		if (OnLoaded == nullptr) {
+			return;
+		}
+
+		if (std::holds_alternative<std::shared_ptr<Resource>>(Res)) {
+			OnLoaded(std::get<std::shared_ptr<Resource>>(Res));
+			return;
+		}
+
+		auto& Promise = std::get<std::shared_ptr<ResourcePromise>>(Res);
+
+		{
+			std::unique_lock<std::mutex> Lock(Promise->resourceLoadMutex);
+
+			if (!Promise->bHasResourceLoaded) {
+				Promise->onLoaded.push_back(std::move(OnLoaded));
+				return;
+			}
+		}
+
+		if (Promise->resource != nullptr) {
+			OnLoaded(Promise->resource);
+		}
+	}
+
 	std::shared_ptr<std::vector<std::shared_ptr<ResourcePromise>>> ResourceMgr::CacheDirectoryAsync(const std::string& SearchMask) {
 		auto loadedList = std::make_shared<std::vector<std::shared_ptr<ResourcePromise>>>();
 		auto fileList = OTR->ListFiles(SearchMask);
 
-		for (DWORD i = 0; i < fileList.size(); i++) {
-			auto resource = LoadResourceAsync(fileList.operator[](i).cFileName);
+		for (size_t i = 0; i < fileList.size(); i++) {
+			auto resource = LoadResourceAsync(fileList[i].c_str());
 			if (std::holds_alternative<std::shared_ptr<Resource>>(resource))
 			{
 				auto promise = std::make_shared<ResourcePromise>();
@@ -341,18 +487,242 @@ namespace Ship {
 
 	std::shared_ptr<std::vector<std::string>> ResourceMgr::ListFiles(std::string SearchMask)
 	{
-		auto result = std::make_shared<std::vector<std::string>>();
-		auto fileList = OTR->ListFiles(SearchMask);
+		return std::make_shared<std::vector<std::string>>(OTR->ListFiles(SearchMask));
+	}
+
+	const ResourceCacheSlot* ResourceMgr::FindResourceSlotByCRC(uint64_t Crc) const {
+		// Zero marks an empty slot.
+		if (Crc == 0) {
+			return nullptr;
+		}
 
-		for (DWORD i = 0; i < fileList.size(); i++) {
-			result->push_back(fileList[i].cFileName);
+		for (size_t i = Crc & ResourceCacheTableMask, Probes = 0; Probes <= ResourceCacheTableMask; i = (i + 1) & ResourceCacheTableMask, Probes++) {
+			const uint64_t SlotCrc = ResourceCacheTable[i].Crc.load(std::memory_order_acquire);
+
+			if (SlotCrc == Crc) {
+				return &ResourceCacheTable[i];
+			}
+
+			if (SlotCrc == 0) {
+				break;
+			}
 		}
 
-		return result;
+		return nullptr;
+	}
+
+	std::shared_ptr<Resource> ResourceMgr::GetCachedResourceByCRC(uint64_t Crc) const {
+		if (!bIsFrameThread) {
+			// While the lock is held, every slot points at a resource ResourceCache still owns.
+			const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
+			return FindCachedResourceByCRC(Crc);
+		}
+
+		return FindCachedResourceByCRC(Crc);
+	}
+
+	std::shared_ptr<Resource> ResourceMgr::FindCachedResourceByCRC(uint64_t Crc) const {
+		const ResourceCacheSlot* Slot = FindResourceSlotByCRC(Crc);
+		if (Slot == nullptr) {
+			return nullptr;
+		}
+
+		Resource* Res = Slot->Res.load(std::memory_order_acquire);
+		if (Res == nullptr || Res->isDirty) {
+			return nullptr;
+		}
+
+		return Res->shared_from_this();
+	}
+
+	std::shared_ptr<Resource> ResourceMgr::LoadResourceByCRC(uint64_t Crc) {
+		auto Res = GetCachedResourceByCRC(Crc);
+		if (Res != nullptr) {
+			return Res;
+		}
+
+		const std::string* HashStr = HashToString(Crc);
+		if (HashStr == nullptr) {
+			return nullptr;
+		}
+
+		return LoadResource(HashStr->c_str());
+	}
+
+	void ResourceMgr::CacheResourceByCRC(uint64_t Crc, Resource* Res) {
+		// Zero marks an empty slot.
+		if (Crc == 0) {
+			return;
+		}
+
+		for (size_t i = Crc & ResourceCacheTableMask, Probes = 0; Probes <= ResourceCacheTableMask; i = (i + 1) & ResourceCacheTableMask, Probes++) {
+			const uint64_t SlotCrc = ResourceCacheTable[i].Crc.load(std::memory_order_relaxed);
+
+			if (SlotCrc == Crc) {
+				ResourceCacheTable[i].Res.store(Res, std::memory_order_release);
+				return;
+			}
+
+			if (SlotCrc == 0) {
+				ResourceCacheTable[i].Res.store(Res, std::memory_order_relaxed);
+				ResourceCacheTable[i].Crc.store(Crc, std::memory_order_release);
+				return;
+			}
+		}
+
+		// The table is full, lookups for this resource will fall back to ResourceCache.
+		SPDLOG_WARN("Resource lookup table is full, {:X} will only be cached by path", Crc);
 	}
 
 	void ResourceMgr::InvalidateResourceCache() {
+		const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
+
+		for (size_t i = 0; i <= ResourceCacheTableMask; i++) {
+			ResourceCacheTable[i].Res.store(nullptr, std::memory_order_release);
+		}
+
+		// Lock-free lookups may still be taking references to them.
+		const uint32_t Frame = CurrentFrame.load(std::memory_order_relaxed);
+		for (auto& Cached : ResourceCache) {
+			RetiredResources.emplace_back(Frame, std::move(Cached.second));
+		}
+
 		ResourceCache.clear();
+		CachedBytes = 0;
+	}
+
+	void ResourceMgr::SetMemoryBudget(size_t Bytes) {
+		const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
+		MemoryBudget = Bytes;
+
+		if (MemoryBudget != 0 && CachedBytes > MemoryBudget) {
+			EvictResources();
+		}
+	}
+
+	ResourceCacheStats ResourceMgr::GetCacheStats() {
+		const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
+
+		ResourceCacheStats Stats;
+		Stats.Bytes = CachedBytes;
+		Stats.Budget = MemoryBudget;
+		Stats.Entries = ResourceCache.size();
+		Stats.Hits = CacheHits.load(std::memory_order_relaxed);
+		Stats.Misses = CacheMisses.load(std::memory_order_relaxed);
+		Stats.Evictions = Evictions;
+		Stats.DiskCacheHits = DiskCacheHits.load(std::memory_order_relaxed);
+
+		return Stats;
+	}
+
+	void ResourceMgr::MarkResourceUsed(Resource* Res) {
+		CacheHits.fetch_add(1, std::memory_order_relaxed);
+		Res->lastUsedFrame.store(CurrentFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	void ResourceMgr::AdvanceFrame() {
+		bIsFrameThread = true;
+		const uint32_t Frame = CurrentFrame.fetch_add(1, std::memory_order_relaxed) + 1;
+		std::vector<std::shared_ptr<Resource>> Released;
+		std::vector<std::shared_ptr<Resource>> Replaced;
+
+		{
+			const std::lock_guard<std::mutex> ResLock(ResourceLoadMutex);
+
+			// Raw pointers from the frame a resource was evicted on, and the one after it, may still be in flight.
+			auto Expired = std::stable_partition(EvictedResources.begin(), EvictedResources.end(), [Frame](const auto& Evicted) {
+				return Frame - Evicted.first < 2;
+			});
+
+			for (auto it = Expired; it != EvictedResources.end(); it++) {
+				Released.push_back(std::move(it->second));
+			}
+
+			EvictedResources.erase(Expired, EvictedResources.end());
+
+			auto Retired = std::stable_partition(RetiredResources.begin(), RetiredResources.end(), [Frame](const auto& Dropped) {
+				return Frame - Dropped.first < 2;
+			});
+
+			for (auto it = Retired; it != RetiredResources.end(); it++) {
+				Replaced.push_back(std::move(it->second));
+			}
+
+			RetiredResources.erase(Retired, RetiredResources.end());
+		}
+
+		// Destroyed outside of the lock, the renderer drops anything it derived from the resource first.
+		for (const auto& Res : Released) {
+			// Patches only ever point back into the evicted display list itself, there is nothing left to restore.
+			Res->patches.clear();
+			ExecuteHooks<ResourceEvicted>(Res.get());
+		}
+
+		// Replaced resources free their data just the same, a new one allocated at the same address must not hit whatever
+		// the renderer cached for the old one.
+		for (const auto& Res : Replaced) {
+			ExecuteHooks<ResourceEvicted>(Res.get());
+		}
+	}
+
+	bool ResourceMgr::CanEvictResource(const std::shared_ptr<Resource>& Res, uint32_t Frame) const {
+		// Only textures and display lists are reloaded on demand by the renderer, everything else is converted into
+		// game structures that keep pointing into the resource.
+		if (Res->resType != ResourceType::Texture && Res->resType != ResourceType::DisplayList) {
+			return false;
+		}
+
+		if (Res->isPinned || Res->isDirty || Res->cachedGameAsset != nullptr) {
+			return false;
+		}
+
+		// Anything outside of the cache holding a reference is still in use.
+		if (Res.use_count() > 1) {
+			return false;
+		}
+
+		return Frame - Res->lastUsedFrame.load(std::memory_order_relaxed) >= 2;
+	}
+
+	void ResourceMgr::EvictResources() {
+		const uint32_t Frame = CurrentFrame.load(std::memory_order_relaxed);
+		std::vector<std::unordered_map<std::string, std::shared_ptr<Resource>>::iterator> Candidates;
+
+		for (auto it = ResourceCache.begin(); it != ResourceCache.end(); it++) {
+			if (CanEvictResource(it->second, Frame)) {
+				Candidates.push_back(it);
+			}
+		}
+
+		std::sort(Candidates.begin(), Candidates.end(), [](const auto& a, const auto& b) {
+			return a->second->lastUsedFrame.load(std::memory_order_relaxed) < b->second->lastUsedFrame.load(std::memory_order_relaxed);
+		});
+
+		// Evict a bit past the budget so the next few loads do not immediately trigger another pass.
+		const size_t Target = MemoryBudget - MemoryBudget / 10;
+
+		for (const auto& it : Candidates) {
+			if (CachedBytes <= Target) {
+				break;
+			}
+
+			std::shared_ptr<Resource> Res = std::move(it->second);
+
+			CacheResourceByCRC(CRC64(it->first.c_str()), nullptr);
+			{
+				const std::lock_guard<std::mutex> FileLock(FileLoadMutex);
+				FileCache.erase(it->first);
+			}
+			ResourceCache.erase(it);
+
+			CachedBytes -= Res->memorySize;
+			Evictions++;
+			EvictedResources.emplace_back(Frame, std::move(Res));
+		}
+
+		if (CachedBytes > MemoryBudget) {
+			SPDLOG_DEBUG("Resource cache is {} bytes over its budget, nothing else can be evicted", CachedBytes - MemoryBudget);
+		}
 	}
 
 	const std::string* ResourceMgr::HashToString(uint64_t Hash) const {
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <unordered_map>
+#include <atomic>
 #include <string>
 #include <thread>
 #include <queue>
+#include <vector>
 #include <variant>
 #include "Resource.h"
 #include "GlobalCtx2.h"
@@ -12,12 +14,33 @@ namespace Ship
 {
 	class Archive;
 	class File;
+	class ResourceDiskCache;
 
-	// Resource manager caches any and all files it comes across into memory. This will be unoptimal in the future when modifications have gigabytes of assets.
-	// It works with the original game's assets because the entire ROM is 64MB and fits into RAM of any semi-modern PC.
+	struct ResourceCacheSlot {
+		std::atomic<uint64_t> Crc = 0;
+		std::atomic<Resource*> Res = nullptr;
+	};
+
+	struct ResourceCacheStats {
+		size_t Bytes;
+		size_t Budget;
+		size_t Entries;
+		uint64_t Hits;
+		uint64_t Misses;
+		uint64_t Evictions;
+		uint64_t DiskCacheHits;
+	};
+
+	// Resource manager caches the files it loads into memory. Without a memory budget nothing is ever released, which works with the original game's
+	// assets because the entire ROM is 64MB. With a budget, textures and display lists that have not been used for a few frames are evicted once the
+	// cache grows past it, unless game code holds raw pointers into them and they are pinned. Evicted resources are loaded again when next requested.
 	class ResourceMgr {
 	public:
-		ResourceMgr(std::shared_ptr<GlobalCtx2> Context, const std::string& MainPath, const std::string& PatchesPath);
+		// A ResourceLoadThreadCount of 0 picks a worker count based on the available hardware threads.
+		// The same number of threads is used to read and decompress files from the archive.
+		// With UseDiskCache, decoded resources are kept in a cache file next to the main archive across runs, see ResourceDiskCache.
+		ResourceMgr(std::shared_ptr<GlobalCtx2> Context, const std::string& MainPath, const std::string& PatchesPath, size_t ResourceLoadThreadCount = 0, bool MemoryMapArchive = false,
+			bool UseDiskCache = false);
 		~ResourceMgr();
 
 		bool IsRunning();
@@ -25,11 +48,25 @@ namespace Ship
 
 		std::shared_ptr<Archive> GetArchive() { return OTR; }
 		std::shared_ptr<GlobalCtx2> GetContext() { return Context.lock(); }
+		size_t GetResourceLoadThreadCount() { return ResourceLoadThreads.size(); }
 
 		const std::string* HashToString(uint64_t Hash) const;
 
 		void InvalidateResourceCache();
 
+		// A budget of 0 disables eviction. Otherwise decoded textures and display lists that are not pinned and have
+		// not been used for a couple of frames are evicted, least recently used first, once the cache grows past it.
+		void SetMemoryBudget(size_t Bytes);
+		ResourceCacheStats GetCacheStats();
+		// Called once per frame. Evicted resources are only destroyed after every frame that could still reference them has ended.
+		void AdvanceFrame();
+		uint32_t GetCurrentFrame() const { return CurrentFrame.load(std::memory_order_relaxed); }
+		void MarkResourceUsed(Resource* Res);
+
+		// Stops the resource workers, as they read from the disk cache without a lock, and writes out any resources
+		// decoded since it was opened. Only meant to be called on shutdown.
+		void SaveDiskCache();
+
 		uint32_t GetGameVersion();
 		void SetGameVersion(uint32_t newGameVersion);
 		std::shared_ptr<File> LoadFileAsync(const std::string& FilePath);
@@ -37,7 +74,19 @@ namespace Ship
 		std::shared_ptr<Ship::Resource> GetCachedFile(const char* FilePath) const;
 		std::shared_ptr<Resource> LoadResource(const char* FilePath);
 		std::shared_ptr<Resource> LoadResource(const std::string& FilePath) { return LoadResource(FilePath.c_str()); }
+		// Looks a resource up by the CRC64 of its path. Cache hits on the thread calling AdvanceFrame take no lock and do not
+		// allocate. Other threads take ResourceLoadMutex, as they could be stalled while that thread frees the resource.
+		std::shared_ptr<Resource> GetCachedResourceByCRC(uint64_t Crc) const;
+		std::shared_ptr<Resource> LoadResourceByCRC(uint64_t Crc);
+		// The returned slot stays at the same address for the lifetime of the ResourceMgr, so callers may keep it
+		// around and re-read Res instead of hashing again. Its Res is null while the resource is not cached. Res is a raw pointer
+		// and only stays valid for two frames, so the resource workers must not read it.
+		const ResourceCacheSlot* FindResourceSlotByCRC(uint64_t Crc) const;
 		std::variant<std::shared_ptr<Resource>, std::shared_ptr<ResourcePromise>> LoadResourceAsync(const char* FilePath);
+		// Queues a resource to be decoded in the background without ever blocking, so a later LoadResource is a cache hit.
+		// OnLoaded is called once the resource is cached: right away if it already was, otherwise on a resource worker,
+		// in which case it must not wait on other resources.
+		void PrefetchResource(const std::string& FilePath, std::function<void(std::shared_ptr<Resource>)> OnLoaded = nullptr);
 		std::shared_ptr<std::vector<std::shared_ptr<Resource>>> CacheDirectory(const std::string& SearchMask);
 		std::shared_ptr<std::vector<std::shared_ptr<ResourcePromise>>> CacheDirectoryAsync(const std::string& SearchMask);
 		std::shared_ptr<std::vector<std::shared_ptr<Resource>>> DirtyDirectory(std::string SearchMask);
@@ -48,21 +97,45 @@ namespace Ship
 		void Stop();
 		void LoadFileThread();
 		void LoadResourceThread();
+		std::shared_ptr<Resource> FindCachedResourceByCRC(uint64_t Crc) const;
+		void CacheResourceByCRC(uint64_t Crc, Resource* Res);
+		bool CanEvictResource(const std::shared_ptr<Resource>& Res, uint32_t Frame) const;
+		void EvictResources();
 
 	private:
 		std::weak_ptr<GlobalCtx2> Context;
 		volatile bool bIsRunning;
 		std::unordered_map<std::string, std::shared_ptr<File>> FileCache;
 		std::unordered_map<std::string, std::shared_ptr<Resource>> ResourceCache;
+		// Open addressed CRC64 -> Resource* table mirroring ResourceCache. It is only written under ResourceLoadMutex,
+		// and slots are never reused for a different hash, so readers can probe it without taking a lock.
+		std::unique_ptr<ResourceCacheSlot[]> ResourceCacheTable;
+		size_t ResourceCacheTableMask;
 		std::queue<std::shared_ptr<File>> FileLoadQueue;
+		std::unordered_map<std::string, std::shared_ptr<ResourcePromise>> PendingResources;
 		std::queue<std::shared_ptr<ResourcePromise>> ResourceLoadQueue;
 		std::shared_ptr<Archive> OTR;
-		std::shared_ptr<std::thread> FileLoadThread;
-		std::shared_ptr<std::thread> ResourceLoadThread;
+		std::vector<std::shared_ptr<std::thread>> FileLoadThreads;
+		std::vector<std::shared_ptr<std::thread>> ResourceLoadThreads;
+		size_t ResourceLoadThreadCount;
 		std::mutex FileLoadMutex;
-		std::mutex ResourceLoadMutex;
+		mutable std::mutex ResourceLoadMutex;
 		std::condition_variable FileLoadNotifier;
 		std::condition_variable ResourceLoadNotifier;
 		uint32_t gameVersion;
+		size_t MemoryBudget;
+		size_t CachedBytes;
+		uint64_t Evictions;
+		std::atomic<uint64_t> CacheHits;
+		std::atomic<uint64_t> CacheMisses;
+		std::atomic<uint32_t> CurrentFrame;
+		// Evicted resources along with the frame they were evicted on, destroyed by AdvanceFrame.
+		std::vector<std::pair<uint32_t, std::shared_ptr<Resource>>> EvictedResources;
+		// Resources replaced by a reload or dropped by InvalidateResourceCache along with the frame they were dropped on.
+		// GetCachedResourceByCRC takes references from raw pointers, so they are kept alive for as long as evicted ones, and
+		// ResourceEvicted fires for them too.
+		std::vector<std::pair<uint32_t, std::shared_ptr<Resource>>> RetiredResources;
+		std::unique_ptr<ResourceDiskCache> DiskCache;
+		std::atomic<uint64_t> DiskCacheHits;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace Ship
+{
+	// Ring buffer shared by exactly one producer thread and one consumer thread. Neither side ever waits for the other:
+	// Write stores as much as fits and Read takes as much as is there.
+	template <typename T>
+	class SpscRingBuffer
+	{
+	public:
+		// Capacity is rounded up to a power of two.
+		explicit SpscRingBuffer(size_t Capacity) : WriteIndex(0), ReadIndex(0) {
+			size_t Size = 1;
+			while (Size < Capacity) {
+				Size *= 2;
+			}
+			Buffer.resize(Size);
+			Mask = Size - 1;
+		}
+
+		// Producer only. Returns how many items were stored.
+		size_t Write(const T* Items, size_t Count) {
+			const size_t Write = WriteIndex.load(std::memory_order_relaxed);
+			const size_t Read = ReadIndex.load(std::memory_order_acquire);
+			Count = std::min(Count, Buffer.size() - (Write - Read));
+
+			for (size_t i = 0; i < Count; i++) {
+				Buffer[(Write + i) & Mask] = Items[i];
+			}
+			WriteIndex.store(Write + Count, std::memory_order_release);
+			return Count;
+		}
+
+		// Consumer only. Returns how many items were taken.
+		size_t Read(T* Items, size_t Count) {
+			const size_t Read = ReadIndex.load(std::memory_order_relaxed);
+			const size_t Write = WriteIndex.load(std::memory_order_acquire);
+			Count = std::min(Count, Write - Read);
+
+			for (size_t i = 0; i < Count; i++) {
+				Items[i] = Buffer[(Read + i) & Mask];
+			}
+			ReadIndex.store(Read + Count, std::memory_order_release);
+			return Count;
+		}
+
+		// Exact from either side's point of view, the other side may have moved on by the time it returns.
+		size_t Size() const {
+			return WriteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_acquire);
+		}
+
+		size_t GetCapacity() const {
+			return Buffer.size();
+		}
+
+		void Clear() {
+			ReadIndex.store(WriteIndex.load(std::memory_order_acquire), std::memory_order_release);
+		}
+
+	private:
+		std::vector<T> Buffer;
+		size_t Mask;
+		// Kept on separate cache lines so the two threads do not keep stealing one line from each other.
+		alignas(64) std::atomic<size_t> WriteIndex;
+		alignas(64) std::atomic<size_t> ReadIndex;
+	};
+}
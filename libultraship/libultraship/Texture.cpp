@@ -14,10 +14,15 @@ namespace Ship
 
         uint32_t dataSize = reader->ReadUInt32();
 
-        tex->imageDataSize = dataSize;
-        tex->imageData = new uint8_t[dataSize];
+        tex->AllocateImageData(dataSize);
+        reader->ReadArray(tex->imageData, dataSize);
+    }
 
-        for (uint32_t i = 0; i < dataSize; i++)
-            tex->imageData[i] = reader->ReadUByte();
+    void Texture::AllocateImageData(uint32_t size)
+    {
+        ownedImageData.reset(new uint8_t[size]);
+        ownedImageDataSize = size;
+        imageData = ownedImageData.get();
+        imageDataSize = size;
     }
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include "Resource.h"
 
 namespace Ship
@@ -34,8 +35,18 @@ namespace Ship
 	public:
 		TextureType texType;
 		uint16_t width, height;
-		uint32_t imageDataSize;
-		uint8_t* imageData;
+		uint32_t imageDataSize = 0;
+		// LoadTexture hooks may point this at a buffer of their own, which they keep owning.
+		uint8_t* imageData = nullptr;
 		uint8_t* paletteData;
+
+		// Allocates the buffer imageData starts out pointing at. Only it is freed with the texture and counted against the
+		// resource memory budget.
+		void AllocateImageData(uint32_t size);
+		size_t GetMemorySize() const override { return sizeof(*this) + ownedImageDataSize; }
+
+	private:
+		std::unique_ptr<uint8_t[]> ownedImageData;
+		uint32_t ownedImageDataSize = 0;
 	};
 }
\ No newline at end of file
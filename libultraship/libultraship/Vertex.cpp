@@ -7,21 +7,21 @@ namespace Ship
 		ResourceFile::ParseFileBinary(reader, res);
 
 		uint32_t count = reader->ReadUInt32();
-		vtx->vtxList.reserve(count);
+		vtx->vtxList.resize(count);
+		ReadVertices(reader, vtx->vtxList.data(), count);
+	}
+
+	void ReadVertices(BinaryReader* reader, Vtx* vertices, size_t count) {
+		static_assert(sizeof(Vtx) == 16, "Vtx must match the layout of a vertex in the resource");
+
+		// A vertex is six 16-bit values followed by four color bytes, so the whole block is copied at once
+		// and only the 16-bit values need swapping.
+		reader->Read((char*)vertices, count * sizeof(Vtx));
 
-		for (uint32_t i = 0; i < count; i++) {
-			Vtx data;
-			data.x = reader->ReadInt16();
-			data.y = reader->ReadInt16();
-			data.z = reader->ReadInt16();
-			data.flag = reader->ReadUInt16();
-			data.s = reader->ReadInt16();
-			data.t = reader->ReadInt16();
-			data.r = reader->ReadUByte();
-			data.g = reader->ReadUByte();
-			data.b = reader->ReadUByte();
-			data.a = reader->ReadUByte();
-			vtx->vtxList.push_back(data);
+		if (reader->GetEndianness() != Endianness::Native) {
+			for (size_t i = 0; i < count; i++) {
+				BinaryReader::ByteSwapArray(&vertices[i].x, 6);
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -13,6 +13,9 @@ namespace Ship
 		uint8_t r, g, b, a;
 	};
 
+	// Reads count vertices stored back to back in the resource's layout.
+	void ReadVertices(BinaryReader* reader, Vtx* vertices, size_t count);
+
 	class VertexV0 : public ResourceFile
 	{
 	public:
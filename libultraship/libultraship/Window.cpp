@@ -18,7 +18,9 @@
 #include <SDL2/SDL.h>
 #include <string>
 #include <chrono>
+#include <algorithm>
 #include "Console.h"
+#include "ImGuiImpl.h"
 #include "Cvar.h"
 
 #include <iostream>
@@ -86,36 +88,76 @@ extern "C" {
     }
 
     Vtx* ResourceMgr_LoadVtxByCRC(uint64_t crc) {
-        const std::string* hashStr = Ship::GlobalCtx2::GetInstance()->GetResourceManager()->HashToString(crc);
+        auto res = std::static_pointer_cast<Ship::Array>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResourceByCRC(crc));
+        return res != nullptr ? (Vtx*)res->vertices.data() : nullptr;
+    }
 
-        if (hashStr != nullptr) {
-            auto res = std::static_pointer_cast<Ship::Array>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResource(hashStr->c_str()));
-            return (Vtx*)res->vertices.data();
-        }
+    int32_t* ResourceMgr_LoadMtxByCRC(uint64_t crc) {
+        auto res = std::static_pointer_cast<Ship::Matrix>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResourceByCRC(crc));
+        return res != nullptr ? (int32_t*)res->mtx.data() : nullptr;
+    }
 
-        return nullptr;
+    Gfx* ResourceMgr_LoadGfxByCRC(uint64_t crc) {
+        auto res = std::static_pointer_cast<Ship::DisplayList>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResourceByCRC(crc));
+        return res != nullptr ? (Gfx*)&res->instructions[0] : nullptr;
     }
 
-    int32_t* ResourceMgr_LoadMtxByCRC(uint64_t crc) {
-        const std::string* hashStr = Ship::GlobalCtx2::GetInstance()->GetResourceManager()->HashToString(crc);
+    static Ship::Resource* ResourceMgr_LoadResourceByOTRCmd(Gfx* cmd, bool* fromSlot = nullptr) {
+        if (cmd->words.w0 & G_OTR_RESOLVED) {
+            const auto slot = (const Ship::ResourceCacheSlot*)cmd->words.w1;
+            Ship::Resource* res = slot->Res.load(std::memory_order_acquire);
 
-        if (hashStr != nullptr) {
-            auto res = std::static_pointer_cast<Ship::Matrix>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResource(hashStr->c_str()));
-            return (int32_t*)res->mtx.data();
+            if (res != nullptr && !res->isDirty) {
+                res->resMgr->MarkResourceUsed(res);
+
+                if (fromSlot != nullptr)
+                    *fromSlot = true;
+
+                return res;
+            }
         }
 
-        return nullptr;
+        const uint64_t crc = ((uint64_t)cmd[1].words.w0 << 32) + cmd[1].words.w1;
+        const auto resMgr = Ship::GlobalCtx2::GetInstance()->GetResourceManager();
+        const auto res = resMgr->LoadResourceByCRC(crc);
+
+        if (res == nullptr)
+            return nullptr;
+
+        const Ship::ResourceCacheSlot* slot = resMgr->FindResourceSlotByCRC(crc);
+
+        if (slot != nullptr) {
+            cmd->words.w1 = (uintptr_t)slot;
+            cmd->words.w0 |= G_OTR_RESOLVED;
+        }
+
+        return res.get();
     }
 
-    Gfx* ResourceMgr_LoadGfxByCRC(uint64_t crc) {
-        const std::string* hashStr = Ship::GlobalCtx2::GetInstance()->GetResourceManager()->HashToString(crc);
+    Gfx* ResourceMgr_LoadGfxByOTRCmd(Gfx* cmd) {
+        auto res = (Ship::DisplayList*)ResourceMgr_LoadResourceByOTRCmd(cmd);
+        return res != nullptr ? (Gfx*)&res->instructions[0] : nullptr;
+    }
 
-        if (hashStr != nullptr) {
-            auto res = std::static_pointer_cast<Ship::DisplayList>(Ship::GlobalCtx2::GetInstance()->GetResourceManager()->LoadResource(hashStr->c_str()));
-            return (Gfx*)&res->instructions[0];
-        } else {
+    int32_t* ResourceMgr_LoadMtxByOTRCmd(Gfx* cmd) {
+        auto res = (Ship::Matrix*)ResourceMgr_LoadResourceByOTRCmd(cmd);
+        return res != nullptr ? (int32_t*)res->mtx.data() : nullptr;
+    }
+
+    char* ResourceMgr_LoadTexByOTRCmd(Gfx* cmd) {
+        bool fromSlot = false;
+        auto res = (Ship::Texture*)ResourceMgr_LoadResourceByOTRCmd(cmd, &fromSlot);
+
+        if (res == nullptr)
             return nullptr;
+
+        // Only run the hooks when the texture was (re)loaded, the slot keeps returning the same texture after that.
+        if (!fromSlot) {
+            const uint64_t crc = ((uint64_t)cmd[1].words.w0 << 32) + cmd[1].words.w1;
+            Ship::ExecuteHooks<Ship::LoadTexture>(ResourceMgr_GetNameByCRC(crc), &res->imageData);
         }
+
+        return reinterpret_cast<char*>(res->imageData);
     }
 
     char* ResourceMgr_LoadTexByCRC(uint64_t crc)  {
@@ -154,6 +196,14 @@ extern "C" {
         return (char*)res->imageData;
     }
 
+    char* ResourceMgr_LoadPinnedTexByName(char* texPath) {
+        const auto res = LOAD_TEX(texPath);
+        // The caller keeps the pointer past this frame or writes texels through it, neither survives an eviction.
+        res->isPinned = true;
+        Ship::ExecuteHooks<Ship::LoadTexture>(texPath, &res->imageData);
+        return (char*)res->imageData;
+    }
+
     uint16_t ResourceMgr_LoadTexWidthByName(char* texPath) {
         const auto res = LOAD_TEX(texPath);
         if (res != nullptr)
@@ -186,6 +236,9 @@ extern "C" {
 
         if (res != nullptr)
         {
+            // Reloading the texture would drop the write.
+            res->isPinned = true;
+
             if (index < res->imageDataSize)
                 res->imageData[index] = value;
             else
@@ -237,6 +290,14 @@ namespace Ship {
             pConf->setInt("Window.Height", 480);
             pConf->setBool("Window.Options", false);
             pConf->setString("Window.GfxBackend", "");
+            pConf->setString("Window.AudioBackend", "");
+            pConf->setBool("Window.DisplayListReplay", false);
+            pConf->setBool("Window.DisplayListBenchmark", false);
+            pConf->setBool("Window.ReorderOpaqueDraws", false);
+            pConf->setBool("Window.ShaderCache", true);
+            pConf->setBool("Window.PipelinedRendering", false);
+            pConf->setBool("Window.TextureCacheContentHash", false);
+            pConf->setInt("Window.TextureCacheBudget", 0);
 
             pConf->setBool("Window.Fullscreen.Enabled", false);
             pConf->setInt("Window.Fullscreen.Width", 1920);
@@ -245,6 +306,14 @@ namespace Ship {
             pConf->setString("Game.SaveName", "");
             pConf->setString("Game.Main Archive", "");
             pConf->setString("Game.Patches Archive", "");
+            pConf->setInt("Game.Resource Load Threads", 0);
+            pConf->setBool("Game.Memory Map Archive", false);
+            pConf->setInt("Game.Resource Memory Budget", 0);
+            pConf->setBool("Game.Resource Disk Cache", false);
+            pConf->setBool("Game.Predecode Audio Samples", false);
+            pConf->setString("Game.Audio Render Script", "");
+            pConf->setString("Game.Audio Render Output", "");
+            pConf->setBool("Game.Audio Render Check Kernels", false);
 
             pConf->setInt("Shortcuts.Fullscreen", 0x044);
             pConf->setInt("Shortcuts.Console", 0x029);
@@ -273,39 +342,274 @@ namespace Ship {
         const std::string& gfx_backend = pConf->getString("Window.GfxBackend");
         SetWindowManager(&WmApi, &RenderingApi, gfx_backend);
 
+        bDisplayListReplay = pConf->getBool("Window.DisplayListReplay", false);
+        bDisplayListBenchmark = pConf->getBool("Window.DisplayListBenchmark", false);
+        gfx_set_display_list_replay(bDisplayListReplay);
+        gfx_set_draw_reordering(pConf->getBool("Window.ReorderOpaqueDraws", false));
+        bPipelinedRendering = pConf->getBool("Window.PipelinedRendering", false);
+
+        // Without a render thread the menus set CVars on this thread too, so its own reads need no lock.
+        if (!bPipelinedRendering) {
+            CVar_SetLockFreeReads();
+        }
+
+        // Budget is in megabytes, 0 keeps the fixed entry count limit.
+        gfx_texture_cache_set_mode(pConf->getBool("Window.TextureCacheContentHash", false),
+                                   (size_t)std::max(pConf->getInt("Window.TextureCacheBudget", 0), 0) * 1024 * 1024);
+
+        if (pConf->getBool("Window.ShaderCache", true)) {
+            gfx_set_shader_cache_path(GlobalCtx2::GetPathRelativeToAppDirectory("shaders.cache").c_str());
+        }
+
         gfx_init(WmApi, RenderingApi, GetContext()->GetName().c_str(), bIsFullscreen, dwWidth, dwHeight);
+
+        const GfxShaderStats ShaderStats = gfx_get_shader_stats();
+        if (ShaderStats.precompiled != 0) {
+            SPDLOG_INFO("Created {} cached shaders in {:.2f} s", ShaderStats.precompiled, ShaderStats.precompile_time);
+        }
         WmApi->set_fullscreen_changed_callback(OnFullscreenChanged);
         WmApi->set_keyboard_callbacks(KeyDown, KeyUp, AllKeysUp);
 
         Ship::RegisterHook<Ship::ExitGame>([this]() {
             ControllerApi->SaveControllerSettings();
         });
+
+        Ship::RegisterHook<Ship::ResourceEvicted>([](Ship::Resource* res) {
+            if (res->resType == Ship::ResourceType::Texture)
+                gfx_texture_cache_delete(static_cast<Ship::Texture*>(res)->imageData);
+        });
     }
 
     void Window::StartFrame() {
+        // The render thread starts its own frame once the game hands one off.
+        if (bPipelinedRendering) {
+            return;
+        }
+
+        GetContext()->GetResourceManager()->AdvanceFrame();
         gfx_start_frame();
     }
 
     void Window::RunCommands(Gfx* Commands, const std::vector<std::unordered_map<Mtx*, MtxF>>& mtx_replacements) {
-        for (const auto& m : mtx_replacements) {
-            gfx_run(Commands, m);
+        const auto SubmitTime = std::chrono::steady_clock::now();
+
+        if (!bPipelinedRendering) {
+            DrawFrame(Commands, mtx_replacements);
+
+            const auto EndTime = std::chrono::steady_clock::now();
+            const double RenderTime = std::chrono::duration<double>(EndTime - SubmitTime).count();
+            std::lock_guard<std::mutex> Lock(FrameMutex);
+            PipelineStats.Frames++;
+            PipelineStats.GameTime += std::chrono::duration<double>(SubmitTime - GameFrameStart).count();
+            PipelineStats.RenderTime += RenderTime;
+            PipelineStats.Latency += RenderTime;
+            PipelineStats.MaxLatency = std::max(PipelineStats.MaxLatency, RenderTime);
+            GameFrameStart = EndTime;
+            return;
+        }
+
+        std::unique_lock<std::mutex> Lock(FrameMutex);
+        PipelineStats.GameTime += std::chrono::duration<double>(SubmitTime - GameFrameStart).count();
+
+        // The game builds the frame after this one in the pool the previous frame was built in, so that frame has to be
+        // drawn before this one is handed off.
+        FrameCondition.wait(Lock, [this]() { return (!bFramePending && !bFrameRendering) || bStopGameThread; });
+        if (bStopGameThread) {
+            return;
+        }
+
+        // The render thread draws no menus until this frame is handed to it, so console commands and menu actions that
+        // touch game state run here, between two game frames. Commands may take FrameMutex themselves.
+        Lock.unlock();
+        SohImGui::console->RunQueued();
+        Lock.lock();
+
+        PendingCommands = Commands;
+        PendingMtxReplacements = mtx_replacements;
+        dwPendingTargetFps = dwTargetFps;
+        dwPendingMaximumFrameLatency = dwMaximumFrameLatency;
+        bFramePending = true;
+        GameFrameStart = std::chrono::steady_clock::now();
+        PendingSubmitTime = GameFrameStart;
+        FrameCondition.notify_all();
+
+        // Menus and debug windows are drawn on the render thread and walk actor lists, spawn actors and edit the save
+        // context, so the game must not run while they are open.
+        if (bMenusOpen) {
+            FrameCondition.wait(Lock, [this]() { return (!bFramePending && !bFrameRendering) || bStopGameThread; });
+            GameFrameStart = std::chrono::steady_clock::now();
+        }
+
+        PipelineStats.GameWaitTime += std::chrono::duration<double>(GameFrameStart - SubmitTime).count();
+    }
+
+    void Window::WaitForRenderer() {
+        if (!bPipelinedRendering) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> Lock(FrameMutex);
+        FrameCondition.wait(Lock, [this]() { return (!bFramePending && !bFrameRendering) || bStopGameThread; });
+    }
+
+    FramePipelineStats Window::GetFramePipelineStats() {
+        std::lock_guard<std::mutex> Lock(FrameMutex);
+        return PipelineStats;
+    }
+
+    void Window::ResetFramePipelineStats() {
+        std::lock_guard<std::mutex> Lock(FrameMutex);
+        PipelineStats = {};
+        // Time spent before the reset in the frame the game is building does not count towards the next one.
+        GameFrameStart = std::chrono::steady_clock::now();
+    }
+
+    void Window::RunGameThread() {
+        while (!bStopGameThread) {
+            GameFunction();
+        }
+
+        std::lock_guard<std::mutex> Lock(FrameMutex);
+        bGameThreadRunning = false;
+        FrameCondition.notify_all();
+    }
+
+    void Window::RenderIteration() {
+        GlobalCtx2::GetInstance()->GetWindow()->RenderPendingFrame();
+    }
+
+    void Window::RenderPendingFrame() {
+        Gfx* Commands;
+        std::vector<std::unordered_map<Mtx*, MtxF>> MtxReplacements;
+        std::chrono::steady_clock::time_point SubmitTime;
+
+        {
+            std::unique_lock<std::mutex> Lock(FrameMutex);
+            const auto WaitStart = std::chrono::steady_clock::now();
+            FrameCondition.wait(Lock, [this]() { return bFramePending || !bGameThreadRunning; });
+            if (!bFramePending) {
+                return;
+            }
+
+            PipelineStats.RenderWaitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - WaitStart).count();
+            Commands = PendingCommands;
+            MtxReplacements = std::move(PendingMtxReplacements);
+            SubmitTime = PendingSubmitTime;
+            gfx_set_target_fps(dwPendingTargetFps);
+            gfx_set_maximum_frame_latency(dwPendingMaximumFrameLatency);
+            bFramePending = false;
+            bFrameRendering = true;
+        }
+
+        const auto StartTime = std::chrono::steady_clock::now();
+        GetContext()->GetResourceManager()->AdvanceFrame();
+        gfx_start_frame();
+        DrawFrame(Commands, MtxReplacements);
+        UpdatePixelDepth();
+        const auto EndTime = std::chrono::steady_clock::now();
+        const bool bAnyMenuOpen = SohImGui::IsAnyMenuOpen();
+
+        {
+            std::lock_guard<std::mutex> Lock(FrameMutex);
+            bMenusOpen = bAnyMenuOpen;
+            const double Latency = std::chrono::duration<double>(EndTime - SubmitTime).count();
+            PipelineStats.Frames++;
+            PipelineStats.RenderTime += std::chrono::duration<double>(EndTime - StartTime).count();
+            PipelineStats.Latency += Latency;
+            PipelineStats.MaxLatency = std::max(PipelineStats.MaxLatency, Latency);
+            bFrameRendering = false;
+        }
+
+        FrameCondition.notify_all();
+    }
+
+    void Window::UpdatePixelDepth() {
+        std::set<std::pair<float, float>> Requests;
+
+        {
+            std::lock_guard<std::mutex> Lock(PixelDepthMutex);
+            Requests.swap(PixelDepthRequests);
+        }
+
+        std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> Results;
+        for (const auto& Coordinate : Requests) {
+            gfx_get_pixel_depth_prepare(Coordinate.first, Coordinate.second);
+        }
+        // The first lookup reads back every prepared coordinate at once.
+        for (const auto& Coordinate : Requests) {
+            Results.emplace(Coordinate, gfx_get_pixel_depth(Coordinate.first, Coordinate.second));
+        }
+
+        std::lock_guard<std::mutex> Lock(PixelDepthMutex);
+        PixelDepthResults = std::move(Results);
+    }
+
+    void Window::DrawFrame(Gfx* Commands, const std::vector<std::unordered_map<Mtx*, MtxF>>& mtx_replacements) {
+        for (size_t i = 0; i < mtx_replacements.size(); i++) {
+            gfx_run(Commands, mtx_replacements[i], i != 0);
             gfx_end_frame();
         }
+
+        if (bDisplayListBenchmark && ++dwBenchmarkFrames == 300) {
+            // Alternates between replaying and reinterpreting interpolated frames so both can be compared in one run.
+            const GfxDisplayListStats Stats = gfx_get_display_list_stats();
+            const uint64_t Passes = std::max<uint64_t>(Stats.interpreted_passes + Stats.replayed_passes, 1);
+            const double FrameTime = (Stats.interpret_time + Stats.replay_time) * 1000.0 / Passes;
+
+            SPDLOG_INFO("Display lists {}: {:.3f} ms per game frame, {:.3f} ms per drawn frame over {:.2f} frames per game frame, {:.3f} ms budget at {} fps",
+                bDisplayListReplay ? "replayed" : "interpreted", FrameTime * Passes / dwBenchmarkFrames, FrameTime,
+                (double)Passes / dwBenchmarkFrames, 1000.0 / std::max(dwTargetFps, 1u), dwTargetFps);
+            if (Stats.replayed_passes != 0) {
+                SPDLOG_INFO("Display lists replayed: {:.3f} ms first pass, {:.3f} ms replay, {:.1f}% of {} vertex loads reused, {} branch divergences",
+                    Stats.interpret_time * 1000.0 / std::max<uint64_t>(Stats.interpreted_passes, 1), Stats.replay_time * 1000.0 / Stats.replayed_passes,
+                    Stats.vertex_loads_reused * 100.0 / std::max<uint64_t>(Stats.vertex_loads, 1), Stats.vertex_loads, Stats.branch_divergences);
+                SPDLOG_INFO("Display lists replayed: {:.1f} ns per command interpreted, {:.1f} ns per command replayed",
+                    Stats.interpret_time * 1e9 / std::max<uint64_t>(Stats.interpreted_commands, 1),
+                    Stats.replay_time * 1e9 / std::max<uint64_t>(Stats.replayed_commands, 1));
+            }
+
+            dwBenchmarkFrames = 0;
+            bDisplayListReplay = !bDisplayListReplay;
+            gfx_set_display_list_replay(bDisplayListReplay);
+            gfx_reset_display_list_stats();
+        }
     }
 
     void Window::SetTargetFps(int fps) {
-        gfx_set_target_fps(fps);
+        dwTargetFps = fps;
+        // Pipelined frames carry it over to the render thread.
+        if (!bPipelinedRendering) {
+            gfx_set_target_fps(fps);
+        }
     }
 
     void Window::SetMaximumFrameLatency(int latency) {
-        gfx_set_maximum_frame_latency(latency);
+        dwMaximumFrameLatency = latency;
+        if (!bPipelinedRendering) {
+            gfx_set_maximum_frame_latency(latency);
+        }
     }
 
     void Window::GetPixelDepthPrepare(float x, float y) {
+        if (bPipelinedRendering) {
+            std::lock_guard<std::mutex> Lock(PixelDepthMutex);
+            PixelDepthRequests.emplace(x, y);
+            return;
+        }
+
         gfx_get_pixel_depth_prepare(x, y);
     }
 
     uint16_t Window::GetPixelDepth(float x, float y) {
+        if (bPipelinedRendering) {
+            // Answered from the last frame the render thread finished, a coordinate seen for the first time reads
+            // as a cleared depth buffer until then.
+            std::lock_guard<std::mutex> Lock(PixelDepthMutex);
+            PixelDepthRequests.emplace(x, y);
+            const auto it = PixelDepthResults.find(std::make_pair(x, y));
+            return it != PixelDepthResults.end() ? it->second : 0xFFFC;
+        }
+
         return gfx_get_pixel_depth(x, y);
     }
 
@@ -328,7 +632,37 @@ namespace Ship {
     }
 
     void Window::MainLoop(void (*MainFunction)(void)) {
-        WmApi->main_loop(MainFunction);
+        GameFrameStart = std::chrono::steady_clock::now();
+
+        if (!bPipelinedRendering) {
+            WmApi->main_loop(MainFunction);
+            return;
+        }
+
+        GameFunction = MainFunction;
+        bGameThreadRunning = true;
+        SohImGui::console->QueueCommands = true;
+        GameThread = std::thread(&Window::RunGameThread, this);
+
+        // The window manager shuts down right after the exit hooks, the game may not outlive it.
+        Ship::RegisterHook<Ship::ExitGame>([this]() {
+            StopGameThread();
+        });
+
+        WmApi->main_loop(RenderIteration);
+        StopGameThread();
+    }
+
+    void Window::StopGameThread() {
+        {
+            std::lock_guard<std::mutex> Lock(FrameMutex);
+            bStopGameThread = true;
+        }
+
+        FrameCondition.notify_all();
+        if (GameThread.joinable() && GameThread.get_id() != std::this_thread::get_id()) {
+            GameThread.join();
+        }
     }
     bool Window::KeyUp(int32_t dwScancode) {
         std::shared_ptr<Mercury> pConf = GlobalCtx2::GetInstance()->GetConfig();
@@ -401,6 +735,12 @@ namespace Ship {
     }
 
     void Window::InitializeAudioPlayer() {
+        // "null" plays audio into nothing, for running without an audio device.
+        if (GlobalCtx2::GetInstance()->GetConfig()->getString("Window.AudioBackend") == "null") {
+            APlayer = std::make_shared<NullAudioPlayer>();
+            return;
+        }
+
 #ifdef _WIN32
         APlayer = std::make_shared<WasapiAudioPlayer>();
 #elif defined(__linux)
@@ -1,5 +1,11 @@
 #pragma once
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <set>
 #include "PR/ultra64/gbi.h"
 #include "Lib/Fast3D/gfx_pc.h"
 #include "UltraController.h"
@@ -9,10 +15,22 @@
 #include <string>
 
 #include "Lib/Fast3D/gfx_window_manager_api.h"
+#include "Lib/Fast3D/gfx_rendering_api.h"
 
 namespace Ship {
 	class AudioPlayer;
 
+	// Times are in seconds and summed over all frames since the last reset.
+	struct FramePipelineStats {
+		uint64_t Frames;
+		double GameTime; // Simulating and building display lists
+		double GameWaitTime; // Game thread blocked until the previous frame was drawn
+		double RenderTime; // Interpreting display lists and presenting
+		double RenderWaitTime; // Render thread idle until the game handed off a frame
+		double Latency; // Hand off to present
+		double MaxLatency;
+	};
+
 	class Window {
 		public:
 			static int32_t lastScancode;
@@ -24,6 +42,12 @@ namespace Ship {
 			void Init();
 			void StartFrame();
 			void RunCommands(Gfx* Commands, const std::vector<std::unordered_map<Mtx*, MtxF>>& mtx_replacements);
+			// Blocks until the renderer is done with every frame handed to RunCommands. Needed before the game touches
+			// memory a display list in flight may still read from. Returns immediately unless rendering is pipelined.
+			void WaitForRenderer();
+			bool IsRenderingPipelined() { return bPipelinedRendering; }
+			FramePipelineStats GetFramePipelineStats();
+			void ResetFramePipelineStats();
 			void SetTargetFps(int fps);
 			void SetMaximumFrameLatency(int latency);
 			void GetPixelDepthPrepare(float x, float y);
@@ -49,6 +73,12 @@ namespace Ship {
 			static void OnFullscreenChanged(bool bIsNowFullscreen);
 			void InitializeControlDeck();
 			void InitializeAudioPlayer();
+			void DrawFrame(Gfx* Commands, const std::vector<std::unordered_map<Mtx*, MtxF>>& mtx_replacements);
+			void RunGameThread();
+			void StopGameThread();
+			void RenderPendingFrame();
+			void UpdatePixelDepth();
+			static void RenderIteration();
 
 			std::weak_ptr<GlobalCtx2> Context;
 			std::shared_ptr<AudioPlayer> APlayer;
@@ -60,5 +90,37 @@ namespace Ship {
 			uint32_t dwWidth;
 			uint32_t dwHeight;
 			uint32_t dwMenubar;
+			uint32_t dwTargetFps = 20;
+			bool bDisplayListReplay;
+			bool bDisplayListBenchmark;
+			uint32_t dwBenchmarkFrames = 0;
+			int32_t dwMaximumFrameLatency = 1;
+
+			// With pipelined rendering the game runs on GameThread and hands each frame to the main thread, which owns
+			// the window and the graphics context, then simulates the next frame while this one is drawn.
+			bool bPipelinedRendering = false;
+			void (*GameFunction)(void);
+			std::thread GameThread;
+			std::mutex FrameMutex;
+			std::condition_variable FrameCondition;
+			bool bFramePending = false;
+			bool bFrameRendering = false;
+			// Set by the render thread while a menu or debug window that may read or change game state is open. The game
+			// then waits for each frame to be drawn before simulating the next one, as if rendering were not pipelined.
+			bool bMenusOpen = true;
+			bool bGameThreadRunning = false;
+			std::atomic<bool> bStopGameThread = false;
+			Gfx* PendingCommands;
+			std::vector<std::unordered_map<Mtx*, MtxF>> PendingMtxReplacements;
+			int32_t dwPendingTargetFps;
+			int32_t dwPendingMaximumFrameLatency;
+			std::chrono::steady_clock::time_point PendingSubmitTime;
+			std::chrono::steady_clock::time_point GameFrameStart;
+			FramePipelineStats PipelineStats = {};
+
+			// The game can only read back depth from the frame the render thread finished last.
+			std::mutex PixelDepthMutex;
+			std::set<std::pair<float, float>> PixelDepthRequests;
+			std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> PixelDepthResults;
 	};
 }
@@ -8,6 +8,7 @@
 #include "Lib/Fast3D/gfx_direct3d12.h"
 #include "Lib/Fast3D/gfx_gx2.h"
 #include "Lib/Fast3D/gfx_wiiu.h"
+#include "Lib/Fast3D/gfx_null.h"
 #include "Lib/Fast3D/gfx_window_manager_api.h"
 
 #include <string>
@@ -66,4 +67,8 @@ void SetWindowManager(struct GfxWindowManagerAPI** WmApi, struct GfxRenderingAPI
     }
 #endif
 #endif
+    if (gfx_backend == "null") {
+        *RenderingApi = &gfx_null_api;
+        *WmApi = &gfx_null_wapi;
+    }
 }
\ No newline at end of file
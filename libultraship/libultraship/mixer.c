@@ -1,9 +1,35 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include "mixer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SIMD_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MIXER_SIMD_NEON
+#endif
+
+#if defined(MIXER_SIMD_SSE2) || defined(MIXER_SIMD_NEON)
+#define MIXER_SIMD
+#endif
+
+#ifdef MIXER_SIMD_SSE2
+#include <immintrin.h>
+#define MIXER_SIMD_AVX2
+
+// AVX2 is not baseline on x86, so its kernels are compiled for it on their own and only used when the CPU has it.
+#if defined(__GNUC__) || defined(__clang__)
+#define MIXER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define MIXER_TARGET_AVX2
+#endif
+#endif
+
 #ifndef __clang__
 #pragma GCC optimize ("unroll-loops")
 #endif
@@ -39,6 +65,10 @@ static struct {
         int16_t as_s16[DMEM_BUF_SIZE / sizeof(int16_t)];
         uint8_t as_u8[DMEM_BUF_SIZE];
     } buf;
+
+#ifdef MIXER_SIMD
+    int16_t adpcm_columns[8][10][8];
+#endif
 } rspa;
 
 static int16_t resample_table[64][4] = {
@@ -94,6 +124,542 @@ static inline int32_t clamp32(int64_t v) {
     return (int32_t)v;
 }
 
+static inline bool ranges_overlap(const int16_t *a, int a_len, const int16_t *b, int b_len) {
+    return a < b + b_len && b < a + a_len;
+}
+
+// The vector kernels below produce exactly what the scalar ones do. Those are kept for the cases a vector kernel would
+// not, like buffers overlapping in a way that makes the scalar code read samples it has just written.
+
+static void interleave_scalar(int16_t *d, const int16_t *l, const int16_t *r, int count) {
+    while (count > 0) {
+        int16_t l0 = *l++;
+        int16_t l1 = *l++;
+        int16_t l2 = *l++;
+        int16_t l3 = *l++;
+        int16_t r0 = *r++;
+        int16_t r1 = *r++;
+        int16_t r2 = *r++;
+        int16_t r3 = *r++;
+        *d++ = l0;
+        *d++ = r0;
+        *d++ = l1;
+        *d++ = r1;
+        *d++ = l2;
+        *d++ = r2;
+        *d++ = l3;
+        *d++ = r3;
+        --count;
+    }
+}
+
+#ifdef MIXER_SIMD
+static void interleave_simd(int16_t *d, const int16_t *l, const int16_t *r, int count) {
+    for (; count >= 2; count -= 2) {
+#if defined(MIXER_SIMD_SSE2)
+        __m128i l8 = _mm_loadu_si128((const __m128i *)l);
+        __m128i r8 = _mm_loadu_si128((const __m128i *)r);
+        _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi16(l8, r8));
+        _mm_storeu_si128((__m128i *)(d + 8), _mm_unpackhi_epi16(l8, r8));
+#else
+        int16x8x2_t lr = { { vld1q_s16(l), vld1q_s16(r) } };
+        vst2q_s16(d, lr);
+#endif
+        l += 8;
+        r += 8;
+        d += 16;
+    }
+    if (count != 0) {
+#if defined(MIXER_SIMD_SSE2)
+        __m128i l4 = _mm_loadl_epi64((const __m128i *)l);
+        __m128i r4 = _mm_loadl_epi64((const __m128i *)r);
+        _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi16(l4, r4));
+#else
+        int16x4x2_t lr = { { vld1_s16(l), vld1_s16(r) } };
+        vst2_s16(d, lr);
+#endif
+    }
+}
+#endif
+
+static inline const uint8_t *adpcm_unpack(const uint8_t *in, int shift, bool two_bit, int16_t ins[8]) {
+    int j;
+    if (two_bit) {
+        for (j = 0; j < 2; j++) {
+            ins[j * 4] = (((*in >> 6) << 30) >> 30) << shift;
+            ins[j * 4 + 1] = ((((*in >> 4) & 0x3) << 30) >> 30) << shift;
+            ins[j * 4 + 2] = ((((*in >> 2) & 0x3) << 30) >> 30) << shift;
+            ins[j * 4 + 3] = (((*in++ & 0x3) << 30) >> 30) << shift;
+        }
+    } else {
+        for (j = 0; j < 4; j++) {
+            ins[j * 2] = (((*in >> 4) << 28) >> 28) << shift;
+            ins[j * 2 + 1] = (((*in++ & 0xf) << 28) >> 28) << shift;
+        }
+    }
+    return in;
+}
+
+static inline void adpcm_predict_scalar(int16_t (*tbl)[8], const int16_t ins[8], int16_t *out) {
+    int16_t prev1 = out[-1];
+    int16_t prev2 = out[-2];
+    int j, k;
+    for (j = 0; j < 8; j++) {
+        int32_t acc = tbl[0][j] * prev2 + tbl[1][j] * prev1 + (ins[j] << 11);
+        for (k = 0; k < j; k++) {
+            acc += tbl[1][((j - k) - 1)] * ins[k];
+        }
+        acc >>= 11;
+        *out++ = clamp16(acc);
+    }
+}
+
+// Decodes nbytes worth of output after the 16 samples of history out already points past.
+static void adpcm_decode_scalar(const uint8_t *in, int16_t *out, int nbytes, bool two_bit, int16_t (*tables)[2][8]) {
+    while (nbytes > 0) {
+        int shift = *in >> 4; // should be in 0..12 or 0..14
+        int table_index = *in++ & 0xf; // should be in 0..7
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            int16_t ins[8];
+            in = adpcm_unpack(in, shift, two_bit, ins);
+            adpcm_predict_scalar(tables[table_index], ins, out);
+            out += 8;
+        }
+        nbytes -= 16 * sizeof(int16_t);
+    }
+}
+
+#ifdef MIXER_SIMD
+// Each of the 8 outputs of a decoding step is a dot product of the two previous outputs and the step's samples, which
+// makes the step a matrix multiplication. Column 0 and 1 weigh the previous outputs, column 2 + k weighs sample k,
+// with the << 11 of the sample itself on the diagonal. SSE2 keeps columns interleaved in pairs for _mm_madd_epi16.
+static void adpcm_build_columns(int16_t (*tbl)[8], int16_t columns[10][8]) {
+    int16_t cols[10][8];
+    int j, k;
+
+    for (j = 0; j < 8; j++) {
+        cols[0][j] = tbl[0][j];
+        cols[1][j] = tbl[1][j];
+        for (k = 0; k < 8; k++) {
+            cols[2 + k][j] = j == k ? 1 << 11 : j > k ? tbl[1][j - k - 1] : 0;
+        }
+    }
+
+#if defined(MIXER_SIMD_SSE2)
+    for (k = 0; k < 10; k += 2) {
+        for (j = 0; j < 8; j++) {
+            columns[k][j] = cols[k + (j & 1)][(j >> 1)];
+            columns[k + 1][j] = cols[k + (j & 1)][4 + (j >> 1)];
+        }
+    }
+#else
+    memcpy(columns, cols, sizeof(cols));
+#endif
+}
+
+static void adpcm_decode_simd(const uint8_t *in, int16_t *out, int nbytes, bool two_bit, int16_t (*tables)[2][8],
+                              int16_t (*columns)[10][8]) {
+    while (nbytes > 0) {
+        int shift = *in >> 4;
+        int table_index = *in++ & 0xf;
+        int16_t (*cols)[8] = columns[table_index & 7];
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            int16_t ins[8];
+            in = adpcm_unpack(in, shift, two_bit, ins);
+            if (table_index >= 8) {
+                // Broken data, the scalar code reads whatever follows the tables.
+                adpcm_predict_scalar(tables[table_index], ins, out);
+                out += 8;
+                continue;
+            }
+#if defined(MIXER_SIMD_SSE2)
+            // Lane pairs of (previous outputs) and (sample 2k, sample 2k + 1) line up with the interleaved columns.
+            const __m128i insv = _mm_loadu_si128((const __m128i *)ins);
+            const __m128i x[5] = {
+                _mm_set1_epi32((uint16_t)out[-2] | ((uint32_t)(uint16_t)out[-1] << 16)),
+                _mm_shuffle_epi32(insv, _MM_SHUFFLE(0, 0, 0, 0)),
+                _mm_shuffle_epi32(insv, _MM_SHUFFLE(1, 1, 1, 1)),
+                _mm_shuffle_epi32(insv, _MM_SHUFFLE(2, 2, 2, 2)),
+                _mm_shuffle_epi32(insv, _MM_SHUFFLE(3, 3, 3, 3)),
+            };
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+            int p;
+            for (p = 0; p < 5; p++) {
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)cols[2 * p]), x[p]));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)cols[2 * p + 1]), x[p]));
+            }
+            _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(_mm_srai_epi32(lo, 11), _mm_srai_epi32(hi, 11)));
+#else
+            int32x4_t lo = vmull_n_s16(vld1_s16(cols[0]), out[-2]);
+            int32x4_t hi = vmull_n_s16(vld1_s16(cols[0] + 4), out[-2]);
+            int k;
+            lo = vmlal_n_s16(lo, vld1_s16(cols[1]), out[-1]);
+            hi = vmlal_n_s16(hi, vld1_s16(cols[1] + 4), out[-1]);
+            for (k = 0; k < 8; k++) {
+                lo = vmlal_n_s16(lo, vld1_s16(cols[2 + k]), ins[k]);
+                hi = vmlal_n_s16(hi, vld1_s16(cols[2 + k] + 4), ins[k]);
+            }
+            vst1q_s16(out, vcombine_s16(vqshrn_n_s32(lo, 11), vqshrn_n_s32(hi, 11)));
+#endif
+            out += 8;
+        }
+        nbytes -= 16 * sizeof(int16_t);
+    }
+}
+#endif
+
+// Returns where the input ended up, pitch_accumulator is carried over in place.
+static int16_t *resample_scalar(int16_t *in, int16_t *out, int nbytes, uint16_t pitch, uint32_t *pitch_accumulator) {
+    uint32_t acc = *pitch_accumulator;
+    int i;
+    int16_t *tbl;
+    int32_t sample;
+
+    do {
+        for (i = 0; i < 8; i++) {
+            tbl = resample_table[acc * 64 >> 16];
+            sample = ((in[0] * tbl[0] + 0x4000) >> 15) +
+                     ((in[1] * tbl[1] + 0x4000) >> 15) +
+                     ((in[2] * tbl[2] + 0x4000) >> 15) +
+                     ((in[3] * tbl[3] + 0x4000) >> 15);
+            *out++ = clamp16(sample);
+
+            acc += (pitch << 1);
+            in += acc >> 16;
+            acc %= 0x10000;
+        }
+        nbytes -= 8 * sizeof(int16_t);
+    } while (nbytes > 0);
+
+    *pitch_accumulator = acc;
+    return in;
+}
+
+#ifdef MIXER_SIMD
+// The 4 taps of an output are rounded one by one, so only the multiplications and the final sum are vectorized.
+static int16_t *resample_simd(int16_t *in, int16_t *out, int nbytes, uint16_t pitch, uint32_t *pitch_accumulator) {
+    uint32_t acc = *pitch_accumulator;
+    int i;
+
+    do {
+#if defined(MIXER_SIMD_SSE2)
+        const __m128i round = _mm_set1_epi32(0x4000);
+        __m128i terms[8];
+        __m128i sums[2];
+        for (i = 0; i < 8; i += 2) {
+            const int16_t *in0 = in;
+            const int16_t *tbl0 = resample_table[acc * 64 >> 16];
+            acc += (pitch << 1);
+            in += acc >> 16;
+            acc %= 0x10000;
+            const int16_t *in1 = in;
+            const int16_t *tbl1 = resample_table[acc * 64 >> 16];
+            acc += (pitch << 1);
+            in += acc >> 16;
+            acc %= 0x10000;
+
+            __m128i s = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)in0), _mm_loadl_epi64((const __m128i *)in1));
+            __m128i t = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)tbl0), _mm_loadl_epi64((const __m128i *)tbl1));
+            __m128i lo = _mm_mullo_epi16(s, t);
+            __m128i hi = _mm_mulhi_epi16(s, t);
+            terms[i] = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+            terms[i + 1] = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+        }
+        for (i = 0; i < 2; i++) {
+            const __m128i *p = terms + 4 * i;
+            __m128i u01 = _mm_add_epi32(_mm_unpacklo_epi32(p[0], p[1]), _mm_unpackhi_epi32(p[0], p[1]));
+            __m128i u23 = _mm_add_epi32(_mm_unpacklo_epi32(p[2], p[3]), _mm_unpackhi_epi32(p[2], p[3]));
+            sums[i] = _mm_add_epi32(_mm_unpacklo_epi64(u01, u23), _mm_unpackhi_epi64(u01, u23));
+        }
+        _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(sums[0], sums[1]));
+#else
+        int32_t sums[8];
+        for (i = 0; i < 8; i++) {
+            const int16_t *tbl = resample_table[acc * 64 >> 16];
+            sums[i] = vaddvq_s32(vrshrq_n_s32(vmull_s16(vld1_s16(in), vld1_s16(tbl)), 15));
+            acc += (pitch << 1);
+            in += acc >> 16;
+            acc %= 0x10000;
+        }
+        vst1q_s16(out, vcombine_s16(vqmovn_s32(vld1q_s32(sums)), vqmovn_s32(vld1q_s32(sums + 4))));
+#endif
+        out += 8;
+        nbytes -= 8 * sizeof(int16_t);
+    } while (nbytes > 0);
+
+    *pitch_accumulator = acc;
+    return in;
+}
+#endif
+
+typedef struct {
+    int16_t *dry[2];
+    int16_t *wet[2];
+    int16_t negs[4];
+    int swapped[2];
+    uint16_t vols[2];
+    uint16_t rates[2];
+    uint16_t vol_wet;
+    uint16_t rate_wet;
+} EnvMixer;
+
+static void env_mix_scalar(const int16_t *in, int n, EnvMixer *e) {
+    do {
+        for (int i = 0; i < 8; i++) {
+            int16_t samples[2] = {*in, *in}; in++;
+            for (int j = 0; j < 2; j++) {
+                samples[j] = (samples[j] * e->vols[j] >> 16) ^ e->negs[j];
+            }
+            for (int j = 0; j < 2; j++) {
+                *e->dry[j] = clamp16(*e->dry[j] + samples[j]); e->dry[j]++;
+                *e->wet[j] = clamp16(*e->wet[j] + ((samples[e->swapped[j]] * e->vol_wet >> 16) ^ e->negs[2 + j])); e->wet[j]++;
+            }
+        }
+        e->vols[0] += e->rates[0];
+        e->vols[1] += e->rates[1];
+        e->vol_wet += e->rate_wet;
+
+        n -= 8;
+    } while (n > 0);
+}
+
+#ifdef MIXER_SIMD
+#if defined(MIXER_SIMD_SSE2)
+// (s * v) >> 16 for signed samples and an unsigned volume.
+static inline __m128i mul_volume(__m128i s, uint16_t v) {
+    __m128i hi = _mm_mulhi_epi16(s, _mm_set1_epi16((int16_t)v));
+    // Read as signed, a volume of 0x8000 or more is 0x10000 short, which leaves the product s short in the high half.
+    return (v & 0x8000) ? _mm_add_epi16(hi, s) : hi;
+}
+#else
+static inline int16x8_t mul_volume(int16x8_t s, uint16_t v) {
+    int32x4_t lo = vmulq_n_s32(vmovl_s16(vget_low_s16(s)), v);
+    int32x4_t hi = vmulq_n_s32(vmovl_s16(vget_high_s16(s)), v);
+    return vcombine_s16(vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16));
+}
+#endif
+
+// Mixes 8 samples at a time, in the order the scalar kernel touches each output buffer.
+static void env_mix_simd(const int16_t *in, int n, EnvMixer *e) {
+    do {
+#if defined(MIXER_SIMD_SSE2)
+        const __m128i s = _mm_loadu_si128((const __m128i *)in);
+        const __m128i samples[2] = {
+            _mm_xor_si128(mul_volume(s, e->vols[0]), _mm_set1_epi16(e->negs[0])),
+            _mm_xor_si128(mul_volume(s, e->vols[1]), _mm_set1_epi16(e->negs[1])),
+        };
+        for (int j = 0; j < 2; j++) {
+            __m128i wet = _mm_xor_si128(mul_volume(samples[e->swapped[j]], e->vol_wet), _mm_set1_epi16(e->negs[2 + j]));
+            _mm_storeu_si128((__m128i *)e->dry[j], _mm_adds_epi16(_mm_loadu_si128((const __m128i *)e->dry[j]), samples[j]));
+            _mm_storeu_si128((__m128i *)e->wet[j], _mm_adds_epi16(_mm_loadu_si128((const __m128i *)e->wet[j]), wet));
+            e->dry[j] += 8;
+            e->wet[j] += 8;
+        }
+#else
+        const int16x8_t s = vld1q_s16(in);
+        const int16x8_t samples[2] = {
+            veorq_s16(mul_volume(s, e->vols[0]), vdupq_n_s16(e->negs[0])),
+            veorq_s16(mul_volume(s, e->vols[1]), vdupq_n_s16(e->negs[1])),
+        };
+        for (int j = 0; j < 2; j++) {
+            int16x8_t wet = veorq_s16(mul_volume(samples[e->swapped[j]], e->vol_wet), vdupq_n_s16(e->negs[2 + j]));
+            vst1q_s16(e->dry[j], vqaddq_s16(vld1q_s16(e->dry[j]), samples[j]));
+            vst1q_s16(e->wet[j], vqaddq_s16(vld1q_s16(e->wet[j]), wet));
+            e->dry[j] += 8;
+            e->wet[j] += 8;
+        }
+#endif
+        in += 8;
+        e->vols[0] += e->rates[0];
+        e->vols[1] += e->rates[1];
+        e->vol_wet += e->rate_wet;
+
+        n -= 8;
+    } while (n > 0);
+}
+#endif
+
+static void mix_scalar(int16_t *out, const int16_t *in, int nbytes, int16_t gain) {
+    int i;
+    int32_t sample;
+
+    if (gain == -0x8000) {
+        while (nbytes > 0) {
+            for (i = 0; i < 16; i++) {
+                sample = *out - *in++;
+                *out++ = clamp16(sample);
+            }
+            nbytes -= 16 * sizeof(int16_t);
+        }
+    }
+
+    while (nbytes > 0) {
+        for (i = 0; i < 16; i++) {
+            sample = ((*out * 0x7fff + *in++ * gain) + 0x4000) >> 15;
+            *out++ = clamp16(sample);
+        }
+
+        nbytes -= 16 * sizeof(int16_t);
+    }
+}
+
+#ifdef MIXER_SIMD
+static void mix_simd(int16_t *out, const int16_t *in, int nbytes, int16_t gain) {
+#if defined(MIXER_SIMD_SSE2)
+    const __m128i weights = _mm_set1_epi32(0x7fff | ((uint32_t)(uint16_t)gain << 16));
+    const __m128i round = _mm_set1_epi32(0x4000);
+#endif
+
+    for (; nbytes > 0; nbytes -= 8 * sizeof(int16_t)) {
+#if defined(MIXER_SIMD_SSE2)
+        __m128i o = _mm_loadu_si128((const __m128i *)out);
+        __m128i s = _mm_loadu_si128((const __m128i *)in);
+        if (gain == -0x8000) {
+            _mm_storeu_si128((__m128i *)out, _mm_subs_epi16(o, s));
+        } else {
+            // The sum of both products stays within 32 bits for any gain.
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(o, s), weights);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(o, s), weights);
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+            _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(lo, hi));
+        }
+#else
+        int16x8_t o = vld1q_s16(out);
+        int16x8_t s = vld1q_s16(in);
+        if (gain == -0x8000) {
+            vst1q_s16(out, vqsubq_s16(o, s));
+        } else {
+            int32x4_t lo = vmlal_n_s16(vmull_n_s16(vget_low_s16(o), 0x7fff), vget_low_s16(s), gain);
+            int32x4_t hi = vmlal_n_s16(vmull_n_s16(vget_high_s16(o), 0x7fff), vget_high_s16(s), gain);
+            vst1q_s16(out, vcombine_s16(vqrshrn_n_s32(lo, 15), vqrshrn_n_s32(hi, 15)));
+        }
+#endif
+        out += 8;
+        in += 8;
+    }
+}
+#endif
+
+#ifdef MIXER_SIMD_AVX2
+// Only mixing gains from twice the width. Decoding and resampling work in blocks of 8 samples, and the envelope ramps
+// once per 8 samples, so they stay on SSE2.
+MIXER_TARGET_AVX2 static void mix_avx2(int16_t *out, const int16_t *in, int nbytes, int16_t gain) {
+    const __m256i weights = _mm256_set1_epi32(0x7fff | ((uint32_t)(uint16_t)gain << 16));
+    const __m256i round = _mm256_set1_epi32(0x4000);
+
+    for (; nbytes > 0; nbytes -= 16 * sizeof(int16_t)) {
+        __m256i o = _mm256_loadu_si256((const __m256i *)out);
+        __m256i s = _mm256_loadu_si256((const __m256i *)in);
+        if (gain == -0x8000) {
+            _mm256_storeu_si256((__m256i *)out, _mm256_subs_epi16(o, s));
+        } else {
+            // Unpacking and packing both work within 128 bit halves, so the samples come back in order.
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(o, s), weights);
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(o, s), weights);
+            lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+            hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+            _mm256_storeu_si256((__m256i *)out, _mm256_packs_epi32(lo, hi));
+        }
+        out += 16;
+        in += 16;
+    }
+
+    // Leaves no dirty upper register halves behind to slow down the SSE code that follows.
+    _mm256_zeroupper();
+}
+
+static bool mixer_cpu_has_avx2(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    // The CPU supports AVX, and the OS saves the upper register halves across context switches.
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Checked on first use, from the thread running the command lists like everything else in rspa.
+static enum { AVX2_UNCHECKED, AVX2_UNSUPPORTED, AVX2_SUPPORTED } avx2_support;
+
+static bool mixer_use_avx2(void) {
+    if (avx2_support == AVX2_UNCHECKED) {
+        avx2_support = mixer_cpu_has_avx2() ? AVX2_SUPPORTED : AVX2_UNSUPPORTED;
+    }
+    return avx2_support == AVX2_SUPPORTED;
+}
+#endif
+
+static MixerCommandStats command_stats[MIXER_CMD_COUNT];
+
+#ifdef MIXER_SIMD
+static bool kernels_scalar;
+
+static struct {
+    bool enabled;
+    bool running;
+    union {
+        int16_t as_s16[DMEM_BUF_SIZE / sizeof(int16_t)];
+        uint8_t as_u8[DMEM_BUF_SIZE];
+    } input, expected;
+    int16_t input_state[16];
+    int16_t expected_state[16];
+} kernel_check;
+
+static void kernel_check_begin(const int16_t *state) {
+    memcpy(&kernel_check.input, &rspa.buf, sizeof(rspa.buf));
+    if (state != NULL) {
+        memcpy(kernel_check.input_state, state, sizeof(kernel_check.input_state));
+    }
+    kernels_scalar = true;
+}
+
+static void kernel_check_switch(int16_t *state) {
+    memcpy(&kernel_check.expected, &rspa.buf, sizeof(rspa.buf));
+    memcpy(&rspa.buf, &kernel_check.input, sizeof(rspa.buf));
+    if (state != NULL) {
+        memcpy(kernel_check.expected_state, state, sizeof(kernel_check.expected_state));
+        memcpy(state, kernel_check.input_state, sizeof(kernel_check.input_state));
+    }
+    kernels_scalar = false;
+}
+
+static void kernel_check_end(MixerCommand cmd, const int16_t *state) {
+    command_stats[cmd].checked++;
+    if (memcmp(&kernel_check.expected, &rspa.buf, sizeof(rspa.buf)) != 0 ||
+        (state != NULL && memcmp(kernel_check.expected_state, state, sizeof(kernel_check.expected_state)) != 0)) {
+        command_stats[cmd].mismatched++;
+    }
+}
+
+// Makes the command calling it run once with the scalar kernels and once more from the same input with the vector ones,
+// keeping the vector output. state is the command's state outside of DMEM, or NULL.
+#define KERNEL_CHECK(cmd, state, call)                      \
+    if (kernel_check.enabled && !kernel_check.running) { \
+        kernel_check.running = true;                     \
+        kernel_check_begin(state);                       \
+        call;                                            \
+        kernel_check_switch(state);                      \
+        call;                                            \
+        kernel_check_end(cmd, state);                    \
+        kernel_check.running = false;                    \
+        return;                                          \
+    }
+#else
+#define KERNEL_CHECK(cmd, state, call)
+#endif
+
 void aClearBufferImpl(uint16_t addr, int nbytes) {
     nbytes = ROUND_UP_16(nbytes);
     memset(BUF_U8(addr), 0, nbytes);
@@ -109,6 +675,11 @@ void aSaveBufferImpl(uint16_t source_addr, int16_t *dest_addr, uint16_t nbytes)
 
 void aLoadADPCMImpl(int num_entries_times_16, const int16_t *book_source_addr) {
     memcpy(rspa.adpcm_table, book_source_addr, num_entries_times_16);
+#ifdef MIXER_SIMD
+    for (int i = 0; i < 8 && i * (int)sizeof(rspa.adpcm_table[0]) < num_entries_times_16; i++) {
+        adpcm_build_columns(rspa.adpcm_table[i], rspa.adpcm_columns[i]);
+    }
+#endif
 }
 
 void aSetBufferImpl(uint8_t flags, uint16_t in, uint16_t out, uint16_t nbytes) {
@@ -122,25 +693,15 @@ void aInterleaveImpl(uint16_t dest, uint16_t left, uint16_t right, uint16_t c) {
     int16_t *l = BUF_S16(left);
     int16_t *r = BUF_S16(right);
     int16_t *d = BUF_S16(dest);
-    while (count > 0) {
-        int16_t l0 = *l++;
-        int16_t l1 = *l++;
-        int16_t l2 = *l++;
-        int16_t l3 = *l++;
-        int16_t r0 = *r++;
-        int16_t r1 = *r++;
-        int16_t r2 = *r++;
-        int16_t r3 = *r++;
-        *d++ = l0;
-        *d++ = r0;
-        *d++ = l1;
-        *d++ = r1;
-        *d++ = l2;
-        *d++ = r2;
-        *d++ = l3;
-        *d++ = r3;
-        --count;
+
+    KERNEL_CHECK(MIXER_CMD_INTERLEAVE, NULL, aInterleaveImpl(dest, left, right, c));
+#ifdef MIXER_SIMD
+    if (!kernels_scalar && !ranges_overlap(d, count * 8, l, count * 4) && !ranges_overlap(d, count * 8, r, count * 4)) {
+        interleave_simd(d, l, r, count);
+        return;
     }
+#endif
+    interleave_scalar(d, l, r, count);
 }
 
 void aDMEMMoveImpl(uint16_t in_addr, uint16_t out_addr, int nbytes) {
@@ -156,6 +717,8 @@ void aADPCMdecImpl(uint8_t flags, ADPCM_STATE state) {
     uint8_t *in = BUF_U8(rspa.in);
     int16_t *out = BUF_S16(rspa.out);
     int nbytes = ROUND_UP_32(rspa.nbytes);
+
+    KERNEL_CHECK(MIXER_CMD_ADPCM_DEC, state, aADPCMdecImpl(flags, state));
     if (flags & A_INIT) {
         memset(out, 0, 16 * sizeof(int16_t));
     } else if (flags & A_LOOP) {
@@ -165,44 +728,35 @@ void aADPCMdecImpl(uint8_t flags, ADPCM_STATE state) {
     }
     out += 16;
 
-    while (nbytes > 0) {
-        int shift = *in >> 4; // should be in 0..12 or 0..14
-        int table_index = *in++ & 0xf; // should be in 0..7
-        int16_t (*tbl)[8] = rspa.adpcm_table[table_index];
-        int i;
-
-        for (i = 0; i < 2; i++) {
-            int16_t ins[8];
-            int16_t prev1 = out[-1];
-            int16_t prev2 = out[-2];
-            int j, k;
-			if (flags & 4) {
-				for (j = 0; j < 2; j++) {
-					ins[j * 4] = (((*in >> 6) << 30) >> 30) << shift;
-					ins[j * 4 + 1] = ((((*in >> 4) & 0x3) << 30) >> 30) << shift;
-					ins[j * 4 + 2] = ((((*in >> 2) & 0x3) << 30) >> 30) << shift;
-					ins[j * 4 + 3] = (((*in++ & 0x3) << 30) >> 30) << shift;
-				}
-			} else {
-				for (j = 0; j < 4; j++) {
-					ins[j * 2] = (((*in >> 4) << 28) >> 28) << shift;
-					ins[j * 2 + 1] = (((*in++ & 0xf) << 28) >> 28) << shift;
-				}
-			}
-            for (j = 0; j < 8; j++) {
-                int32_t acc = tbl[0][j] * prev2 + tbl[1][j] * prev1 + (ins[j] << 11);
-                for (k = 0; k < j; k++) {
-                    acc += tbl[1][((j - k) - 1)] * ins[k];
-                }
-                acc >>= 11;
-                *out++ = clamp16(acc);
-            }
-        }
-        nbytes -= 16 * sizeof(int16_t);
+#ifdef MIXER_SIMD
+    if (!kernels_scalar) {
+        adpcm_decode_simd(in, out, nbytes, flags & 4, rspa.adpcm_table, rspa.adpcm_columns);
+    } else {
+        adpcm_decode_scalar(in, out, nbytes, flags & 4, rspa.adpcm_table);
     }
+#else
+    adpcm_decode_scalar(in, out, nbytes, flags & 4, rspa.adpcm_table);
+#endif
+    out += nbytes / sizeof(int16_t);
     memcpy(state, out - 16, 16 * sizeof(int16_t));
 }
 
+void aDecodeADPCM(const uint8_t *in, int16_t *out, int frames, bool two_bit, const int16_t *book, int book_bytes) {
+    // Frames of broken data can index past the book, here they read zeros.
+    int16_t tables[16][2][8] = { 0 };
+    memcpy(tables, book, book_bytes < (int)sizeof(tables) ? book_bytes : (int)sizeof(tables));
+
+#ifdef MIXER_SIMD
+    int16_t columns[8][10][8];
+    for (int i = 0; i < 8; i++) {
+        adpcm_build_columns(tables[i], columns[i]);
+    }
+    adpcm_decode_simd(in, out, frames * 16 * sizeof(int16_t), two_bit, tables, columns);
+#else
+    adpcm_decode_scalar(in, out, frames * 16 * sizeof(int16_t), two_bit, tables);
+#endif
+}
+
 void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state) {
     int16_t tmp[16];
     int16_t *in_initial = BUF_S16(rspa.in);
@@ -211,9 +765,8 @@ void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state) {
     int nbytes = ROUND_UP_16(rspa.nbytes);
     uint32_t pitch_accumulator;
     int i;
-    int16_t *tbl;
-    int32_t sample;
 
+    KERNEL_CHECK(MIXER_CMD_RESAMPLE, state, aResampleImpl(flags, pitch, state));
     if (flags & A_INIT) {
         memset(tmp, 0, 5 * sizeof(int16_t));
     } else {
@@ -227,21 +780,18 @@ void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state) {
     pitch_accumulator = (uint16_t)tmp[4];
     memcpy(in, tmp, 4 * sizeof(int16_t));
 
-    do {
-        for (i = 0; i < 8; i++) {
-            tbl = resample_table[pitch_accumulator * 64 >> 16];
-            sample = ((in[0] * tbl[0] + 0x4000) >> 15) +
-                     ((in[1] * tbl[1] + 0x4000) >> 15) +
-                     ((in[2] * tbl[2] + 0x4000) >> 15) +
-                     ((in[3] * tbl[3] + 0x4000) >> 15);
-            *out++ = clamp16(sample);
-
-            pitch_accumulator += (pitch << 1);
-            in += pitch_accumulator >> 16;
-            pitch_accumulator %= 0x10000;
-        }
-        nbytes -= 8 * sizeof(int16_t);
-    } while (nbytes > 0);
+#ifdef MIXER_SIMD
+    // Vector outputs are only stored after all of their inputs were read.
+    int n_out = nbytes > 0 ? nbytes / (int)sizeof(int16_t) : 8;
+    int n_in = (int)((pitch_accumulator + (uint64_t)(pitch << 1) * n_out) >> 16) + 4;
+    if (!kernels_scalar && !ranges_overlap(out, n_out, in, n_in)) {
+        in = resample_simd(in, out, nbytes, pitch, &pitch_accumulator);
+    } else {
+        in = resample_scalar(in, out, nbytes, pitch, &pitch_accumulator);
+    }
+#else
+    in = resample_scalar(in, out, nbytes, pitch, &pitch_accumulator);
+#endif
 
     state[4] = (int16_t)pitch_accumulator;
     memcpy(state, in, 4 * sizeof(int16_t));
@@ -272,61 +822,51 @@ void aEnvMixerImpl(uint16_t in_addr, uint16_t n_samples, bool swap_reverb,
                    int32_t wet_dry_addr, u32 unk)
 {
     int16_t *in = BUF_S16(in_addr);
-    int16_t *dry[2] = {BUF_S16(((wet_dry_addr >> 24) & 0xFF) << 4), BUF_S16(((wet_dry_addr >> 16) & 0xFF) << 4)};
-    int16_t *wet[2] = {BUF_S16(((wet_dry_addr >> 8) & 0xFF) << 4), BUF_S16(((wet_dry_addr) & 0xFF) << 4)};
-    int16_t negs[4] = {neg_left ? -1 : 0, neg_right ? -1 : 0, neg_3 ? -4 : 0, neg_2 ? -2 : 0};
-    int swapped[2] = {swap_reverb ? 1 : 0, swap_reverb ? 0 : 1};
     int n = ROUND_UP_16(n_samples);
-
-    uint16_t vols[2] = {rspa.vol[0], rspa.vol[1]};
-    uint16_t rates[2] = {rspa.rate[0], rspa.rate[1]};
-    uint16_t vol_wet = rspa.vol_wet;
-    uint16_t rate_wet = rspa.rate_wet;
-
-    do {
-        for (int i = 0; i < 8; i++) {
-            int16_t samples[2] = {*in, *in}; in++;
-            for (int j = 0; j < 2; j++) {
-                samples[j] = (samples[j] * vols[j] >> 16) ^ negs[j];
-            }
-        	for (int j = 0; j < 2; j++) {
-                *dry[j] = clamp16(*dry[j] + samples[j]); dry[j]++;
-                *wet[j] = clamp16(*wet[j] + ((samples[swapped[j]] * vol_wet >> 16) ^ negs[2 + j])); wet[j]++;
-            }
-        }
-        vols[0] += rates[0];
-        vols[1] += rates[1];
-        vol_wet += rate_wet;
-
-        n -= 8;
-    } while (n > 0);
+    EnvMixer e = {
+        {BUF_S16(((wet_dry_addr >> 24) & 0xFF) << 4), BUF_S16(((wet_dry_addr >> 16) & 0xFF) << 4)},
+        {BUF_S16(((wet_dry_addr >> 8) & 0xFF) << 4), BUF_S16(((wet_dry_addr) & 0xFF) << 4)},
+        {neg_left ? -1 : 0, neg_right ? -1 : 0, neg_3 ? -4 : 0, neg_2 ? -2 : 0},
+        {swap_reverb ? 1 : 0, swap_reverb ? 0 : 1},
+        {rspa.vol[0], rspa.vol[1]},
+        {rspa.rate[0], rspa.rate[1]},
+        rspa.vol_wet,
+        rspa.rate_wet,
+    };
+
+    KERNEL_CHECK(MIXER_CMD_ENV_MIXER, NULL,
+                 aEnvMixerImpl(in_addr, n_samples, swap_reverb, neg_3, neg_2, neg_left, neg_right, wet_dry_addr, unk));
+#ifdef MIXER_SIMD
+    // Output buffers are 16 byte aligned, so with an aligned input every buffer either overlaps another in whole
+    // blocks of 8 samples or not at all, and blocks are mixed in the same order single samples are.
+    if (!kernels_scalar && (in_addr & 0xf) == 0) {
+        env_mix_simd(in, n, &e);
+        return;
+    }
+#endif
+    env_mix_scalar(in, n, &e);
 }
 
 void aMixImpl(uint16_t count, int16_t gain, uint16_t in_addr, uint16_t out_addr) {
     int nbytes = ROUND_UP_32(ROUND_DOWN_16(count << 4));
     int16_t *in = BUF_S16(in_addr);
     int16_t *out = BUF_S16(out_addr);
-    int i;
-    int32_t sample;
 
-    if (gain == -0x8000) {
-        while (nbytes > 0) {
-            for (i = 0; i < 16; i++) {
-                sample = *out - *in++;
-                *out++ = clamp16(sample);
-            }
-            nbytes -= 16 * sizeof(int16_t);
-        }
+    KERNEL_CHECK(MIXER_CMD_MIX, NULL, aMixImpl(count, gain, in_addr, out_addr));
+#ifdef MIXER_SIMD_AVX2
+    if (!kernels_scalar && (in >= out || in + 16 <= out) && mixer_use_avx2()) {
+        mix_avx2(out, in, nbytes, gain);
+        return;
     }
-
-    while (nbytes > 0) {
-        for (i = 0; i < 16; i++) {
-            sample = ((*out * 0x7fff + *in++ * gain) + 0x4000) >> 15;
-            *out++ = clamp16(sample);
-        }
-
-        nbytes -= 16 * sizeof(int16_t);
+#endif
+#ifdef MIXER_SIMD
+    // An input trailing the output by less than a vector would have to see samples mixed earlier in the same vector.
+    if (!kernels_scalar && (in >= out || in + 8 <= out)) {
+        mix_simd(out, in, nbytes, gain);
+        return;
     }
+#endif
+    mix_scalar(out, in, nbytes, gain);
 }
 
 void aS8DecImpl(uint8_t flags, ADPCM_STATE state) {
@@ -525,3 +1065,204 @@ void aUnkCmd19Impl(uint8_t f, uint16_t count, uint16_t out_addr, uint16_t in_add
         nbytes -= 32 * sizeof(int16_t);
     } while (nbytes > 0);
 }
+
+#define BENCH_SAMPLES 1024
+
+static struct {
+    uint8_t adpcm_in[BENCH_SAMPLES / 16 * 9];
+    int16_t adpcm_table[8][2][8];
+#ifdef MIXER_SIMD
+    int16_t adpcm_columns[8][10][8];
+#endif
+    int16_t in[BENCH_SAMPLES * 2 + 16];
+    int16_t out[16 + BENCH_SAMPLES];
+    int16_t mix[4][BENCH_SAMPLES];
+} bench;
+
+#ifdef MIXER_SIMD_AVX2
+static bool bench_avx2;
+#endif
+
+static void bench_interleave(bool simd) {
+#ifdef MIXER_SIMD
+    if (simd) {
+        interleave_simd(bench.out, bench.in, bench.in + BENCH_SAMPLES / 2, BENCH_SAMPLES / 8);
+        return;
+    }
+#endif
+    interleave_scalar(bench.out, bench.in, bench.in + BENCH_SAMPLES / 2, BENCH_SAMPLES / 8);
+}
+
+static void bench_adpcm(bool simd) {
+    memset(bench.out, 0, 16 * sizeof(int16_t));
+#ifdef MIXER_SIMD
+    if (simd) {
+        adpcm_decode_simd(bench.adpcm_in, bench.out + 16, BENCH_SAMPLES * sizeof(int16_t), false, bench.adpcm_table,
+                          bench.adpcm_columns);
+        return;
+    }
+#endif
+    adpcm_decode_scalar(bench.adpcm_in, bench.out + 16, BENCH_SAMPLES * sizeof(int16_t), false, bench.adpcm_table);
+}
+
+static void bench_resample(bool simd) {
+    uint32_t pitch_accumulator = 0x1234;
+#ifdef MIXER_SIMD
+    if (simd) {
+        resample_simd(bench.in, bench.out, BENCH_SAMPLES * sizeof(int16_t), 0x6a5f, &pitch_accumulator);
+        return;
+    }
+#endif
+    resample_scalar(bench.in, bench.out, BENCH_SAMPLES * sizeof(int16_t), 0x6a5f, &pitch_accumulator);
+}
+
+static void bench_env_mixer(bool simd) {
+    EnvMixer e = {
+        {bench.mix[0], bench.mix[1]}, {bench.mix[2], bench.mix[3]}, {-1, 0, -4, 0}, {1, 0}, {0x7a00, 0x9c40}, {0x0123, 0xfed0}, 0x5000, 0x0040,
+    };
+#ifdef MIXER_SIMD
+    if (simd) {
+        env_mix_simd(bench.in, BENCH_SAMPLES, &e);
+        return;
+    }
+#endif
+    env_mix_scalar(bench.in, BENCH_SAMPLES, &e);
+}
+
+static void bench_mix(bool simd) {
+#ifdef MIXER_SIMD_AVX2
+    if (simd && bench_avx2) {
+        mix_avx2(bench.mix[0], bench.in, BENCH_SAMPLES * sizeof(int16_t), -0x3c00);
+        return;
+    }
+#endif
+#ifdef MIXER_SIMD
+    if (simd) {
+        mix_simd(bench.mix[0], bench.in, BENCH_SAMPLES * sizeof(int16_t), -0x3c00);
+        return;
+    }
+#endif
+    mix_scalar(bench.mix[0], bench.in, BENCH_SAMPLES * sizeof(int16_t), -0x3c00);
+}
+
+static void bench_fill(void *dst, size_t size, uint32_t *seed) {
+    uint8_t *bytes = (uint8_t *)dst;
+    for (size_t i = 0; i < size; i++) {
+        *seed = *seed * 1664525 + 1013904223;
+        bytes[i] = (uint8_t)(*seed >> 24);
+    }
+}
+
+static void bench_reset(void) {
+    uint32_t seed = 0x2545f491;
+    int i;
+
+    bench_fill(&bench, sizeof(bench), &seed);
+    // Frame headers with a valid predictor index and a shift up to 12.
+    for (i = 0; i < BENCH_SAMPLES / 16; i++) {
+        bench.adpcm_in[i * 9] = (uint8_t)(((bench.adpcm_in[i * 9] >> 4) % 13) << 4 | (bench.adpcm_in[i * 9] & 7));
+    }
+#ifdef MIXER_SIMD
+    for (i = 0; i < 8; i++) {
+        adpcm_build_columns(bench.adpcm_table[i], bench.adpcm_columns[i]);
+    }
+#endif
+}
+
+static double bench_run(void (*kernel)(bool simd), bool simd) {
+    clock_t start = clock();
+    clock_t elapsed;
+    long runs = 0;
+
+    do {
+        for (int i = 0; i < 64; i++) {
+            kernel(simd);
+        }
+        runs += 64;
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 10);
+
+    return (double)runs * BENCH_SAMPLES * CLOCKS_PER_SEC / elapsed;
+}
+
+void aBenchmarkKernels(MixerBenchmarkResult results[MIXER_BENCHMARK_KERNELS]) {
+    static const struct {
+        const char *name;
+        void (*kernel)(bool simd);
+    } kernels[MIXER_BENCHMARK_KERNELS] = {
+        { "ADPCM decode", bench_adpcm },
+        { "Resample", bench_resample },
+        { "Envelope mixer", bench_env_mixer },
+        { "Mix", bench_mix },
+        { "Interleave", bench_interleave },
+    };
+    static uint8_t expected[sizeof(bench.out) + sizeof(bench.mix)];
+
+#ifdef MIXER_SIMD_AVX2
+    bench_avx2 = mixer_cpu_has_avx2();
+#endif
+
+    for (int i = 0; i < MIXER_BENCHMARK_KERNELS; i++) {
+        results[i].name = kernels[i].name;
+#if defined(MIXER_SIMD_AVX2)
+        results[i].simd_name = kernels[i].kernel == bench_mix && bench_avx2 ? "AVX2" : "SSE2";
+#elif defined(MIXER_SIMD_NEON)
+        results[i].simd_name = "NEON";
+#else
+        results[i].simd_name = NULL;
+#endif
+
+        bench_reset();
+        kernels[i].kernel(false);
+        memcpy(expected, bench.out, sizeof(bench.out));
+        memcpy(expected + sizeof(bench.out), bench.mix, sizeof(bench.mix));
+        results[i].scalar_samples_per_second = bench_run(kernels[i].kernel, false);
+
+#ifdef MIXER_SIMD
+        bench_reset();
+        kernels[i].kernel(true);
+        results[i].bit_exact = memcmp(expected, bench.out, sizeof(bench.out)) == 0 &&
+                               memcmp(expected + sizeof(bench.out), bench.mix, sizeof(bench.mix)) == 0;
+        results[i].simd_samples_per_second = bench_run(kernels[i].kernel, true);
+#else
+        results[i].bit_exact = true;
+        results[i].simd_samples_per_second = 0;
+#endif
+    }
+}
+
+static const char *const command_names[MIXER_CMD_COUNT] = {
+    "ClearBuffer", "LoadBuffer", "SaveBuffer", "LoadADPCM", "SetBuffer", "Interleave", "DMEMMove", "SetLoop",
+    "ADPCMdec",    "Resample",   "EnvSetup1",  "EnvSetup2", "EnvMixer",  "Mix",        "S8Dec",    "AddMixer",
+    "Duplicate",   "ResampleZoh", "Interl",    "Filter",    "HiLoGain",  "UnkCmd3",    "UnkCmd19",
+};
+
+uint64_t (*aProfileClock)(void);
+uint64_t aProfileStart;
+
+void aSetProfilingClock(uint64_t (*clock)(void)) {
+    aProfileClock = clock;
+}
+
+const char *aGetCommandName(MixerCommand cmd) {
+    return command_names[cmd];
+}
+
+void aGetCommandStats(MixerCommandStats stats[MIXER_CMD_COUNT]) {
+    memcpy(stats, command_stats, sizeof(command_stats));
+}
+
+void aResetCommandStats(void) {
+    memset(command_stats, 0, sizeof(command_stats));
+}
+
+void aProfileCommand(MixerCommand cmd) {
+    command_stats[cmd].calls++;
+    command_stats[cmd].nanoseconds += aProfileClock() - aProfileStart;
+}
+
+void aSetKernelCheck(bool enabled) {
+#ifdef MIXER_SIMD
+    kernel_check.enabled = enabled;
+#endif
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "abi.h"
 
@@ -60,33 +61,104 @@ void aHiLoGainImpl(uint8_t g, uint16_t count, uint16_t addr);
 void aUnkCmd3Impl(uint16_t a, uint16_t b, uint16_t c);
 void aUnkCmd19Impl(uint8_t f, uint16_t count, uint16_t out_addr, uint16_t in_addr);
 
+// Decodes whole ADPCM frames outside of any command list, with the same results as aADPCMdec. out has to be preceded by
+// the 16 samples of history the first frame predicts from. book_bytes is sized like the count given to aLoadADPCM.
+// Thread safe, it only touches its arguments.
+void aDecodeADPCM(const uint8_t *in, int16_t *out, int frames, bool two_bit, const int16_t *book, int book_bytes);
+
+#define MIXER_BENCHMARK_KERNELS 5
+
+typedef struct {
+    const char *name;
+    double scalar_samples_per_second;
+    double simd_samples_per_second; // 0 without SSE2 or NEON
+    const char *simd_name; // Widest instruction set the SIMD kernel uses on this CPU, NULL without one
+    bool bit_exact; // SIMD output matched the scalar one
+} MixerBenchmarkResult;
+
+// Times every vectorized kernel against its scalar version on private buffers, so it can run while audio plays.
+void aBenchmarkKernels(MixerBenchmarkResult results[MIXER_BENCHMARK_KERNELS]);
+
+typedef enum {
+    MIXER_CMD_CLEAR_BUFFER,
+    MIXER_CMD_LOAD_BUFFER,
+    MIXER_CMD_SAVE_BUFFER,
+    MIXER_CMD_LOAD_ADPCM,
+    MIXER_CMD_SET_BUFFER,
+    MIXER_CMD_INTERLEAVE,
+    MIXER_CMD_DMEM_MOVE,
+    MIXER_CMD_SET_LOOP,
+    MIXER_CMD_ADPCM_DEC,
+    MIXER_CMD_RESAMPLE,
+    MIXER_CMD_ENV_SETUP1,
+    MIXER_CMD_ENV_SETUP2,
+    MIXER_CMD_ENV_MIXER,
+    MIXER_CMD_MIX,
+    MIXER_CMD_S8_DEC,
+    MIXER_CMD_ADD_MIXER,
+    MIXER_CMD_DUPLICATE,
+    MIXER_CMD_RESAMPLE_ZOH,
+    MIXER_CMD_INTERL,
+    MIXER_CMD_FILTER,
+    MIXER_CMD_HI_LO_GAIN,
+    MIXER_CMD_UNK_CMD3,
+    MIXER_CMD_UNK_CMD19,
+    MIXER_CMD_COUNT
+} MixerCommand;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t nanoseconds;
+    uint64_t checked; // Calls run with both scalar and vector kernels, see aSetKernelCheck
+    uint64_t mismatched; // Checked calls whose vector output differed from the scalar one
+} MixerCommandStats;
+
+// Times every command issued through the macros below with a clock returning nanoseconds. NULL turns it off again,
+// which leaves a single pointer test per command.
+void aSetProfilingClock(uint64_t (*clock)(void));
+const char *aGetCommandName(MixerCommand cmd);
+void aGetCommandStats(MixerCommandStats stats[MIXER_CMD_COUNT]);
+void aResetCommandStats(void);
+
+// Runs every command that has vector kernels twice from the same input, first with the scalar kernels and then with
+// the vector ones, and counts in the command stats how often the results differ. It copies the whole DMEM buffer a few
+// times per command, so it is meant for offline renders. Only call it while no command list is being processed.
+void aSetKernelCheck(bool enabled);
+
+extern uint64_t (*aProfileClock)(void);
+extern uint64_t aProfileStart;
+void aProfileCommand(MixerCommand cmd);
+
+#define MIXER_PROFILE(cmd, call) \
+    (aProfileClock == NULL ? (void)(call) : (void)(aProfileStart = aProfileClock(), (call), aProfileCommand(cmd)))
+
 #define aSegment(pkt, s, b) do { } while(0)
-#define aClearBuffer(pkt, d, c) aClearBufferImpl(d, c)
-#define aLoadBuffer(pkt, s, d, c) aLoadBufferImpl(s, d, c)
-#define aSaveBuffer(pkt, s, d, c) aSaveBufferImpl(s, d, c)
-#define aLoadADPCM(pkt, c, d) aLoadADPCMImpl(c, d)
-#define aSetBuffer(pkt, f, i, o, c) aSetBufferImpl(f, i, o, c)
-#define aInterleave(pkt, o, l, r, c) aInterleaveImpl(o, l, r, c)
-#define aDMEMMove(pkt, i, o, c) aDMEMMoveImpl(i, o, c)
-#define aSetLoop(pkt, a) aSetLoopImpl(a)
-#define aADPCMdec(pkt, f, s) aADPCMdecImpl(f, s)
-#define aResample(pkt, f, p, s) aResampleImpl(f, p, s)
+#define aClearBuffer(pkt, d, c) MIXER_PROFILE(MIXER_CMD_CLEAR_BUFFER, aClearBufferImpl(d, c))
+#define aLoadBuffer(pkt, s, d, c) MIXER_PROFILE(MIXER_CMD_LOAD_BUFFER, aLoadBufferImpl(s, d, c))
+#define aSaveBuffer(pkt, s, d, c) MIXER_PROFILE(MIXER_CMD_SAVE_BUFFER, aSaveBufferImpl(s, d, c))
+#define aLoadADPCM(pkt, c, d) MIXER_PROFILE(MIXER_CMD_LOAD_ADPCM, aLoadADPCMImpl(c, d))
+#define aSetBuffer(pkt, f, i, o, c) MIXER_PROFILE(MIXER_CMD_SET_BUFFER, aSetBufferImpl(f, i, o, c))
+#define aInterleave(pkt, o, l, r, c) MIXER_PROFILE(MIXER_CMD_INTERLEAVE, aInterleaveImpl(o, l, r, c))
+#define aDMEMMove(pkt, i, o, c) MIXER_PROFILE(MIXER_CMD_DMEM_MOVE, aDMEMMoveImpl(i, o, c))
+#define aSetLoop(pkt, a) MIXER_PROFILE(MIXER_CMD_SET_LOOP, aSetLoopImpl(a))
+#define aADPCMdec(pkt, f, s) MIXER_PROFILE(MIXER_CMD_ADPCM_DEC, aADPCMdecImpl(f, s))
+#define aResample(pkt, f, p, s) MIXER_PROFILE(MIXER_CMD_RESAMPLE, aResampleImpl(f, p, s))
 #define aEnvSetup1(pkt, initialVolReverb, rampReverb, rampLeft, rampRight) \
-    aEnvSetup1Impl(initialVolReverb, rampReverb, rampLeft, rampRight)
+    MIXER_PROFILE(MIXER_CMD_ENV_SETUP1, aEnvSetup1Impl(initialVolReverb, rampReverb, rampLeft, rampRight))
 #define aEnvSetup2(pkt, initialVolLeft, initialVolRight) \
-    aEnvSetup2Impl(initialVolLeft, initialVolRight)
+    MIXER_PROFILE(MIXER_CMD_ENV_SETUP2, aEnvSetup2Impl(initialVolLeft, initialVolRight))
 #define aEnvMixer(pkt, inBuf, nSamples, swapReverb, negLeft, negRight,  \
                   dryLeft, dryRight, wetLeft, wetRight) \
-    aEnvMixerImpl(inBuf, nSamples, swapReverb, negLeft, negRight, \
-                  dryLeft, dryRight, wetLeft, wetRight)
-#define aMix(pkt, c, g, i, o) aMixImpl(c, g, i, o)
-#define aS8Dec(pkt, f, s) aS8DecImpl(f, s)
-#define aAddMixer(pkt, s, d, c) aAddMixerImpl(s, d, c)
-#define aDuplicate(pkt, s, d, c) aDuplicateImpl(s, d, c)
+    MIXER_PROFILE(MIXER_CMD_ENV_MIXER, aEnvMixerImpl(inBuf, nSamples, swapReverb, negLeft, negRight, \
+                  dryLeft, dryRight, wetLeft, wetRight))
+#define aMix(pkt, c, g, i, o) MIXER_PROFILE(MIXER_CMD_MIX, aMixImpl(c, g, i, o))
+#define aS8Dec(pkt, f, s) MIXER_PROFILE(MIXER_CMD_S8_DEC, aS8DecImpl(f, s))
+#define aAddMixer(pkt, s, d, c) MIXER_PROFILE(MIXER_CMD_ADD_MIXER, aAddMixerImpl(s, d, c))
+#define aDuplicate(pkt, s, d, c) MIXER_PROFILE(MIXER_CMD_DUPLICATE, aDuplicateImpl(s, d, c))
 #define aDMEMMove2(pkt, t, i, o, c) aDMEMMove2Impl(t, i, o, c)
-#define aResampleZoh(pkt, pitch, startFract) aResampleZohImpl(pitch, startFract)
-#define aInterl(pkt, dmemi, dmemo, count) aInterlImpl(dmemi, dmemo, count)
-#define aFilter(pkt, f, countOrBuf, addr) aFilterImpl(f, countOrBuf, addr)
-#define aHiLoGain(pkt, g, buflen, i, a4) aHiLoGainImpl(g, buflen, i)
-#define aUnkCmd3(pkt, a1, a2, a3) aUnkCmd3Impl(a1, a2, a3)
-#define aUnkCmd19(pkt, a1, a2, a3, a4) aUnkCmd19Impl(a1, a2, a3, a4)
+#define aResampleZoh(pkt, pitch, startFract) MIXER_PROFILE(MIXER_CMD_RESAMPLE_ZOH, aResampleZohImpl(pitch, startFract))
+#define aInterl(pkt, dmemi, dmemo, count) MIXER_PROFILE(MIXER_CMD_INTERL, aInterlImpl(dmemi, dmemo, count))
+#define aFilter(pkt, f, countOrBuf, addr) MIXER_PROFILE(MIXER_CMD_FILTER, aFilterImpl(f, countOrBuf, addr))
+#define aHiLoGain(pkt, g, buflen, i, a4) MIXER_PROFILE(MIXER_CMD_HI_LO_GAIN, aHiLoGainImpl(g, buflen, i))
+#define aUnkCmd3(pkt, a1, a2, a3) MIXER_PROFILE(MIXER_CMD_UNK_CMD3, aUnkCmd3Impl(a1, a2, a3))
+#define aUnkCmd19(pkt, a1, a2, a3, a4) MIXER_PROFILE(MIXER_CMD_UNK_CMD19, aUnkCmd19Impl(a1, a2, a3, a4))
@@ -49,7 +49,8 @@ typedef enum {
     /* 2 */ CODEC_S16_INMEMORY,
     /* 3 */ CODEC_SMALL_ADPCM,
     /* 4 */ CODEC_REVERB,
-    /* 5 */ CODEC_S16
+    /* 5 */ CODEC_S16,
+    /* 6 */ CODEC_S16_STREAM // PC port: long custom samples, decoded as they play. sampleAddr is the stream source
 } SampleCodec;
 
 typedef enum {
@@ -144,6 +145,8 @@ typedef struct
     /* 0x0C */ AdpcmBook* book;
     u32 sampleRateMagicValue; // For wav samples only...
     s32 sampleRate;           // For wav samples only...
+    s16* decodedSamples;      // PC port: ADPCM decoded at load, NULL unless samples are predecoded
+    s16* decodedLoopSamples;  // PC port: from loop->start on once the sample looped, NULL if decodedSamples are the same
 } SoundFontSample; // size = 0x10
 
 typedef struct {
@@ -476,6 +479,7 @@ typedef struct {
     /* 0x16 */ u16 unk_16;
     /* 0x18 */ u16 unk_18;
     /* 0x1A */ u8 unk_1A;
+    /* 0x1B */ u8 looped; // PC port: for decodedLoopSamples
     /* 0x1C */ u16 unk_1C;
     /* 0x1E */ u16 unk_1E;
 } NoteSynthesisState; // size = 0x20
@@ -0,0 +1,288 @@
+#include "AudioRender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+#include "soh/OTRGlobals.h"
+#include "soh/OTRAudio.h"
+#include "Window.h"
+#include "AudioPlayer.h"
+
+extern "C" {
+#include <z64.h>
+#include "variables.h"
+#include "functions.h"
+#include "macros.h"
+void AudioMgr_CreateNextAudioBuffer(s16* samples, u32 num_samples);
+}
+
+// Same buffer sizes OTRAudio_Thread alternates between, which average out at the 44.1 kHz output rate.
+#define RENDER_SAMPLE_RATE 44100
+#define RENDER_SAMPLES_HIGH 752
+#define RENDER_SAMPLES_LOW 720
+#define RENDER_UPDATES_PER_SECOND 60
+#define RENDER_CHANNELS 2
+
+struct AudioRenderRequest {
+    std::vector<AudioRenderEvent> events;
+    std::string wavPath;
+    bool checkKernels;
+};
+
+static std::mutex sRequestMutex;
+static std::vector<AudioRenderRequest> sRequests;
+static bool sCheckedConfig;
+
+static uint64_t AudioRender_Clock(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool AudioRender_ParseScript(const std::vector<std::string>& tokens, std::vector<AudioRenderEvent>& events,
+                             std::string& error) {
+    for (size_t i = 0; i < tokens.size(); i += 2) {
+        AudioRenderEvent event;
+
+        if (tokens[i] == "seq") {
+            event.type = AudioRenderEvent::Type::Sequence;
+        } else if (tokens[i] == "sfx") {
+            event.type = AudioRenderEvent::Type::Sfx;
+        } else if (tokens[i] == "wait") {
+            event.type = AudioRenderEvent::Type::Wait;
+        } else {
+            error = "Unknown script command \"" + tokens[i] + "\"";
+            return false;
+        }
+
+        if (i + 1 >= tokens.size()) {
+            error = "Missing value after \"" + tokens[i] + "\"";
+            return false;
+        }
+
+        try {
+            event.value = std::stoul(tokens[i + 1], nullptr, 0);
+        } catch (const std::exception&) {
+            error = "Invalid value \"" + tokens[i + 1] + "\"";
+            return false;
+        }
+
+        events.push_back(event);
+    }
+
+    return true;
+}
+
+AudioRenderResult AudioRender_Run(const std::vector<AudioRenderEvent>& events, bool checkKernels) {
+    AudioRenderResult result = {};
+    result.sampleRate = RENDER_SAMPLE_RATE;
+
+    // Only the script should be heard, the sound effect player is left running for sfx events.
+    for (u32 playerIdx : { 0, 1, 3 }) {
+        Audio_QueueSeqCmd(0x1 << 28 | playerIdx << 24);
+    }
+
+    aResetCommandStats();
+    aSetProfilingClock(AudioRender_Clock);
+    aSetKernelCheck(checkKernels);
+    const u32 startRandom = gAudioContext.audioRandom;
+    gAudioContext.audioRandom = 0;
+
+    for (const AudioRenderEvent& event : events) {
+        switch (event.type) {
+            case AudioRenderEvent::Type::Sequence:
+                Audio_QueueSeqCmd(event.value & 0xFF);
+                break;
+            case AudioRenderEvent::Type::Sfx:
+                Audio_PlaySoundGeneral(event.value, &D_801333D4, 4, &D_801333E0, &D_801333E0, &D_801333E8);
+                break;
+            case AudioRenderEvent::Type::Wait:
+                for (u32 frame = 0; frame < event.value; frame++) {
+                    func_800F3054();
+
+                    for (int i = 0; i < (R_UPDATE_RATE > 0 ? R_UPDATE_RATE : 1); i++) {
+                        const uint64_t expected =
+                            (uint64_t)result.updates * RENDER_SAMPLE_RATE / RENDER_UPDATES_PER_SECOND;
+                        const u32 numSamples = result.samples.size() / RENDER_CHANNELS < expected
+                                                   ? RENDER_SAMPLES_HIGH
+                                                   : RENDER_SAMPLES_LOW;
+                        const size_t offset = result.samples.size();
+                        result.samples.resize(offset + numSamples * RENDER_CHANNELS);
+
+                        const u32 random = gAudioContext.audioRandom;
+                        const uint64_t start = AudioRender_Clock();
+                        AudioMgr_CreateNextAudioBuffer(result.samples.data() + offset, numSamples);
+                        const double seconds = (AudioRender_Clock() - start) / 1e9;
+
+                        // The game seeds this with the time, which would make no two renders alike.
+                        gAudioContext.audioRandom = (random + gAudioContext.totalTaskCnt) * 1664525 + 1013904223;
+
+                        uint32_t activeNotes = 0;
+                        for (s32 j = 0; j < gAudioContext.numNotes; j++) {
+                            activeNotes += gAudioContext.notes[j].noteSubEu.bitField0.enabled;
+                        }
+
+                        result.updates++;
+                        result.synthesisSeconds += seconds;
+                        result.maxUpdateSeconds = std::max(result.maxUpdateSeconds, seconds);
+                        result.activeNotes += activeNotes;
+                        result.maxActiveNotes = std::max(result.maxActiveNotes, activeNotes);
+                    }
+                }
+                break;
+        }
+    }
+
+    aSetProfilingClock(nullptr);
+    aSetKernelCheck(false);
+    aGetCommandStats(result.commands);
+    gAudioContext.audioRandom = startRandom;
+    return result;
+}
+
+static void AudioRender_WriteLE(std::ofstream& file, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put((char)(value >> (i * 8)));
+    }
+}
+
+bool AudioRender_WriteWav(const std::string& path, const AudioRenderResult& result) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    const uint32_t dataSize = result.samples.size() * sizeof(int16_t);
+
+    file.write("RIFF", 4);
+    AudioRender_WriteLE(file, 36 + dataSize, 4);
+    file.write("WAVEfmt ", 8);
+    AudioRender_WriteLE(file, 16, 4);
+    AudioRender_WriteLE(file, 1, 2); // PCM
+    AudioRender_WriteLE(file, RENDER_CHANNELS, 2);
+    AudioRender_WriteLE(file, result.sampleRate, 4);
+    AudioRender_WriteLE(file, result.sampleRate * RENDER_CHANNELS * sizeof(int16_t), 4);
+    AudioRender_WriteLE(file, RENDER_CHANNELS * sizeof(int16_t), 2);
+    AudioRender_WriteLE(file, 16, 2);
+    file.write("data", 4);
+    AudioRender_WriteLE(file, dataSize, 4);
+
+    for (int16_t sample : result.samples) {
+        AudioRender_WriteLE(file, (uint16_t)sample, 2);
+    }
+
+    return file.good();
+}
+
+static void AudioRender_Report(const AudioRenderResult& result) {
+    const double audioSeconds = (double)result.samples.size() / RENDER_CHANNELS / result.sampleRate;
+    const double updates = result.updates != 0 ? result.updates : 1;
+
+    SPDLOG_INFO("Audio render: {} updates, {:.2f} s of audio synthesized in {:.1f} ms ({:.1f}x real time)",
+                result.updates, audioSeconds, result.synthesisSeconds * 1000.0,
+                result.synthesisSeconds > 0 ? audioSeconds / result.synthesisSeconds : 0.0);
+    SPDLOG_INFO("Audio render: {:.3f} ms per update on average, {:.3f} ms at most", result.synthesisSeconds * 1000.0 / updates,
+                result.maxUpdateSeconds * 1000.0);
+    SPDLOG_INFO("Audio render: {:.1f} active notes per update on average, {} at most", result.activeNotes / updates,
+                result.maxActiveNotes);
+
+    std::vector<int> order;
+    for (int i = 0; i < MIXER_CMD_COUNT; i++) {
+        if (result.commands[i].calls != 0) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return result.commands[a].nanoseconds > result.commands[b].nanoseconds; });
+
+    for (int i : order) {
+        const MixerCommandStats& stats = result.commands[i];
+        SPDLOG_INFO("Audio render: {:<12} {:>8} calls {:>9.3f} ms ({:.1f}% of synthesis)",
+                    aGetCommandName((MixerCommand)i), stats.calls, stats.nanoseconds / 1e6,
+                    result.synthesisSeconds > 0 ? stats.nanoseconds / 1e7 / result.synthesisSeconds : 0.0);
+    }
+
+    for (int i : order) {
+        const MixerCommandStats& stats = result.commands[i];
+        if (stats.checked == 0) {
+            continue;
+        }
+        if (stats.mismatched == 0) {
+            SPDLOG_INFO("Audio render: {:<12} SIMD output matched the scalar one in all {} calls",
+                        aGetCommandName((MixerCommand)i), stats.checked);
+        } else {
+            SPDLOG_ERROR("Audio render: {:<12} SIMD output differed from the scalar one in {} of {} calls",
+                         aGetCommandName((MixerCommand)i), stats.mismatched, stats.checked);
+        }
+    }
+}
+
+bool AudioRender_IsHeadless(void) {
+    return std::dynamic_pointer_cast<Ship::NullAudioPlayer>(OTRGlobals::Instance->context->GetWindow()->GetAudioPlayer()) !=
+           nullptr;
+}
+
+bool AudioRender_Queue(const std::vector<AudioRenderEvent>& events, const std::string& wavPath, bool checkKernels) {
+    if (!AudioRender_IsHeadless()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(sRequestMutex);
+    sRequests.push_back({ events, wavPath, checkKernels });
+    return true;
+}
+
+extern "C" void AudioRender_ProcessRequests(void) {
+    // Headless runs pass their script through the config, it is rendered once the game has run its first frame.
+    if (!sCheckedConfig) {
+        sCheckedConfig = true;
+
+        auto conf = OTRGlobals::Instance->context->GetConfig();
+        const std::string script = conf->getString("Game.Audio Render Script");
+
+        if (!script.empty()) {
+            std::vector<std::string> tokens;
+            std::istringstream stream(script);
+            std::vector<AudioRenderEvent> events;
+            std::string error;
+
+            for (std::string token; stream >> token;) {
+                tokens.push_back(token);
+            }
+
+            if (!AudioRender_ParseScript(tokens, events, error)) {
+                SPDLOG_ERROR("Audio render script: {}", error);
+            } else if (!AudioRender_Queue(events, conf->getString("Game.Audio Render Output"),
+                                          conf->getBool("Game.Audio Render Check Kernels", false))) {
+                SPDLOG_ERROR("Audio render script: only runs with Window.AudioBackend set to \"null\"");
+            }
+        }
+    }
+
+    std::vector<AudioRenderRequest> requests;
+    {
+        std::lock_guard<std::mutex> lock(sRequestMutex);
+        requests.swap(sRequests);
+    }
+
+    for (const AudioRenderRequest& request : requests) {
+        AudioRenderResult result;
+        {
+            // Keeps the audio thread from synthesizing on the same state while the render runs.
+            std::lock_guard<std::recursive_mutex> lock(audio.mutex);
+            result = AudioRender_Run(request.events, request.checkKernels);
+        }
+        AudioRender_Report(result);
+
+        if (!request.wavPath.empty()) {
+            if (AudioRender_WriteWav(request.wavPath, result)) {
+                SPDLOG_INFO("Audio render: wrote {}", request.wavPath);
+            } else {
+                SPDLOG_ERROR("Audio render: could not write {}", request.wavPath);
+            }
+        }
+    }
+}
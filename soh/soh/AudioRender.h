@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "mixer.h"
+}
+
+// One step of an offline render script. Scripts are written as "seq <id>", "sfx <id>" and "wait <frames>" with
+// frames counted in game frames, for example "seq 0x02 wait 200 sfx 0x4802 wait 40".
+struct AudioRenderEvent {
+    enum class Type {
+        Sequence,
+        Sfx,
+        Wait,
+    };
+
+    Type type;
+    uint32_t value;
+};
+
+struct AudioRenderResult {
+    std::vector<int16_t> samples; // Interleaved stereo
+    uint32_t sampleRate;
+    uint32_t updates;
+    double synthesisSeconds;
+    double maxUpdateSeconds;
+    uint64_t activeNotes; // Summed over all updates
+    uint32_t maxActiveNotes;
+    MixerCommandStats commands[MIXER_CMD_COUNT];
+};
+
+// Returns false and describes the problem in error if a token can not be parsed.
+bool AudioRender_ParseScript(const std::vector<std::string>& tokens, std::vector<AudioRenderEvent>& events,
+                             std::string& error);
+
+// Plays the script faster than real time into memory. Only call this from the game thread while holding audio.mutex,
+// so the audio thread is paused. Sequences the game was playing are stopped first, and the audio state is left as the
+// script left it. Sequence players, sound effect queues and the game side audio update are all changed, too much of it
+// in statics across the audio code to put back, so renders only run headless. checkKernels compares the mixer's vector
+// kernels against the scalar ones on every command, see aSetKernelCheck.
+AudioRenderResult AudioRender_Run(const std::vector<AudioRenderEvent>& events, bool checkKernels);
+bool AudioRender_WriteWav(const std::string& path, const AudioRenderResult& result);
+
+// True when audio plays through the null backend, so nobody hears what a render does to the game's audio.
+bool AudioRender_IsHeadless(void);
+
+// Renders the script at the end of the current frame, logs the costs and writes a WAV file unless wavPath is empty.
+// Returns false without queueing anything unless the game runs headless. Thread safe.
+bool AudioRender_Queue(const std::vector<AudioRenderEvent>& events, const std::string& wavPath, bool checkKernels);
+
+// Called by the game thread once a frame is done.
+extern "C" void AudioRender_ProcessRequests(void);
@@ -0,0 +1,165 @@
+#include "AudioStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Lib/dr_libs/mp3.h"
+#include "Lib/dr_libs/wav.h"
+
+// Values kept decoded per note. Enough for a couple of updates at the highest pitch.
+#define AUDIO_STREAM_WINDOW 8192
+
+struct AudioStreamSource {
+    std::shared_ptr<Ship::File> file;
+    bool isMp3;
+    uint32_t channels;
+    uint64_t length; // Interleaved values, which is what sample positions count
+};
+
+struct AudioStreamNote {
+    const AudioStreamSource* source = nullptr;
+    std::unique_ptr<drwav> wav;
+    std::unique_ptr<drmp3> mp3;
+    std::vector<s16> window;
+    uint64_t start = 0; // Position of window[0]
+    size_t count = 0;   // Values decoded into the window
+};
+
+static std::vector<AudioStreamNote> sNotes;
+
+SoundFontSample* AudioStream_CreateSample(std::shared_ptr<Ship::File> file, const std::string& ext) {
+    auto source = new AudioStreamSource;
+    source->file = file;
+    source->isMp3 = ext == "mp3";
+
+    uint64_t frames;
+    uint32_t sampleRate;
+
+    // Only the header is read here. For MP3 the frame count comes from the frame headers, nothing is decoded.
+    if (source->isMp3) {
+        auto mp3 = std::make_unique<drmp3>();
+        if (!drmp3_init_memory(mp3.get(), file->buffer.get(), file->dwBufferSize, nullptr)) {
+            delete source;
+            return nullptr;
+        }
+
+        frames = drmp3_get_pcm_frame_count(mp3.get());
+        source->channels = mp3->channels;
+        sampleRate = mp3->sampleRate;
+        drmp3_uninit(mp3.get());
+    } else {
+        drwav wav;
+        if (!drwav_init_memory(&wav, file->buffer.get(), file->dwBufferSize, nullptr)) {
+            delete source;
+            return nullptr;
+        }
+
+        frames = wav.totalPCMFrameCount;
+        source->channels = wav.channels;
+        sampleRate = wav.sampleRate;
+        drwav_uninit(&wav);
+    }
+
+    source->length = frames * source->channels;
+    if (source->length * sizeof(s16) <= AUDIO_STREAM_MIN_BYTES) {
+        delete source;
+        return nullptr;
+    }
+
+    SoundFontSample* sample = new SoundFontSample();
+    sample->codec = CODEC_S16_STREAM;
+    sample->sampleAddr = (u8*)source;
+    sample->size = source->isMp3 ? source->length * sizeof(short) : frames;
+
+    sample->loop = new AdpcmLoop();
+    sample->loop->start = 0;
+    sample->loop->end = source->isMp3 ? sample->size : sample->size - 1;
+    sample->loop->count = 0;
+    sample->sampleRateMagicValue = 'RIFF';
+    sample->sampleRate = sampleRate;
+
+    return sample;
+}
+
+static void AudioStream_Open(AudioStreamNote& note, const AudioStreamSource* source) {
+    const Ship::File* file = source->file.get();
+
+    if (note.wav != nullptr) {
+        drwav_uninit(note.wav.get());
+        note.wav = nullptr;
+    }
+    if (note.mp3 != nullptr) {
+        drmp3_uninit(note.mp3.get());
+        note.mp3 = nullptr;
+    }
+
+    // Both already opened the file once when the sample was created.
+    if (source->isMp3) {
+        note.mp3 = std::make_unique<drmp3>();
+        drmp3_init_memory(note.mp3.get(), file->buffer.get(), file->dwBufferSize, nullptr);
+    } else {
+        note.wav = std::make_unique<drwav>();
+        drwav_init_memory(note.wav.get(), file->buffer.get(), file->dwBufferSize, nullptr);
+    }
+
+    note.source = source;
+    note.window.resize(AUDIO_STREAM_WINDOW);
+    note.start = 0;
+    note.count = 0;
+}
+
+extern "C" s16* AudioStream_Read(SoundFontSample* sample, s32 noteIndex, s32 pos, s32 count) {
+    const AudioStreamSource* source = (const AudioStreamSource*)sample->sampleAddr;
+
+    if ((size_t)noteIndex >= sNotes.size()) {
+        sNotes.resize(noteIndex + 1);
+    }
+
+    AudioStreamNote& note = sNotes[noteIndex];
+    if (note.source != source) {
+        AudioStream_Open(note, source);
+    }
+
+    count = std::clamp(count, 0, AUDIO_STREAM_WINDOW / 2);
+    const uint64_t at = std::max(pos, 0);
+
+    // Notes only ever move forward or jump back to the loop start, which is when the decoder has to seek. The window
+    // always starts on a frame so decoding can carry on from where it stopped.
+    if (at < note.start || at > note.start + note.count) {
+        const uint64_t frame = at / source->channels;
+
+        if (source->isMp3) {
+            drmp3_seek_to_pcm_frame(note.mp3.get(), frame);
+        } else {
+            drwav_seek_to_pcm_frame(note.wav.get(), frame);
+        }
+        note.start = frame * source->channels;
+        note.count = 0;
+    }
+
+    if (at + count > note.start + note.count) {
+        // Drop the frames that have been played and refill the rest of the window.
+        const size_t played = (at - note.start) / source->channels * source->channels;
+        memmove(note.window.data(), note.window.data() + played, (note.count - played) * sizeof(s16));
+        note.start += played;
+        note.count -= played;
+
+        const uint64_t frames = (AUDIO_STREAM_WINDOW - note.count) / source->channels;
+        s16* out = note.window.data() + note.count;
+
+        if (source->isMp3) {
+            note.count += drmp3_read_pcm_frames_s16(note.mp3.get(), frames, out) * source->channels;
+        } else {
+            note.count += drwav_read_pcm_frames_s16(note.wav.get(), frames, out) * source->channels;
+        }
+
+        // Past the end of the file.
+        const size_t needed = at - note.start + count;
+        if (note.count < needed) {
+            std::fill(note.window.begin() + note.count, note.window.begin() + needed, 0);
+        }
+    }
+
+    return note.window.data() + (at - note.start);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "File.h"
+
+extern "C" {
+#include <z64.h>
+}
+
+// Custom samples that decode to more PCM than this are decoded a little at a time while they play.
+#define AUDIO_STREAM_MIN_BYTES (1024 * 1024)
+
+// Returns a CODEC_S16_STREAM sample for a long custom WAV or MP3 file, or nullptr if the file is short enough to decode
+// in full or can not be read. Sizes and loop points are set up exactly as for a fully decoded sample. The sample keeps
+// the file alive and is never freed, like every other custom sample.
+SoundFontSample* AudioStream_CreateSample(std::shared_ptr<Ship::File> file, const std::string& ext);
+
+// Returns count samples of a streamed sample starting at pos, decoded into the note's own window. Samples past the end
+// of the file read as silence. The pointer stays valid until the next call for the same note. Audio thread only.
+extern "C" s16* AudioStream_Read(SoundFontSample* sample, s32 noteIndex, s32 pos, s32 count);
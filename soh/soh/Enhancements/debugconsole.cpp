@@ -9,6 +9,8 @@
 #include <vector>
 #include <string>
 #include "soh/OTRGlobals.h"
+#include "soh/AudioRender.h"
+#include "soh/OTRAudio.h"
 
 
 #define Path _Path
@@ -16,6 +18,8 @@
 #include <Utils/StringHelper.h>
 
 #include "Window.h"
+#include "ResourceMgr.h"
+#include "Audio.h"
 #include "Lib/ImGui/imgui_internal.h"
 #undef PATH_HACK
 #undef Path
@@ -25,6 +29,7 @@ extern "C" {
 #include "variables.h"
 #include "functions.h"
 #include "macros.h"
+#include "mixer.h"
 extern GlobalContext* gGlobalCtx;
 }
 
@@ -371,6 +376,203 @@ static bool StateSlotSelectHandler(const std::vector<std::string>& args) {
     return CMD_SUCCESS;
 }
 
+static bool ResourceStatsHandler(const std::vector<std::string>& args) {
+    const auto resMgr = OTRGlobals::Instance->context->GetResourceManager();
+
+    if (args.size() > 1) {
+        int budget;
+
+        try {
+            budget = std::stoi(args[1], nullptr, 10);
+        } catch (std::invalid_argument const& ex) {
+            ERROR("[SOH] Resource memory budget must be a number of megabytes.");
+            return CMD_FAILED;
+        }
+
+        if (budget < 0) {
+            ERROR("[SOH] Invalid budget passed. Use 0 to disable eviction");
+            return CMD_FAILED;
+        }
+
+        resMgr->SetMemoryBudget((size_t)budget * 1024 * 1024);
+    }
+
+    const Ship::ResourceCacheStats stats = resMgr->GetCacheStats();
+
+    INFO("[SOH] Resources: %zu cached, %.2f MB", stats.Entries, stats.Bytes / (1024.0 * 1024.0));
+
+    if (stats.Budget != 0)
+        INFO("[SOH] Budget: %.2f MB", stats.Budget / (1024.0 * 1024.0));
+    else
+        INFO("[SOH] Budget: unlimited");
+
+    INFO("[SOH] Hits: %llu, Misses: %llu, Evictions: %llu", (unsigned long long)stats.Hits,
+         (unsigned long long)stats.Misses, (unsigned long long)stats.Evictions);
+    INFO("[SOH] Loaded from disk cache: %llu", (unsigned long long)stats.DiskCacheHits);
+    return CMD_SUCCESS;
+}
+
+static bool TextureBenchmarkHandler(const std::vector<std::string>& args) {
+    for (const auto& result : gfx_benchmark_texture_import()) {
+        if (result.mismatches == 0) {
+            INFO("[SOH] %s: %.1f MB/s, matches the reference in %u checks", result.format, result.mb_per_second, result.checks);
+        } else {
+            INFO("[SOH] %s: %.1f MB/s (OUTPUT DIFFERS in %u of %u checks)", result.format, result.mb_per_second,
+                 result.mismatches, result.checks);
+        }
+    }
+    return CMD_SUCCESS;
+}
+
+static bool VertexBenchmarkHandler(const std::vector<std::string>& args) {
+    for (const auto& result : gfx_benchmark_vertices()) {
+        std::string line = StringHelper::Sprintf("[SOH] %s: scalar %.1f M vertices/s", result.modes.c_str(),
+                                                 result.scalar_vertices_per_second / 1e6);
+        if (result.batched_vertices_per_second[0] != 0) {
+            line += StringHelper::Sprintf(", 4 wide %.1f", result.batched_vertices_per_second[0] / 1e6);
+        }
+        if (result.batched_vertices_per_second[1] != 0) {
+            line += StringHelper::Sprintf(", 8 wide %.1f", result.batched_vertices_per_second[1] / 1e6);
+        }
+        INFO("%s%s", line.c_str(), result.bit_exact ? "" : " (OUTPUT DIFFERS)");
+    }
+    return CMD_SUCCESS;
+}
+
+static bool DisplayListBenchmarkHandler(const std::vector<std::string>& args) {
+    gfx_request_display_list_benchmark([](const GfxDisplayListBenchmarkResult& result) {
+        INFO("[SOH] Interpreted: %.3f ms per pass, %llu commands, %.1f ns per command", result.interpret_time * 1000.0,
+             (unsigned long long)result.interpreted_commands,
+             result.interpret_time * 1e9 / std::max<uint64_t>(result.interpreted_commands, 1));
+        INFO("[SOH] Replayed: %.3f ms per pass, %llu commands, %.1f ns per command, %.1f ns per interpreted command",
+             result.replay_time * 1000.0, (unsigned long long)result.replayed_commands,
+             result.replay_time * 1e9 / std::max<uint64_t>(result.replayed_commands, 1),
+             result.replay_time * 1e9 / std::max<uint64_t>(result.interpreted_commands, 1));
+        for (const auto& lookup : result.otr_lookups) {
+            INFO("[SOH] %s: %u commands, %.1f ns per lookup by hash, %.1f ns resolved", lookup.opcode, lookup.commands,
+                 lookup.hash_ns, lookup.resolved_ns);
+        }
+    });
+    INFO("[SOH] The next frame is benchmarked before it is drawn");
+    return CMD_SUCCESS;
+}
+
+static bool AudioBenchmarkHandler(const std::vector<std::string>& args) {
+    MixerBenchmarkResult results[MIXER_BENCHMARK_KERNELS];
+    aBenchmarkKernels(results);
+
+    for (const auto& result : results) {
+        if (result.simd_samples_per_second == 0) {
+            INFO("[SOH] %s: %.1f M samples/s", result.name, result.scalar_samples_per_second / 1e6);
+        } else {
+            INFO("[SOH] %s: scalar %.1f M samples/s, %s %.1f M samples/s%s", result.name,
+                 result.scalar_samples_per_second / 1e6, result.simd_name, result.simd_samples_per_second / 1e6,
+                 result.bit_exact ? "" : " (OUTPUT DIFFERS)");
+        }
+    }
+    return CMD_SUCCESS;
+}
+
+static bool AudioRenderHandler(const std::vector<std::string>& args) {
+    if (args.size() < 4) {
+        return CMD_FAILED;
+    }
+
+    std::vector<AudioRenderEvent> events;
+    std::string error;
+    if (!AudioRender_ParseScript(std::vector<std::string>(args.begin() + 2, args.end()), events, error)) {
+        ERROR("[SOH] %s", error.c_str());
+        return CMD_FAILED;
+    }
+
+    if (!AudioRender_Queue(events, args[1] == "-" ? "" : args[1], false)) {
+        ERROR("[SOH] Audio renders leave the game's audio in the state the script left it, they only run with the null audio backend");
+        return CMD_FAILED;
+    }
+
+    INFO("[SOH] Audio render queued, results follow at the end of the frame");
+    return CMD_SUCCESS;
+}
+
+static bool AudioCheckHandler(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        return CMD_FAILED;
+    }
+
+    std::vector<AudioRenderEvent> events;
+    std::string error;
+    if (!AudioRender_ParseScript(std::vector<std::string>(args.begin() + 1, args.end()), events, error)) {
+        ERROR("[SOH] %s", error.c_str());
+        return CMD_FAILED;
+    }
+
+    if (!AudioRender_Queue(events, "", true)) {
+        ERROR("[SOH] Audio renders leave the game's audio in the state the script left it, they only run with the null audio backend");
+        return CMD_FAILED;
+    }
+
+    INFO("[SOH] Audio check queued, results follow at the end of the frame");
+    return CMD_SUCCESS;
+}
+
+static bool AudioStatsHandler(const std::vector<std::string>& args) {
+    const OTRAudioStats stats = OTRAudio_GetStats();
+    const double updates = stats.updates != 0 ? (double)stats.updates : 1.0;
+
+    INFO("[SOH] Audio: %llu updates, %.3f ms synthesizing on average, %.3f ms worst", (unsigned long long)stats.updates,
+         stats.synthesisTime * 1000.0 / updates, stats.maxSynthesisTime * 1000.0);
+    INFO("[SOH] Audio: %llu underruns, latency %.1f ms average, %.1f ms worst", (unsigned long long)stats.underruns,
+         stats.latency * 1000.0, stats.maxLatency * 1000.0);
+    INFO("[SOH] Audio: %.1f MB of predecoded samples", Ship::AudioSample::DecodedBytes / (1024.0 * 1024.0));
+    OTRAudio_ResetStats();
+    return CMD_SUCCESS;
+}
+
+static bool TextureStatsHandler(const std::vector<std::string>& args) {
+    const GfxTextureCacheStats stats = gfx_texture_cache_get_stats();
+
+    INFO("[SOH] Texture cache: %llu hits, %llu misses, %.1f MB uploaded", (unsigned long long)stats.hits,
+         (unsigned long long)stats.misses, stats.upload_bytes / (1024.0 * 1024.0));
+    INFO("[SOH] %zu textures resident (%.1f MB), budget %.1f MB", stats.entries, stats.bytes / (1024.0 * 1024.0),
+         stats.budget / (1024.0 * 1024.0));
+    return CMD_SUCCESS;
+}
+
+static bool ShaderStatsHandler(const std::vector<std::string>& args) {
+    const GfxShaderStats stats = gfx_get_shader_stats();
+
+    INFO("[SOH] %llu shaders created from the shader cache at startup in %.2f s", (unsigned long long)stats.precompiled,
+         stats.precompile_time);
+    INFO("[SOH] %llu shaders compiled during gameplay in %.2f s", (unsigned long long)stats.compiled, stats.compile_time);
+    return CMD_SUCCESS;
+}
+
+static bool DrawStatsHandler(const std::vector<std::string>& args) {
+    const GfxDrawStats stats = gfx_get_draw_stats();
+    const double frames = stats.frames != 0 ? (double)stats.frames : 1.0;
+
+    INFO("[SOH] Per frame over %llu frames: %.1f triangles, %.1f batches, %.1f draw calls, %.1f state switches",
+         (unsigned long long)stats.frames, stats.triangles / frames, stats.batches / frames, stats.draw_calls / frames,
+         stats.state_switches / frames);
+    gfx_reset_draw_stats();
+    return CMD_SUCCESS;
+}
+
+static bool FrameStatsHandler(const std::vector<std::string>& args) {
+    const auto window = OTRGlobals::Instance->context->GetWindow();
+    const Ship::FramePipelineStats stats = window->GetFramePipelineStats();
+    const double frames = stats.Frames != 0 ? (double)stats.Frames : 1.0;
+
+    INFO("[SOH] %s rendering over %llu frames", window->IsRenderingPipelined() ? "Pipelined" : "Inline", (unsigned long long)stats.Frames);
+    INFO("[SOH] Game thread: %.3f ms simulating, %.3f ms waiting for the renderer", stats.GameTime * 1000.0 / frames,
+         stats.GameWaitTime * 1000.0 / frames);
+    INFO("[SOH] Render thread: %.3f ms drawing, %.3f ms waiting for the game", stats.RenderTime * 1000.0 / frames,
+         stats.RenderWaitTime * 1000.0 / frames);
+    INFO("[SOH] Latency: %.3f ms average, %.3f ms worst", stats.Latency * 1000.0 / frames, stats.MaxLatency * 1000.0);
+    window->ResetFramePipelineStats();
+    return CMD_SUCCESS;
+}
+
 #define VARTYPE_INTEGER 0
 #define VARTYPE_FLOAT   1
 #define VARTYPE_STRING  2
@@ -436,18 +638,18 @@ static bool GetCVarHandler(const std::vector<std::string>& args) {
     if (args.size() < 2)
         return CMD_FAILED;
 
-    CVar* cvar = CVar_Get(args[1].c_str());
+    CVar cvar;
 
-    if (cvar != nullptr)
+    if (CVar_GetCopy(args[1].c_str(), &cvar))
     {
-        if (cvar->type == CVarType::S32)
-            INFO("[SOH] Variable %s is %i", args[1].c_str(), cvar->value.valueS32);
-        else if (cvar->type == CVarType::Float)
-            INFO("[SOH] Variable %s is %f", args[1].c_str(), cvar->value.valueFloat);
-        else if (cvar->type == CVarType::String)
-            INFO("[SOH] Variable %s is %s", args[1].c_str(), cvar->value.valueStr);
-        else if (cvar->type == CVarType::RGBA)
-            INFO("[SOH] Variable %s is %08X", args[1].c_str(), cvar->value.valueRGBA);
+        if (cvar.type == CVarType::S32)
+            INFO("[SOH] Variable %s is %i", args[1].c_str(), cvar.value.valueS32);
+        else if (cvar.type == CVarType::Float)
+            INFO("[SOH] Variable %s is %f", args[1].c_str(), cvar.value.valueFloat);
+        else if (cvar.type == CVarType::String)
+            INFO("[SOH] Variable %s is %s", args[1].c_str(), cvar.value.valueStr);
+        else if (cvar.type == CVarType::RGBA)
+            INFO("[SOH] Variable %s is %08X", args[1].c_str(), cvar.value.valueRGBA);
     }
     else
     {
@@ -506,5 +708,20 @@ void DebugConsole_Init(void) {
                                    Ship::ArgumentType::NUMBER,
                                }
         } });
+    CMD_REGISTER("resource_stats", { ResourceStatsHandler, "Prints resource cache statistics, optionally setting its memory budget.",
+                                     { { "budget (MB)", Ship::ArgumentType::NUMBER, true } } });
+    CMD_REGISTER("texture_benchmark", { TextureBenchmarkHandler, "Checks every texture format converter against the per texel one and prints their throughput." });
+    CMD_REGISTER("dl_benchmark", { DisplayListBenchmarkHandler, "Times the next frame's display list interpreted and replayed, and the lookups of its OTR commands." });
+    CMD_REGISTER("vertex_benchmark", { VertexBenchmarkHandler, "Checks the batched vertex paths against the scalar one and prints their throughput." });
+    CMD_REGISTER("audio_benchmark", { AudioBenchmarkHandler, "Prints the throughput of the audio mixer kernels." });
+    CMD_REGISTER("audio_render", { AudioRenderHandler, "Renders sequences and sound effects offline with the null audio backend, e.g. audio_render out.wav seq 0x02 wait 600.",
+                                   { { "file.wav|-", Ship::ArgumentType::TEXT }, { "script", Ship::ArgumentType::TEXT } } });
+    CMD_REGISTER("audio_check", { AudioCheckHandler, "Renders a script like audio_render does and checks the SIMD mixer kernels against the scalar ones on every command, e.g. audio_check seq 0x02 wait 600.",
+                                  { { "script", Ship::ArgumentType::TEXT } } });
+    CMD_REGISTER("audio_stats", { AudioStatsHandler, "Prints audio synthesis times, underruns and latency since the last call, and the memory held by predecoded samples." });
+    CMD_REGISTER("texture_stats", { TextureStatsHandler, "Prints texture cache hits, misses and memory use." });
+    CMD_REGISTER("shader_stats", { ShaderStatsHandler, "Prints how many shaders were precompiled and how many compiled during gameplay." });
+    CMD_REGISTER("draw_stats", { DrawStatsHandler, "Prints draw calls and render state switches per frame since the last call." });
+    CMD_REGISTER("frame_stats", { FrameStatsHandler, "Prints game and render thread frame times and latency since the last call." });
     CVar_Load();
 }
@@ -10,6 +10,7 @@
 #include <soh/OTRAudio.h>
 
 #include <ImGuiImpl.h>
+#include <Window.h>
 
 #include "z64.h"
 #include "z64save.h"
@@ -832,6 +833,11 @@ unsigned int SaveStateMgr::GetCurrentSlot(void) {
 }
 
 void SaveStateMgr::ProcessSaveStateRequests(void) {
+    // Loading rewrites memory the frame still being drawn may read from.
+    if (!this->requests.empty()) {
+        OTRGlobals::Instance->context->GetWindow()->WaitForRenderer();
+    }
+
     while (!this->requests.empty()) {
         const auto& request = this->requests.front();
         
@@ -886,7 +892,7 @@ SaveStateReturn SaveStateMgr::AddRequest(const SaveStateRequest request) {
 }
 
 void SaveState::Save(void) {
-    std::unique_lock<std::mutex> Lock(audio.mutex);
+    std::unique_lock<std::recursive_mutex> Lock(audio.mutex);
     memcpy(&info->sysHeapCopy, gSystemHeap, SYSTEM_HEAP_SIZE /* sizeof(gSystemHeap) */);
     memcpy(&info->audioHeapCopy, gAudioHeap, AUDIO_HEAP_SIZE /* sizeof(gAudioContext) */);
 
@@ -925,7 +931,7 @@ void SaveState::Save(void) {
 }
 
 void SaveState::Load(void) {
-    std::unique_lock<std::mutex> Lock(audio.mutex);
+    std::unique_lock<std::recursive_mutex> Lock(audio.mutex);
     memcpy(gSystemHeap, &info->sysHeapCopy, SYSTEM_HEAP_SIZE);
     memcpy(gAudioHeap, &info->audioHeapCopy, AUDIO_HEAP_SIZE);
 
@@ -1,9 +1,53 @@
 #pragma once
 
-static struct {
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "SpscRingBuffer.h"
+
+// Audio is synthesized on its own thread, paced by how fast the audio device consumes it rather than by the game
+// frame. Finished samples go through a lock-free ring to a second thread that feeds the AudioPlayer.
+struct OTRAudioContext {
     std::thread thread;
-    std::condition_variable cv_to_thread, cv_from_thread;
-    std::mutex mutex;
-    bool running;
-    bool processing;
-} audio;
+    std::thread outputThread;
+    // Held by the synthesis thread for each update, so an update is never seen half done, as on the N64. The game takes
+    // it through OTRAudio_Lock around its own audio update and wherever else it reads sequence player, channel or note
+    // state. Save states and offline renders hold it to pause synthesis, and call into the game's audio code while they
+    // do, hence recursive.
+    std::recursive_mutex mutex;
+    std::atomic<bool> running;
+    std::atomic<bool> started;
+    // Neither thread polls. The output thread wakes the synthesis thread whenever it takes samples from the ring, and
+    // the synthesis thread wakes the output thread whenever it adds some. Both are also woken to start and stop.
+    std::mutex signalMutex;
+    std::condition_variable synthesisCondition;
+    std::condition_variable outputCondition;
+
+    // Interleaved stereo samples waiting for the device.
+    Ship::SpscRingBuffer<int16_t> samples{ 8192 };
+
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> synthesisTime; // Nanoseconds
+    std::atomic<uint64_t> maxSynthesisTime;
+    std::atomic<uint64_t> underruns;
+    std::atomic<uint64_t> latencySamples; // Summed over every latency measurement
+    std::atomic<uint64_t> latencyMeasurements;
+    std::atomic<uint64_t> maxLatencySamples;
+};
+
+extern OTRAudioContext audio;
+
+struct OTRAudioStats {
+    uint64_t updates;
+    double synthesisTime; // Seconds, over all updates
+    double maxSynthesisTime;
+    uint64_t underruns; // Times the device ran dry with nothing synthesized to give it
+    double latency; // Seconds between synthesis and playback, averaged
+    double maxLatency;
+};
+
+OTRAudioStats OTRAudio_GetStats();
+void OTRAudio_ResetStats();
@@ -2,10 +2,14 @@
 #include "OTRAudio.h"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <locale>
 #include "GlobalCtx2.h"
 #include "ResourceMgr.h"
+#include "Archive.h"
+#include "File.h"
+#include "Factories/ResourceLoader.h"
 #include "DisplayList.h"
 #include "PlayerAnimation.h"
 #include "Skeleton.h"
@@ -17,6 +21,7 @@
 #include <Animation.h>
 #ifdef _WIN32
 #include <Windows.h>
+#include <mmsystem.h>
 #else
 #include <time.h>
 #endif
@@ -29,6 +34,7 @@
 #define DRWAV_IMPLEMENTATION
 #include "Lib/dr_libs/wav.h"
 #include "AudioPlayer.h"
+#include "AudioStream.h"
 #include "Enhancements/cosmetics/CosmeticsEditor.h"
 #include "Enhancements/debugconsole.h"
 #include "Enhancements/debugger/debugger.h"
@@ -85,51 +91,173 @@ extern "C" void ResourceMgr_CacheDirectory(const char* resName);
 extern "C" SequenceData ResourceMgr_LoadSeqByName(const char* path);
 std::unordered_map<std::string, ExtensionEntry> ExtensionCache;
 
+OTRAudioContext audio;
+
+// 528 and 544 relate to 60 fps at 32 kHz 32000/60 = 533.333..
+// in an ideal world, one third of the calls should use num_samples=544 and two thirds num_samples=528
+//#define SAMPLES_HIGH 560
+//#define SAMPLES_LOW 528
+// PAL values
+//#define SAMPLES_HIGH 656
+//#define SAMPLES_LOW 624
+
+// 44KHZ values
+#define SAMPLES_HIGH 752
+#define SAMPLES_LOW 720
+
+#define NUM_AUDIO_CHANNELS 2
+#define AUDIO_SAMPLE_RATE 44100
+#define AUDIO_UPDATES_PER_SECOND 60
+
+// How far synthesis runs ahead of what the device has been given, in samples per channel.
+#define AUDIO_RING_TARGET (SAMPLES_HIGH * 2)
+
+static uint64_t OTRAudio_Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void OTRAudio_Max(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Wakes a thread waiting on condition. Taking signalMutex first means a waiter that has just found nothing to do can
+// not miss the wakeup between checking and going to sleep.
+static void OTRAudio_Signal(std::condition_variable& condition) {
+    {
+        std::lock_guard<std::mutex> Lock(audio.signalMutex);
+    }
+    condition.notify_one();
+}
+
+// Synthesizes whenever the ring runs low. Game side commands come in through the message queues, which never block.
 void OTRAudio_Thread() {
+    s16 audio_buffer[SAMPLES_HIGH * NUM_AUDIO_CHANNELS];
+    uint64_t updates = 0;
+    uint64_t samples_produced = 0;
+
     while (audio.running) {
         {
-            std::unique_lock<std::mutex> Lock(audio.mutex);
-            while (!audio.processing && audio.running) {
-                audio.cv_to_thread.wait(Lock);
-            }
+            std::unique_lock<std::mutex> Lock(audio.signalMutex);
+            audio.synthesisCondition.wait(Lock, []() {
+                return !audio.running ||
+                       (audio.started && audio.samples.Size() < AUDIO_RING_TARGET * NUM_AUDIO_CHANNELS);
+            });
+        }
+        if (!audio.running) {
+            break;
+        }
+
+        // Sequences advance once per update, so updates have to average out at 735 samples to keep them at the 60
+        // updates per second they were written for.
+        u32 num_audio_samples =
+            samples_produced < updates * AUDIO_SAMPLE_RATE / AUDIO_UPDATES_PER_SECOND ? SAMPLES_HIGH : SAMPLES_LOW;
 
+        uint64_t elapsed;
+        {
+            std::unique_lock<std::recursive_mutex> Lock(audio.mutex);
             if (!audio.running) {
                 break;
             }
+
+            const uint64_t start = OTRAudio_Now();
+            AudioMgr_CreateNextAudioBuffer(audio_buffer, num_audio_samples);
+            elapsed = OTRAudio_Now() - start;
         }
-        std::unique_lock<std::mutex> Lock(audio.mutex);
-        //AudioMgr_ThreadEntry(&gAudioMgr);
-        // 528 and 544 relate to 60 fps at 32 kHz 32000/60 = 533.333..
-        // in an ideal world, one third of the calls should use num_samples=544 and two thirds num_samples=528
-        //#define SAMPLES_HIGH 560
-        //#define SAMPLES_LOW 528
-        // PAL values
-        //#define SAMPLES_HIGH 656
-        //#define SAMPLES_LOW 624
-
-        // 44KHZ values
-        #define SAMPLES_HIGH 752
-        #define SAMPLES_LOW 720
-
-        #define AUDIO_FRAMES_PER_UPDATE (R_UPDATE_RATE > 0 ? R_UPDATE_RATE : 1 )
-        #define NUM_AUDIO_CHANNELS 2
-
-        int samples_left = AudioPlayer_Buffered();
-        u32 num_audio_samples = samples_left < AudioPlayer_GetDesiredBuffered() ? SAMPLES_HIGH : SAMPLES_LOW;
-
-        // 3 is the maximum authentic frame divisor.
-        s16 audio_buffer[SAMPLES_HIGH * NUM_AUDIO_CHANNELS * 3];
-        for (int i = 0; i < AUDIO_FRAMES_PER_UPDATE; i++) {
-            AudioMgr_CreateNextAudioBuffer(audio_buffer + i * (num_audio_samples * NUM_AUDIO_CHANNELS), num_audio_samples);
+
+        audio.samples.Write(audio_buffer, num_audio_samples * NUM_AUDIO_CHANNELS);
+        OTRAudio_Signal(audio.outputCondition);
+        updates++;
+        samples_produced += num_audio_samples;
+
+        audio.updates.fetch_add(1, std::memory_order_relaxed);
+        audio.synthesisTime.fetch_add(elapsed, std::memory_order_relaxed);
+        OTRAudio_Max(audio.maxSynthesisTime, elapsed);
+    }
+}
+
+// Hands the device whatever has been synthesized once its buffer drops below the level it wants. The device gives no
+// signal when it drains, so the thread sleeps for as long as the buffered audio lasts.
+static void OTRAudio_OutputThread() {
+    std::vector<s16> audio_buffer(audio.samples.GetCapacity());
+    bool playing = false;
+
+    while (audio.running) {
+        std::unique_lock<std::mutex> Lock(audio.signalMutex);
+        audio.outputCondition.wait(Lock, []() { return !audio.running || audio.started; });
+        Lock.unlock();
+        if (!audio.running) {
+            break;
         }
 
-        AudioPlayer_Play((u8*)audio_buffer, num_audio_samples * (sizeof(int16_t) * NUM_AUDIO_CHANNELS * AUDIO_FRAMES_PER_UPDATE));
+        const int buffered = AudioPlayer_Buffered();
+        const int desired = AudioPlayer_GetDesiredBuffered();
+        const uint64_t latency = buffered + audio.samples.Size() / NUM_AUDIO_CHANNELS;
+        audio.latencySamples.fetch_add(latency, std::memory_order_relaxed);
+        audio.latencyMeasurements.fetch_add(1, std::memory_order_relaxed);
+        OTRAudio_Max(audio.maxLatencySamples, latency);
+
+        // Samples per channel to wait for the device to play before it needs more.
+        int wait = buffered - desired + 1;
+        if (buffered < desired) {
+            const size_t count = audio.samples.Read(audio_buffer.data(), audio_buffer.size());
+
+            if (count != 0) {
+                AudioPlayer_Play((u8*)audio_buffer.data(), count * sizeof(s16));
+                OTRAudio_Signal(audio.synthesisCondition);
+                playing = true;
+                continue;
+            }
 
-        audio.processing = false;
-        audio.cv_from_thread.notify_one();
+            if (buffered == 0 && playing) {
+                audio.underruns.fetch_add(1, std::memory_order_relaxed);
+                playing = false;
+            }
+            // Nothing synthesized yet. Wake up when there is, or when the device runs dry to count the underrun.
+            wait = buffered;
+        }
+
+        const auto timeout = std::chrono::microseconds(std::max(wait, AUDIO_SAMPLE_RATE / 1000) * 1000000LL /
+                                                       AUDIO_SAMPLE_RATE);
+        Lock.lock();
+        audio.outputCondition.wait_for(Lock, timeout, [buffered, desired]() {
+            return !audio.running || (buffered < desired && audio.samples.Size() != 0);
+        });
     }
 }
 
+extern "C" void OTRAudio_Lock(void) {
+    audio.mutex.lock();
+}
+
+extern "C" void OTRAudio_Unlock(void) {
+    audio.mutex.unlock();
+}
+
+OTRAudioStats OTRAudio_GetStats() {
+    const uint64_t measurements = audio.latencyMeasurements;
+    OTRAudioStats stats;
+
+    stats.updates = audio.updates;
+    stats.synthesisTime = audio.synthesisTime / 1e9;
+    stats.maxSynthesisTime = audio.maxSynthesisTime / 1e9;
+    stats.underruns = audio.underruns;
+    stats.latency = measurements != 0 ? (double)audio.latencySamples / measurements / AUDIO_SAMPLE_RATE : 0.0;
+    stats.maxLatency = (double)audio.maxLatencySamples / AUDIO_SAMPLE_RATE;
+    return stats;
+}
+
+void OTRAudio_ResetStats() {
+    audio.updates = 0;
+    audio.synthesisTime = 0;
+    audio.maxSynthesisTime = 0;
+    audio.underruns = 0;
+    audio.latencySamples = 0;
+    audio.latencyMeasurements = 0;
+    audio.maxLatencySamples = 0;
+}
+
 // C->C++ Bridge
 extern "C" void OTRAudio_Init()
 {
@@ -137,21 +265,27 @@ extern "C" void OTRAudio_Init()
     ResourceMgr_CacheDirectory("audio");
 
     if (!audio.running) {
+#ifdef _WIN32
+        // Timed waits round up to the system timer period, about 15.6 ms by default. That is most of the time the
+        // output thread has to top up the device.
+        timeBeginPeriod(1);
+#endif
         audio.running = true;
         audio.thread = std::thread(OTRAudio_Thread);
+        audio.outputThread = std::thread(OTRAudio_OutputThread);
     }
 }
 
 extern "C" void OTRAudio_Exit() {
-    // Tell the audio thread to stop
-    {
-        std::unique_lock<std::mutex> Lock(audio.mutex);
-        audio.running = false;
-    }
-    audio.cv_to_thread.notify_all();
-
-    // Wait until the audio thread quit
+    // Tell the audio threads to stop and wait until they quit
+    audio.running = false;
+    OTRAudio_Signal(audio.synthesisCondition);
+    OTRAudio_Signal(audio.outputCondition);
     audio.thread.join();
+    audio.outputThread.join();
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
 }
 
 extern "C" void OTRExtScanner() {
@@ -167,7 +301,63 @@ extern "C" void OTRExtScanner() {
     }
 }
 
+// Measures cold decode time of the audio and texture trees for a range of resource worker counts.
+// Each run gets a fresh ResourceMgr so nothing is served from a previous run's cache.
+static void OTRResourceLoadBenchmark() {
+    auto context = OTRGlobals::Instance->context;
+
+    for (size_t threadCount : { 1, 2, 4, 8 }) {
+        for (const char* searchMask : { "audio/*", "textures/*" }) {
+            auto resMgr = std::make_shared<Ship::ResourceMgr>(context, context->GetMainPath(), context->GetPatchesPath(), threadCount);
+
+            auto start = std::chrono::steady_clock::now();
+            auto resources = resMgr->CacheDirectory(searchMask);
+            auto end = std::chrono::steady_clock::now();
+            auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+            SPDLOG_INFO("Resource load benchmark: {} resources from {} in {} ms with {} workers", resources->size(), searchMask, diff, threadCount);
+        }
+    }
+}
+
+// Measures decode time alone for every resource in the archive. All files are read into memory up front
+// and parsed on a single thread, so the numbers only reflect the resource factories.
+static void OTRResourceParseBenchmark() {
+    auto archive = OTRGlobals::Instance->context->GetResourceManager()->GetArchive();
+    std::vector<std::shared_ptr<Ship::File>> files;
+    size_t totalBytes = 0;
+
+    for (const auto& path : archive->ListFiles("*")) {
+        auto file = archive->LoadFile(path, false);
+
+        // Every resource starts with an 8 byte endianness and type header.
+        if (!file->bHasLoadError && file->dwBufferSize >= 8) {
+            totalBytes += file->dwBufferSize;
+            files.push_back(file);
+        }
+    }
+
+    size_t parsed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& file : files) {
+        Ship::Resource* res = Ship::ResourceLoader::LoadResource(file);
+
+        if (res != nullptr) {
+            parsed++;
+            delete res;
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    SPDLOG_INFO("Resource parse benchmark: {} of {} files ({} KB) parsed in {} ms", parsed, files.size(), totalBytes / 1024, diff);
+}
+
 extern "C" void InitOTR() {
+    auto initStart = std::chrono::steady_clock::now();
+
 #ifdef __SWITCH__
     Ship::Switch::Init(Ship::PreInitPhase);
 #elif defined(__WIIU__)
@@ -175,6 +365,12 @@ extern "C" void InitOTR() {
 #endif
     OTRGlobals::Instance = new OTRGlobals();
     SaveManager::Instance = new SaveManager();
+
+    if (OTRGlobals::Instance->context->GetConfig()->getBool("Game.Benchmark Resource Loading", false)) {
+        OTRResourceLoadBenchmark();
+        OTRResourceParseBenchmark();
+    }
+
     auto t = OTRGlobals::Instance->context->GetResourceManager()->LoadFile("version");
 
     if (!t->bHasLoadError)
@@ -192,10 +388,15 @@ extern "C" void InitOTR() {
     Rando_Init();
     InitItemTracker();
     OTRExtScanner();
+
+    auto initTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - initStart).count();
+    auto stats = OTRGlobals::Instance->context->GetResourceManager()->GetCacheStats();
+    SPDLOG_INFO("OTR initialized in {} ms, {} resources loaded from the disk cache", initTime, stats.DiskCacheHits);
 }
 
 extern "C" void DeinitOTR() {
     OTRAudio_Exit();
+    OTRGlobals::Instance->context->GetResourceManager()->SaveDiskCache();
 }
 
 #ifdef _WIN32
@@ -299,12 +500,12 @@ extern "C" void Graph_StartFrame() {
 
 // C->C++ Bridge
 extern "C" void Graph_ProcessGfxCommands(Gfx* commands) {
-    {
-        std::unique_lock<std::mutex> Lock(audio.mutex);
-        audio.processing = true;
+    // The audio system is set up by now, synthesis runs on its own from here on.
+    if (!audio.started.exchange(true)) {
+        OTRAudio_Signal(audio.synthesisCondition);
+        OTRAudio_Signal(audio.outputCondition);
     }
 
-    audio.cv_to_thread.notify_one();
     std::vector<std::unordered_map<Mtx*, MtxF>> mtx_replacements;
     int target_fps = CVar_GetS32("gInterpolationFPS", 20);
     static int last_fps;
@@ -345,13 +546,6 @@ extern "C" void Graph_ProcessGfxCommands(Gfx* commands) {
     last_fps = fps;
     last_update_rate = R_UPDATE_RATE;
 
-    {
-        std::unique_lock<std::mutex> Lock(audio.mutex);
-        while (audio.processing) {
-            audio.cv_from_thread.wait(Lock);
-        }
-    }
-
     // OTRTODO: FIGURE OUT END FRAME POINT
    /* if (OTRGlobals::Instance->context->GetWindow()->lastScancode != -1)
         OTRGlobals::Instance->context->GetWindow()->lastScancode = -1;*/
@@ -481,8 +675,10 @@ extern "C" uint32_t ResourceMgr_LoadTexSizeByName(const char* texPath);
 extern "C" char* ResourceMgr_LoadTexOrDListByName(const char* filePath) {
     auto res = OTRGlobals::Instance->context->GetResourceManager()->LoadResource(filePath);
 
-    if (res->resType == Ship::ResourceType::DisplayList)
+    if (res->resType == Ship::ResourceType::DisplayList) {
+        res->isPinned = true;
         return (char*)&((std::static_pointer_cast<Ship::DisplayList>(res))->instructions[0]);
+    }
     else if (res->resType == Ship::ResourceType::Array)
         return (char*)(std::static_pointer_cast<Ship::Array>(res))->vertices.data();
     else
@@ -504,12 +700,16 @@ extern "C" Gfx* ResourceMgr_LoadGfxByName(const char* path)
 {
     auto res = std::static_pointer_cast<Ship::DisplayList>(
         OTRGlobals::Instance->context->GetResourceManager()->LoadResource(path));
+
+    // Game code keeps display list pointers around, e.g. in skeletons, so it must never be evicted.
+    res->isPinned = true;
     return (Gfx*)&res->instructions[0];
 }
 
 extern "C" Gfx* ResourceMgr_PatchGfxByName(const char* path, int size) {
     auto res = std::static_pointer_cast<Ship::DisplayList>(
         OTRGlobals::Instance->context->GetResourceManager()->LoadResource(path));
+    res->isPinned = true;
     res->instructions.resize(res->instructions.size() + size);
     return (Gfx*)&res->instructions[0];
 }
@@ -676,6 +876,15 @@ extern "C" SoundFontSample* ReadCustomSample(const char* path) {
     uint32_t* strem = (uint32_t*)sampleRaw->buffer.get();
     uint8_t* strem2 = (uint8_t*)strem;
 
+    // Long files, music mostly, are decoded a little at a time as they play instead of all at once here.
+    if (entry.ext == "wav" || entry.ext == "mp3") {
+        SoundFontSample* streamed = AudioStream_CreateSample(sampleRaw, entry.ext);
+        if (streamed != nullptr) {
+            cachedCustomSFs[path] = streamed;
+            return streamed;
+        }
+    }
+
     SoundFontSample* sampleC = new SoundFontSample;
 
     if (entry.ext == "wav") {
@@ -694,6 +903,8 @@ extern "C" SoundFontSample* ReadCustomSample(const char* path) {
         sampleC->loop->count = 0;
         sampleC->sampleRateMagicValue = 'RIFF';
         sampleC->sampleRate = sampleRate;
+        sampleC->decodedSamples = nullptr;
+        sampleC->decodedLoopSamples = nullptr;
 
         cachedCustomSFs[path] = sampleC;
         return sampleC;
@@ -713,6 +924,8 @@ extern "C" SoundFontSample* ReadCustomSample(const char* path) {
         sampleC->loop->count = 0;
         sampleC->sampleRateMagicValue = 'RIFF';
         sampleC->sampleRate = mp3Info.sampleRate;
+        sampleC->decodedSamples = nullptr;
+        sampleC->decodedLoopSamples = nullptr;
 
         cachedCustomSFs[path] = sampleC;
         return sampleC;
@@ -757,6 +970,10 @@ extern "C" SoundFontSample* ResourceMgr_LoadAudioSample(const char* path)
         sampleC->unk_bit26 = sample->unk_bit26;
         sampleC->unk_bit25 = sample->unk_bit25;
 
+        // Only filled in with Game.Predecode Audio Samples, the synthesis copies from these instead of decoding.
+        sampleC->decodedSamples = sample->decoded.empty() ? nullptr : sample->decoded.data();
+        sampleC->decodedLoopSamples = sample->decodedLoop.empty() ? nullptr : sample->decodedLoop.data();
+
         sampleC->book = new AdpcmBook[sample->book.books.size() * sizeof(int16_t)];
         sampleC->book->npredictors = sample->book.npredictors;
         sampleC->book->order = sample->book.order;
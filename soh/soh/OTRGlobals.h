@@ -44,6 +44,7 @@ void ResourceMgr_LoadFile(const char* resName);
 char* ResourceMgr_LoadFileFromDisk(const char* filePath);
 char* ResourceMgr_LoadJPEG(char* data, int dataSize);
 char* ResourceMgr_LoadTexByName(const char* texPath);
+char* ResourceMgr_LoadPinnedTexByName(const char* texPath);
 uint16_t ResourceMgr_LoadTexWidthByName(char* texPath);
 uint16_t ResourceMgr_LoadTexHeightByName(char* texPath);
 uint32_t ResourceMgr_LoadTexSizeByName(char* texPath);
@@ -61,6 +62,7 @@ Vtx* ResourceMgr_LoadVtxByName(const char* path);
 SoundFont* ResourceMgr_LoadAudioSoundFont(const char* path);
 SequenceData ResourceMgr_LoadSeqByName(const char* path);
 SoundFontSample* ResourceMgr_LoadAudioSample(const char* path);
+s16* AudioStream_Read(SoundFontSample* sample, s32 noteIndex, s32 pos, s32 count);
 CollisionHeader* ResourceMgr_LoadColByName(const char* path);
 void Ctx_ReadSaveFile(uintptr_t addr, void* dramAddr, size_t size);
 void Ctx_WriteSaveFile(uintptr_t addr, void* dramAddr, size_t size);
@@ -84,6 +86,8 @@ int AudioPlayer_Buffered(void);
 int AudioPlayer_GetDesiredBuffered(void);
 void AudioPlayer_Play(const uint8_t* buf, uint32_t len);
 void AudioMgr_CreateNextAudioBuffer(s16* samples, u32 num_samples);
+void OTRAudio_Lock(void);
+void OTRAudio_Unlock(void);
 int Controller_ShouldRumble(size_t i);
 void Hooks_ExecuteAudioInit();
 void* getN64WeirdFrame(s32 i);
@@ -0,0 +1,46 @@
+#include <atomic>
+
+extern "C" {
+#include "ultra64.h"
+}
+
+// Message queues carry audio commands from the game thread to the audio thread and reset acknowledgements back, each
+// with exactly one sender and one receiver. validCount is the only field both sides touch: the sender owns next, the
+// receiver owns first, and the message itself is published by the release on validCount. Neither side ever blocks,
+// OS_MESG_BLOCK is treated like OS_MESG_NOBLOCK as it always has been on PC.
+
+extern "C" void osCreateMesgQueue(OSMesgQueue* mq, OSMesg* msgBuf, s32 count) {
+    mq->validCount = 0;
+    mq->first = 0;
+    mq->next = 0;
+    mq->msgCount = count;
+    mq->msg = msgBuf;
+}
+
+extern "C" s32 osSendMesg(OSMesgQueue* mq, OSMesg msg, s32 flag) {
+    std::atomic_ref<s32> validCount(mq->validCount);
+
+    if (validCount.load(std::memory_order_acquire) >= mq->msgCount) {
+        return -1;
+    }
+
+    mq->msg[mq->next] = msg;
+    mq->next = (mq->next + 1) % mq->msgCount;
+    validCount.fetch_add(1, std::memory_order_release);
+    return 0;
+}
+
+extern "C" s32 osRecvMesg(OSMesgQueue* mq, OSMesg* msg, s32 flag) {
+    std::atomic_ref<s32> validCount(mq->validCount);
+
+    if (validCount.load(std::memory_order_acquire) == 0) {
+        return -1;
+    }
+
+    if (msg != NULL) {
+        *msg = mq->msg[mq->first];
+    }
+    mq->first = (mq->first + 1) % mq->msgCount;
+    validCount.fetch_sub(1, std::memory_order_release);
+    return 0;
+}
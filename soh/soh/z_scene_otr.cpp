@@ -16,6 +16,57 @@ extern "C" s32 Object_Spawn(ObjectContext* objectCtx, s16 objectId);
 extern "C" RomFile sNaviMsgFiles[];
 s32 OTRScene_ExecuteCommands(GlobalContext* globalCtx, Ship::Scene* scene);
 
+// Queues the display lists of a room's mesh, so entering the room does not have to decode them.
+static void OTRScene_PrefetchRoomMesh(std::shared_ptr<Ship::Resource> res) {
+    if (res == nullptr || res->resType != Ship::ResourceType::Room)
+        return;
+
+    auto resMgr = OTRGlobals::Instance->context->GetResourceManager();
+    auto room = std::static_pointer_cast<Ship::Scene>(res);
+
+    for (auto cmd : room->commands) {
+        if (cmd == nullptr || cmd->cmdID != Ship::SceneCommandID::SetMesh)
+            continue;
+
+        for (const auto& mesh : ((Ship::SetMesh*)cmd)->meshes) {
+            for (const std::string* path : { &mesh.opa, &mesh.xlu, &mesh.imgOpa, &mesh.imgXlu }) {
+                if (*path != "")
+                    resMgr->PrefetchResource(*path);
+            }
+        }
+    }
+}
+
+// Queues the collision of a scene the player may be about to enter.
+static void OTRScene_PrefetchSceneData(std::shared_ptr<Ship::Resource> res) {
+    if (res == nullptr || res->resType != Ship::ResourceType::Room)
+        return;
+
+    auto scene = std::static_pointer_cast<Ship::Scene>(res);
+
+    for (auto cmd : scene->commands) {
+        if (cmd != nullptr && cmd->cmdID == Ship::SceneCommandID::SetCollisionHeader)
+            OTRGlobals::Instance->context->GetResourceManager()->PrefetchResource(((Ship::SetCollisionHeader*)cmd)->filePath);
+    }
+}
+
+// Starts loading every room that a transition actor of the current room leads to.
+static void OTRScene_PrefetchAdjacentRooms(GlobalContext* globalCtx) {
+    auto resMgr = OTRGlobals::Instance->context->GetResourceManager();
+    s8 curRoom = globalCtx->roomCtx.curRoom.num;
+
+    for (int i = 0; i < globalCtx->transiActorCtx.numActors; i++) {
+        TransitionActorEntry* entry = &globalCtx->transiActorCtx.list[i];
+
+        for (int side = 0; side < 2; side++) {
+            s8 nextRoom = entry->sides[side ^ 1].room;
+
+            if (entry->sides[side].room == curRoom && nextRoom != curRoom && nextRoom >= 0 && nextRoom < globalCtx->numRooms)
+                resMgr->PrefetchResource(globalCtx->roomList[nextRoom].fileName, OTRScene_PrefetchRoomMesh);
+        }
+    }
+}
+
 bool func_80098508(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
 {
     Ship::SetStartPositionList* cmdStartPos = (Ship::SetStartPositionList*)cmd;
@@ -307,6 +358,7 @@ bool func_80098958(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
                 if (otrMesh->meshes[i].opa != "")
                 {
                     auto opaFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[i].opa));
+                    opaFile->isPinned = true;
 
                     dlist->opaDL = opaFile.get();
                     dlist->opa = (Gfx*)&dlist->opaDL->instructions[0];
@@ -319,6 +371,7 @@ bool func_80098958(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
                 if (otrMesh->meshes[i].xlu != "")
                 {
                     auto xluFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[i].xlu));
+                    xluFile->isPinned = true;
 
                     dlist->xluDL = xluFile.get();
                     dlist->xlu = (Gfx*)&dlist->xluDL->instructions[0];
@@ -338,12 +391,20 @@ bool func_80098958(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
                 PolygonDlist* pType = (PolygonDlist*)malloc(sizeof(PolygonDlist));
 
                 if (otrMesh->meshes[0].imgOpa != "")
-                    pType->opa = (Gfx*)&std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[0].imgOpa))->instructions[0];
+                {
+                    auto imgOpaFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[0].imgOpa));
+                    imgOpaFile->isPinned = true;
+                    pType->opa = (Gfx*)&imgOpaFile->instructions[0];
+                }
                 else
                     pType->opa = 0;
 
                 if (otrMesh->meshes[0].imgXlu != "")
-                    pType->xlu = (Gfx*)&std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[0].imgXlu))->instructions[0];
+                {
+                    auto imgXluFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[0].imgXlu));
+                    imgXluFile->isPinned = true;
+                    pType->xlu = (Gfx*)&imgXluFile->instructions[0];
+                }
                 else
                     pType->xlu = 0;
 
@@ -404,6 +465,7 @@ bool func_80098958(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
                 if (otrMesh->meshes[i].opa != "")
                 {
                     auto opaFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[i].opa));
+                    opaFile->isPinned = true;
 
                     dlist->opaDL = opaFile.get();
                     dlist->opa = (Gfx*)&dlist->opaDL->instructions[0];
@@ -414,6 +476,7 @@ bool func_80098958(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
                 if (otrMesh->meshes[i].xlu != "")
                 {
                     auto xluFile = std::static_pointer_cast<Ship::DisplayList>(OTRGlobals::Instance->context->GetResourceManager()->LoadResource(otrMesh->meshes[i].xlu));
+                    xluFile->isPinned = true;
 
                     dlist->xluDL = xluFile.get();
                     dlist->xlu = (Gfx*)&dlist->xluDL->instructions[0];
@@ -712,6 +775,25 @@ bool func_800990F0(GlobalContext* globalCtx, Ship::SceneCommand* cmd)
     for (int i = 0; i < cmdExit->exits.size(); i++)
         globalCtx->setupExitList[i] = cmdExit->exits[i];
 
+    // Start loading the scenes the exits lead to while the player is still in this one.
+    for (uint16_t entrance : cmdExit->exits) {
+        if (entrance >= ARRAY_COUNT(gEntranceTable))
+            continue;
+
+        s32 sceneNum = gEntranceTable[entrance].scene;
+
+        if (sceneNum < 0 || sceneNum >= SCENE_ID_MAX || sceneNum == globalCtx->sceneNum)
+            continue;
+
+        const char* sceneName = gSceneTable[sceneNum].sceneFile.fileName;
+
+        if (sceneName == nullptr)
+            continue;
+
+        OTRGlobals::Instance->context->GetResourceManager()->PrefetchResource(
+            StringHelper::Sprintf("scenes/%s/%s", sceneName, sceneName), OTRScene_PrefetchSceneData);
+    }
+
     return false;
 }
 
@@ -890,6 +972,7 @@ extern "C" s32 OTRfunc_800973FC(GlobalContext* globalCtx, RoomContext* roomCtx)
             OTRScene_ExecuteCommands(globalCtx, roomCtx->roomToLoad);
             Player_SetBootData(globalCtx, GET_PLAYER(globalCtx));
             Actor_SpawnTransitionActors(globalCtx, &globalCtx->actorCtx);
+            OTRScene_PrefetchAdjacentRooms(globalCtx);
 
             return 1;
         }
@@ -729,6 +729,7 @@ Acmd* AudioSynth_ProcessNote(s32 noteIndex, NoteSubEu* noteSubEu, NoteSynthesisS
         synthState->reverbVol = noteSubEu->reverbVol;
         synthState->numParts = 0;
         synthState->unk_1A = 1;
+        synthState->looped = false;
         note->noteSubEu.bitField0.finished = false;
         finished = false;
     }
@@ -825,6 +826,25 @@ Acmd* AudioSynth_ProcessNote(s32 noteIndex, NoteSubEu* noteSubEu, NoteSynthesisS
                     }
                 }
                
+                if (audioFontSample->decodedSamples != NULL && audioFontSample->medium != MEDIUM_UNK && bookOffset != 1) {
+                    // PC port: the sample was decoded when it was loaded, copy what the decoder would have produced.
+                    // Book offset 1 decodes with another book, that still goes through the decoder below.
+                    s16* decoded = synthState->looped && audioFontSample->decodedLoopSamples != NULL
+                                       ? audioFontSample->decodedLoopSamples + (synthState->samplePosInt - loopInfo->start)
+                                       : audioFontSample->decodedSamples + synthState->samplePosInt;
+
+                    nSamplesInThisIteration = CLAMP(nSamplesUntilLoopEnd, 0, nSamplesToProcess);
+                    if (nSamplesInThisIteration != 0) {
+                        aLoadBuffer(cmd++, decoded, DMEM_UNCOMPRESSED_NOTE + nSamplesProcessed * 2,
+                                    ALIGN16(nSamplesInThisIteration * 2));
+                    }
+
+                    nSamplesProcessed += nSamplesInThisIteration;
+                    flags = A_CONTINUE;
+                    skipBytes = 0;
+                    s5 = nSamplesProcessed * 2;
+                    goto skip;
+                }
 
                 switch (audioFontSample->codec) {
                     case CODEC_ADPCM:
@@ -854,6 +874,18 @@ Acmd* AudioSynth_ProcessNote(s32 noteIndex, NoteSubEu* noteSubEu, NoteSynthesisS
                         AudioSynth_LoadBuffer(cmd++, DMEM_UNCOMPRESSED_NOTE, ALIGN16(nSamplesToLoad * 2),
                                               audioFontSample->sampleAddr + (synthState->samplePosInt * 2));
                         
+                        flags = A_CONTINUE;
+                        skipBytes = 0;
+                        nSamplesProcessed = samplesLenAdjusted;
+                        s5 = samplesLenAdjusted;
+                        goto skip;
+                    case CODEC_S16_STREAM:
+                        AudioSynth_ClearBuffer(cmd++, DMEM_UNCOMPRESSED_NOTE, (samplesLenAdjusted * 2) + 0x20);
+                        AudioSynth_LoadBuffer(cmd++, DMEM_UNCOMPRESSED_NOTE, ALIGN16(nSamplesToLoad * 2),
+                                              (uintptr_t)AudioStream_Read(audioFontSample, noteIndex,
+                                                                          synthState->samplePosInt,
+                                                                          ALIGN16(nSamplesToLoad * 2) / 2));
+
                         flags = A_CONTINUE;
                         skipBytes = 0;
                         nSamplesProcessed = samplesLenAdjusted;
@@ -962,6 +994,7 @@ Acmd* AudioSynth_ProcessNote(s32 noteIndex, NoteSubEu* noteSubEu, NoteSynthesisS
                 } else {
                     if (restart) {
                         synthState->restart = true;
+                        synthState->looped = true;
                         synthState->samplePosInt = loopInfo->start;
                     } else {
                         synthState->samplePosInt += nSamplesToProcess;
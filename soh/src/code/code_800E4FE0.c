@@ -39,6 +39,7 @@ extern u64 rspAspMainDataStart[];
 extern u64 rspAspMainDataEnd[];
 
 void AudioMgr_CreateNextAudioBuffer(s16* samples, u32 num_samples) {
+    static u32 sLastCmdProcMsg = 0;
     OSMesg sp4C;
 
     gAudioContext.totalTaskCnt++;
@@ -60,10 +61,13 @@ void AudioMgr_CreateNextAudioBuffer(s16* samples, u32 num_samples) {
         // msg = 0000RREE R = read pos, E = End Pos
         while (osRecvMesg(gAudioContext.cmdProcQueueP, &sp4C, OS_MESG_NOBLOCK) != -1) {
             Audio_ProcessCmds(sp4C.data32);
+            sLastCmdProcMsg = sp4C.data32;
             j++;
         }
+        // PC port: the N64 resumes after an 0xF8 command by scheduling the game's commands itself. The game thread is
+        // the only one that schedules here, so this picks up where it left off in the last batch the game sent instead.
         if ((j == 0) && (gAudioContext.cmdQueueFinished)) {
-            Audio_ScheduleProcessCmds();
+            Audio_ProcessCmds(sLastCmdProcMsg);
         }
     }
     s32 writtenCmds;
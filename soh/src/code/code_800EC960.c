@@ -2223,6 +2223,8 @@ void AudioDebug_Draw(GfxPrint* printer) {
 #define SETCOL_SCROLLPRINT(r, g, b) SETCOL_COMMON(sAudioScrPrtWork[2], r, g, b)
 
     sAudioDebugEverOpened = true;
+    // PC port: reads note and channel state the audio thread updates.
+    OTRAudio_Lock();
     GfxPrint_SetPos(printer, 3, 2);
     SETCOL(255, 255, 255);
     GfxPrint_Printf(printer, "Audio Debug Mode");
@@ -2889,6 +2891,7 @@ void AudioDebug_Draw(GfxPrint* printer) {
             }
             break;
     }
+    OTRAudio_Unlock();
 #undef SETCOL_COMMON
 #undef SETCOL
 #undef SETCOL_SCROLLPRINT
@@ -3500,6 +3503,8 @@ void func_800F5CF8(void);
 
 void func_800F3054(void) {
     if (func_800FAD34() == 0) {
+        // PC port: synthesis runs on its own thread, this update must not interleave with one of its updates.
+        OTRAudio_Lock();
         sAudioUpdateTaskStart = gAudioContext.totalTaskCnt;
         sAudioUpdateStartTime = osGetTime();
         func_800EE6F4();
@@ -3520,6 +3525,7 @@ void func_800F3054(void) {
         Audio_ScheduleProcessCmds();
         sAudioUpdateTaskEnd = gAudioContext.totalTaskCnt;
         sAudioUpdateEndTime = osGetTime();
+        OTRAudio_Unlock();
     }
 }
 
@@ -4107,6 +4113,8 @@ s32 Audio_SetGanonDistVol(u8 targetVol)
         }
 
         Audio_SeqCmd8(SEQ_PLAYER_BGM_MAIN, 4, 15, phi_v0);
+        // PC port: reads channel state the audio thread updates.
+        OTRAudio_Lock();
         for (i = 0; i < 0x10; i++) {
             if (gAudioContext.seqPlayers[SEQ_PLAYER_BGM_MAIN].channels[i] != &gAudioContext.sequenceChannelNone) {
                 if ((u8)gAudioContext.seqPlayers[SEQ_PLAYER_BGM_MAIN].channels[i]->soundScriptIO[5] != 0xFF) {
@@ -4124,6 +4132,7 @@ s32 Audio_SetGanonDistVol(u8 targetVol)
                 }
             }
         }
+        OTRAudio_Unlock();
         sAudioGanonDistVol = targetVol;
     }
     return -1;
@@ -4279,6 +4288,8 @@ void Audio_SplitBgmChannels(s8 volSplit) {
             }
 
             channelBits = 0;
+            // PC port: reads channel state the audio thread updates.
+            OTRAudio_Lock();
             for (channelIdx = 0; channelIdx < 16; channelIdx++) {
                 if (notePriority > gAudioContext.seqPlayers[bgmPlayers[i]].channels[channelIdx]->notePriority) {
                     // If the note currently playing in the channel is a high enough priority,
@@ -4287,6 +4298,7 @@ void Audio_SplitBgmChannels(s8 volSplit) {
                     channelBits += (1 << channelIdx);
                 }
             }
+            OTRAudio_Unlock();
 
             Audio_SeqCmdA(bgmPlayers[i], channelBits);
         }
@@ -378,7 +378,14 @@ void Audio_ProcessSeqCmds(void) {
 }
 
 u16 func_800FA0B4(u8 playerIdx) {
-    if (!gAudioContext.seqPlayers[playerIdx].enabled) {
+    u8 enabled;
+
+    // PC port: the audio thread enables and disables sequence players.
+    OTRAudio_Lock();
+    enabled = gAudioContext.seqPlayers[playerIdx].enabled;
+    OTRAudio_Unlock();
+
+    if (!enabled) {
         return NA_BGM_DISABLED;
     }
     return D_8016E750[playerIdx].unk_254;
@@ -240,12 +240,6 @@ int fbTest = -1;
 void GameState_Update(GameState* gameState) {
     GraphicsContext* gfxCtx = gameState->gfxCtx;
 
-    if (fbTest == -1)
-    {
-        fbTest = gfx_create_framebuffer(64, 112);
-        //fbTest = gfx_create_framebuffer(256, 512);
-    }
-
     GameState_SetFrameBuffer(gfxCtx);
 
     gameState->main(gameState);
@@ -457,6 +457,7 @@ static struct RunFrameContext {
 extern AudioMgr gAudioMgr;
 
 extern void ProcessSaveStateRequests(void);
+extern void AudioRender_ProcessRequests(void);
 
 static void RunFrame()
 {
@@ -529,6 +530,7 @@ static void RunFrame()
 #ifndef __WIIU__
             ProcessSaveStateRequests();
 #endif
+            AudioRender_ProcessRequests();
             return;
             nextFrame:;
         }
@@ -545,7 +547,14 @@ static void RunFrame()
     exit(0);
 }
 
+extern int fbTest;
+int gfx_create_framebuffer(uint32_t width, uint32_t height);
+
 void Graph_ThreadEntry(void* arg0) {
+    // Created before the game loop starts, on the thread that renders. With pipelined rendering the game itself runs
+    // on another thread, which may not touch the renderer.
+    fbTest = gfx_create_framebuffer(64, 112);
+    //fbTest = gfx_create_framebuffer(256, 512);
 
     Graph_ProcessFrame(RunFrame);
 }
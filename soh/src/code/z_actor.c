@@ -773,7 +773,7 @@ void TitleCard_InitBossName(GlobalContext* globalCtx, TitleCardContext* titleCtx
                             u8 height, s16 hasTranslation) {
 
     if (ResourceMgr_OTRSigCheck(texture))
-        texture = ResourceMgr_LoadTexByName(texture);
+        texture = ResourceMgr_LoadPinnedTexByName(texture);
 
     titleCtx->texture = texture;
     titleCtx->isBossCard = true;
@@ -995,7 +995,7 @@ void TitleCard_InitPlaceName(GlobalContext* globalCtx, TitleCardContext* titleCt
         texture = newName;
     }
 
-    titleCtx->texture = ResourceMgr_LoadTexByName(texture);
+    titleCtx->texture = ResourceMgr_LoadPinnedTexByName(texture);
 
     //titleCtx->texture = texture;
     titleCtx->isBossCard = false;
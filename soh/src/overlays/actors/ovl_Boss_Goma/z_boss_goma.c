@@ -295,7 +295,7 @@ static u8 sDeadLimbLifetime[] = {
  */
 void BossGoma_ClearPixels16x16Rgba16(s16* rgba16image, u8* clearPixelTable, s16 i) 
 {
-    rgba16image = ResourceMgr_LoadTexByName(rgba16image);
+    rgba16image = ResourceMgr_LoadPinnedTexByName(rgba16image);
     if (clearPixelTable[i]) {
         rgba16image[i] = 0;
     }
@@ -308,7 +308,7 @@ void BossGoma_ClearPixels16x16Rgba16(s16* rgba16image, u8* clearPixelTable, s16
 void BossGoma_ClearPixels32x32Rgba16(s16* rgba16image, u8* clearPixelTable, s16 i) {
     s16* targetPixel;
 
-    rgba16image = ResourceMgr_LoadTexByName(rgba16image);
+    rgba16image = ResourceMgr_LoadPinnedTexByName(rgba16image);
 
     if (clearPixelTable[i]) {
         // address of the top left pixel in a 2x2 pixels block located at
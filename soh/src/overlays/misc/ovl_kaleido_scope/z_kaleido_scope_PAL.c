@@ -3081,7 +3081,7 @@ void KaleidoScope_GrayOutTextureRGBA32(u32* texture, u16 pixelCount) {
     u16 gray;
     u16 i;
 
-    texture = ResourceMgr_LoadTexByName(texture);
+    texture = ResourceMgr_LoadPinnedTexByName(texture);
 
     for (i = 0; i < pixelCount; i++) {
         uint32_t px = texture[i];